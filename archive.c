@@ -0,0 +1,552 @@
+/*
+**  CCSDS Packet Archive - Memory-mapped, append-only, segment-rotated
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+
+#define ARC_ALIGN(n)       (((n) + (ARC_REC_ALIGN - 1)) & ~(uint32)(ARC_REC_ALIGN - 1))
+#define ARC_IDX_CAPACITY(seg)  ((seg) / 256u)
+
+/******************************************************************************
+**  Function:  ARC_TimeNowNs()
+*/
+uint64 ARC_TimeNowNs (void)
+{
+   struct timespec Ts;
+
+   clock_gettime(CLOCK_REALTIME, &Ts);
+   return (uint64)Ts.tv_sec * 1000000000ull + (uint64)Ts.tv_nsec;
+}
+
+/******************************************************************************
+**  Function:  ARC_MapFile()
+**
+**  Maps a whole file read-only. When Size is non-zero the file is instead
+**  created with that size and mapped writable; an existing file is never
+**  reused (errno is EEXIST), so nothing already archived is overwritten.
+*/
+static void *ARC_MapFile (const char *Path, uint32 Size, uint32 *MappedLen)
+{
+   struct stat St;
+   void       *Map;
+   bool        Create = (Size > 0);
+   int         Fd;
+
+   Fd = Create ? open(Path, O_RDWR | O_CREAT | O_EXCL, 0644) : open(Path, O_RDONLY);
+   if (Fd < 0) return NULL;
+
+   if (Create)
+   {
+      if (ftruncate(Fd, Size) != 0) { close(Fd); unlink(Path); return NULL; }
+   }
+   else
+   {
+      if (fstat(Fd, &St) != 0 || St.st_size == 0 || St.st_size > 0xFFFFFFFF) { close(Fd); return NULL; }
+      Size = (uint32)St.st_size;
+   }
+
+   Map = mmap(NULL, Size, Create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, Fd, 0);
+   close(Fd);
+
+   if (Map == MAP_FAILED)
+   {
+      if (Create) unlink(Path);
+      return NULL;
+   }
+   if (MappedLen != NULL) *MappedLen = Size;
+
+   return Map;
+}
+
+/******************************************************************************
+**  Function:  ARC_SegPath()
+*/
+static void ARC_SegPath (char *Path, const char *Dir, uint32 SegNum, const char *Ext)
+{
+   snprintf(Path, ARC_PATH_MAX, "%s/seg_%06u.%s", Dir, SegNum, Ext);
+}
+
+/******************************************************************************
+**  Function:  ARC_CmpSegNum()
+*/
+static int ARC_CmpSegNum (const void *A, const void *B)
+{
+   uint32 X = *(const uint32 *)A;
+   uint32 Y = *(const uint32 *)B;
+
+   return (X > Y) - (X < Y);
+}
+
+/******************************************************************************
+**  Function:  ARC_ListSegments()
+**
+**  Finds the segments in Dir: their count and the highest segment number
+**  in *Last. When SegNums is not NULL it also gets a malloc'd array of all
+**  segment numbers, ascending, which the caller frees. There is no limit
+**  on the count, so the highest number is never missed. Returns false
+**  when Dir cannot be read or the list cannot be allocated.
+*/
+static bool ARC_ListSegments (const char *Dir, uint32 **SegNums, uint32 *Count, uint32 *Last)
+{
+   DIR           *D;
+   struct dirent *Ent;
+   uint32        *Nums = NULL;
+   uint32         Cap  = 0;
+   uint32         Num;
+
+   *Count = 0;
+   *Last  = 0;
+
+   D = opendir(Dir);
+   if (D == NULL) return false;
+
+   while ((Ent = readdir(D)) != NULL)
+   {
+      char Ext[8];
+      if (sscanf(Ent->d_name, "seg_%u.%7s", &Num, Ext) != 2 || strcmp(Ext, "arc") != 0) continue;
+
+      if (SegNums != NULL && *Count == Cap)
+      {
+         uint32 *Grown = realloc(Nums, (Cap ? Cap * 2 : 64) * sizeof(uint32));
+         if (Grown == NULL)
+         {
+            free(Nums);
+            closedir(D);
+            return false;
+         }
+         Nums = Grown;
+         Cap  = Cap ? Cap * 2 : 64;
+      }
+      if (SegNums != NULL) Nums[*Count] = Num;
+      if (*Count == 0 || Num > *Last) *Last = Num;
+      ++*Count;
+   }
+   closedir(D);
+
+   if (SegNums != NULL)
+   {
+      if (*Count > 1) qsort(Nums, *Count, sizeof(uint32), ARC_CmpSegNum);
+      *SegNums = Nums;
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  ARC_FinishSegment()
+**
+**  Unmaps the current segment and trims both files to what is in use.
+*/
+static void ARC_FinishSegment (ARC_Writer_t *Wr)
+{
+   char   Path[ARC_PATH_MAX];
+   uint32 SegUsed;
+   uint32 IdxUsed;
+
+   if (Wr->Seg == NULL) return;
+
+   SegUsed = Wr->SegHdr->Used;
+   IdxUsed = (uint32)(sizeof(ARC_IdxHdr_t) + Wr->IdxHdr->Count * sizeof(ARC_IdxEntry_t));
+
+   munmap(Wr->Seg, Wr->SegSize);
+   munmap(Wr->IdxHdr, (uint32)(sizeof(ARC_IdxHdr_t) + ARC_IDX_CAPACITY(Wr->SegSize) * sizeof(ARC_IdxEntry_t)));
+
+   ARC_SegPath(Path, Wr->Dir, Wr->SegNum, "arc");
+   if (truncate(Path, SegUsed) != 0) perror("Archive segment trim failed");
+   ARC_SegPath(Path, Wr->Dir, Wr->SegNum, "idx");
+   if (truncate(Path, IdxUsed) != 0) perror("Archive index trim failed");
+
+   Wr->Seg    = NULL;
+   Wr->SegHdr = NULL;
+   Wr->IdxHdr = NULL;
+   Wr->Idx    = NULL;
+}
+
+/******************************************************************************
+**  Function:  ARC_StartSegment()
+**
+**  Creates segment SegNum, or the next free number when its files already
+**  exist (left by another writer or a crashed run), up to ARC_START_TRIES
+**  numbers on.
+*/
+static bool ARC_StartSegment (ARC_Writer_t *Wr, uint32 SegNum)
+{
+   char   Path[ARC_PATH_MAX];
+   char   IdxPath[ARC_PATH_MAX];
+   uint32 IdxCap = ARC_IDX_CAPACITY(Wr->SegSize);
+   uint32 Len;
+   uint32 Tries;
+   int    Err;
+
+   for (Tries = 0; Tries < ARC_START_TRIES; ++Tries, ++SegNum)
+   {
+      ARC_SegPath(Path, Wr->Dir, SegNum, "arc");
+      Wr->Seg = ARC_MapFile(Path, Wr->SegSize, &Len);
+      if (Wr->Seg == NULL)
+      {
+         if (errno == EEXIST) continue;
+         return false;
+      }
+
+      ARC_SegPath(IdxPath, Wr->Dir, SegNum, "idx");
+      Wr->IdxHdr = ARC_MapFile(IdxPath, (uint32)(sizeof(ARC_IdxHdr_t) + IdxCap * sizeof(ARC_IdxEntry_t)), &Len);
+      if (Wr->IdxHdr != NULL) break;
+
+      /* The segment file is ours and empty, give the number up */
+      Err = errno;
+      munmap(Wr->Seg, Wr->SegSize);
+      unlink(Path);
+      Wr->Seg = NULL;
+      if (Err != EEXIST) return false;
+   }
+   if (Wr->Seg == NULL)
+   {
+      fprintf(stderr, "Archive: segments %u to %u in %s already exist\n", SegNum - ARC_START_TRIES, SegNum - 1, Wr->Dir);
+      return false;
+   }
+
+   Wr->SegNum = SegNum;
+   Wr->SegHdr = (ARC_SegHdr_t *)Wr->Seg;
+   Wr->Idx    = (ARC_IdxEntry_t *)(Wr->IdxHdr + 1);
+
+   Wr->SegHdr->Magic       = ARC_SEG_MAGIC;
+   Wr->SegHdr->SegNum      = SegNum;
+   Wr->SegHdr->SegSize     = Wr->SegSize;
+   Wr->SegHdr->FirstTimeNs = 0;
+   Wr->SegHdr->LastTimeNs  = 0;
+   Wr->SegHdr->RecCount    = 0;
+   Wr->SegHdr->Used        = ARC_ALIGN((uint32)sizeof(ARC_SegHdr_t));
+
+   Wr->IdxHdr->Magic    = ARC_IDX_MAGIC;
+   Wr->IdxHdr->Capacity = IdxCap;
+   Wr->IdxHdr->Count    = 0;
+   memset(Wr->IdxHdr->ApidMask, 0, sizeof(Wr->IdxHdr->ApidMask));
+
+   memset(Wr->LastIdxNs, 0, sizeof(Wr->LastIdxNs));
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  ARC_OpenWriter()
+**
+**  Starts a new segment after the highest numbered one already in Dir.
+*/
+bool ARC_OpenWriter (ARC_Writer_t *Wr, const char *Dir, uint32 SegSize)
+{
+   uint32 Count;
+   uint32 Last;
+
+   memset(Wr, 0, sizeof(*Wr));
+   if (strlen(Dir) >= ARC_DIR_MAX) return false;
+   if (mkdir(Dir, 0755) != 0 && errno != EEXIST) return false;
+
+   snprintf(Wr->Dir, ARC_DIR_MAX, "%s", Dir);
+   Wr->SegSize = (SegSize >= 4096) ? SegSize : ARC_SEG_SIZE_DEFAULT;
+
+   if (!ARC_ListSegments(Dir, NULL, &Count, &Last)) return false;
+
+   return ARC_StartSegment(Wr, (Count > 0) ? Last + 1 : 0);
+}
+
+/******************************************************************************
+**  Function:  ARC_Append()
+*/
+bool ARC_Append (ARC_Writer_t *Wr, const uint8 *Pkt, uint16 Length, uint64 RxTimeNs)
+{
+   ARC_RecHdr_t *RecPtr;
+   uint32        RecSize = ARC_ALIGN((uint32)(sizeof(ARC_RecHdr_t) + Length));
+   uint32        Offset;
+   uint16        Apid;
+   int64         Since;
+
+   if (Wr->Seg == NULL) return false;
+   if (RecSize > Wr->SegSize - ARC_ALIGN((uint32)sizeof(ARC_SegHdr_t))) return false;
+
+   /* Rollover when either the segment or its index is full */
+   if (Wr->SegHdr->Used + RecSize > Wr->SegSize || Wr->IdxHdr->Count == Wr->IdxHdr->Capacity)
+   {
+      uint32 Next = Wr->SegNum + 1;
+      ARC_FinishSegment(Wr);
+      if (!ARC_StartSegment(Wr, Next)) return false;
+   }
+
+   Offset = Wr->SegHdr->Used;
+   RecPtr = (ARC_RecHdr_t *)(Wr->Seg + Offset);
+   RecPtr->RxTimeNs = RxTimeNs;
+   RecPtr->Length   = Length;
+   RecPtr->Spare    = 0;
+   memcpy(RecPtr + 1, Pkt, Length);
+
+   /* Sparse index: first record of an APID in the segment, then one per
+      stride. The receive clock may step back: a small step (jitter) adds
+      nothing, one of a stride or more restarts the stride. Entry times
+      never decrease, the readers binary search them. */
+   if (Length >= sizeof(CCSDS_PriHdr_t))
+   {
+      Apid  = (uint16)CCSDS_RD_APID(*(const CCSDS_PriHdr_t *)Pkt);
+      Since = (int64)(RxTimeNs - Wr->LastIdxNs[Apid]);
+      if (Wr->LastIdxNs[Apid] == 0 || Since >= (int64)ARC_IDX_STRIDE_NS || Since <= -(int64)ARC_IDX_STRIDE_NS)
+      {
+         ARC_IdxEntry_t *Ent = &Wr->Idx[Wr->IdxHdr->Count];
+         Ent->TimeNs = RxTimeNs;
+         if (Wr->IdxHdr->Count > 0 && Ent[-1].TimeNs > RxTimeNs) Ent->TimeNs = Ent[-1].TimeNs;
+         Ent->Offset = Offset;
+         Ent->Apid   = Apid;
+         Ent->Spare  = 0;
+         Wr->IdxHdr->ApidMask[Apid >> 3] |= (uint8)(1 << (Apid & 7));
+         Wr->IdxHdr->Count++;
+         Wr->LastIdxNs[Apid] = RxTimeNs ? RxTimeNs : 1;
+      }
+   }
+
+   if (Wr->SegHdr->RecCount == 0) Wr->SegHdr->FirstTimeNs = RxTimeNs;
+   if (RxTimeNs > Wr->SegHdr->LastTimeNs) Wr->SegHdr->LastTimeNs = RxTimeNs;
+   Wr->SegHdr->RecCount++;
+
+   /* Publish last so a concurrent reader never sees a partial record */
+   __atomic_store_n(&Wr->SegHdr->Used, Offset + RecSize, __ATOMIC_RELEASE);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  ARC_CloseWriter()
+*/
+void ARC_CloseWriter (ARC_Writer_t *Wr)
+{
+   ARC_FinishSegment(Wr);
+}
+
+/******************************************************************************
+**  Function:  ARC_MapSegment()
+**
+**  Maps segment number Rd->SegNums[SegIdx] and its index for reading.
+*/
+static bool ARC_MapSegment (ARC_Reader_t *Rd, uint32 SegIdx)
+{
+   char   Path[ARC_PATH_MAX];
+   uint32 Len = 0;
+
+   if (Rd->Seg != NULL) munmap((void *)Rd->Seg, Rd->SegLen);
+   if (Rd->Idx != NULL) munmap((void *)Rd->Idx, Rd->IdxLen);
+   Rd->Seg = NULL;
+   Rd->Idx = NULL;
+
+   if (SegIdx >= Rd->NumSegs) return false;
+
+   ARC_SegPath(Path, Rd->Dir, Rd->SegNums[SegIdx], "arc");
+   Rd->Seg = ARC_MapFile(Path, 0, &Len);
+   if (Rd->Seg == NULL || Len < sizeof(ARC_SegHdr_t) || ((const ARC_SegHdr_t *)Rd->Seg)->Magic != ARC_SEG_MAGIC)
+   {
+      if (Rd->Seg != NULL) munmap((void *)Rd->Seg, Len);
+      Rd->Seg = NULL;
+      return false;
+   }
+   Rd->SegLen = Len;
+
+   ARC_SegPath(Path, Rd->Dir, Rd->SegNums[SegIdx], "idx");
+   Rd->Idx = ARC_MapFile(Path, 0, &Len);
+   if (Rd->Idx != NULL && (Len < sizeof(ARC_IdxHdr_t) || Rd->Idx->Magic != ARC_IDX_MAGIC))
+   {
+      munmap((void *)Rd->Idx, Len);
+      Rd->Idx = NULL;
+   }
+   Rd->IdxLen = Len;
+
+   Rd->CurSeg = SegIdx;
+   Rd->Offset = ARC_ALIGN((uint32)sizeof(ARC_SegHdr_t));
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  ARC_OpenReader()
+*/
+bool ARC_OpenReader (ARC_Reader_t *Rd, const char *Dir)
+{
+   uint32 Last;
+
+   memset(Rd, 0, sizeof(*Rd));
+   if (strlen(Dir) >= ARC_DIR_MAX) return false;
+   snprintf(Rd->Dir, ARC_DIR_MAX, "%s", Dir);
+
+   if (!ARC_ListSegments(Dir, &Rd->SegNums, &Rd->NumSegs, &Last)) return false;
+   if (Rd->NumSegs == 0 || !ARC_MapSegment(Rd, 0))
+   {
+      ARC_CloseReader(Rd);
+      return false;
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  ARC_NextRecord()
+**
+**  Zero-copy: Rec->Data points into the segment mapping and stays valid
+**  until the reader moves to another segment.
+*/
+bool ARC_NextRecord (ARC_Reader_t *Rd, ARC_Record_t *Rec)
+{
+   const ARC_RecHdr_t *RecPtr;
+   uint32              Used;
+
+   while (Rd->Seg != NULL)
+   {
+      Used = __atomic_load_n(&((const ARC_SegHdr_t *)Rd->Seg)->Used, __ATOMIC_ACQUIRE);
+      if (Used > Rd->SegLen) Used = Rd->SegLen;
+
+      if (Rd->Offset + sizeof(ARC_RecHdr_t) <= Used)
+      {
+         RecPtr = (const ARC_RecHdr_t *)(Rd->Seg + Rd->Offset);
+         if (Rd->Offset + sizeof(ARC_RecHdr_t) + RecPtr->Length > Used) return false;
+
+         Rec->Data     = (const uint8 *)(RecPtr + 1);
+         Rec->Length   = RecPtr->Length;
+         Rec->RxTimeNs = RecPtr->RxTimeNs;
+         Rd->Offset   += ARC_ALIGN((uint32)(sizeof(ARC_RecHdr_t) + RecPtr->Length));
+         return true;
+      }
+
+      if (!ARC_MapSegment(Rd, Rd->CurSeg + 1)) return false;
+   }
+
+   return false;
+}
+
+/******************************************************************************
+**  Function:  ARC_SegmentDone()
+**
+**  True when the next ARC_NextRecord call will move to another segment,
+**  which unmaps the current one and invalidates its record pointers.
+*/
+bool ARC_SegmentDone (const ARC_Reader_t *Rd)
+{
+   if (Rd->Seg == NULL) return true;
+
+   return Rd->Offset + sizeof(ARC_RecHdr_t) >
+          __atomic_load_n(&((const ARC_SegHdr_t *)Rd->Seg)->Used, __ATOMIC_ACQUIRE);
+}
+
+/******************************************************************************
+**  Function:  ARC_SeekInSegment()
+**
+**  Positions the cursor of the mapped segment at the last index entry
+**  older than TimeNs. Returns false when the segment cannot hold records
+**  of Apid at or after TimeNs.
+*/
+static bool ARC_SeekInSegment (ARC_Reader_t *Rd, uint16 Apid, uint64 TimeNs)
+{
+   const ARC_SegHdr_t   *SegHdr = (const ARC_SegHdr_t *)Rd->Seg;
+   const ARC_IdxEntry_t *Ent;
+   uint32                Count;
+   uint32                Lo, Hi, Mid;
+
+   if (SegHdr->RecCount == 0 || SegHdr->LastTimeNs < TimeNs) return false;
+
+   Rd->Offset = ARC_ALIGN((uint32)sizeof(ARC_SegHdr_t));
+   if (Rd->Idx == NULL) return true;
+
+   Apid &= 0x07FF;
+   if ((Rd->Idx->ApidMask[Apid >> 3] & (1 << (Apid & 7))) == 0) return false;
+
+   Count = Rd->Idx->Count;
+   if (sizeof(ARC_IdxHdr_t) + (uint64)Count * sizeof(ARC_IdxEntry_t) > Rd->IdxLen) return true;
+
+   /* Entries are in append order: binary search for the last one before TimeNs */
+   Ent = (const ARC_IdxEntry_t *)(Rd->Idx + 1);
+   Lo  = 0;
+   Hi  = Count;
+   while (Lo < Hi)
+   {
+      Mid = Lo + (Hi - Lo) / 2;
+      if (Ent[Mid].TimeNs < TimeNs) Lo = Mid + 1;
+      else                          Hi = Mid;
+   }
+   if (Lo > 0) Rd->Offset = Ent[Lo - 1].Offset;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  ARC_SeekTime()
+**
+**  Moves the cursor to the first segment that may hold Apid at or after
+**  TimeNs, as close before that record as the index allows.
+*/
+bool ARC_SeekTime (ARC_Reader_t *Rd, uint16 Apid, uint64 TimeNs)
+{
+   uint32 SegIdx;
+
+   for (SegIdx = 0; SegIdx < Rd->NumSegs; ++SegIdx)
+   {
+      if (!ARC_MapSegment(Rd, SegIdx)) continue;
+      if (ARC_SeekInSegment(Rd, Apid, TimeNs)) return true;
+   }
+
+   return false;
+}
+
+/******************************************************************************
+**  Function:  ARC_ScanApid()
+**
+**  Calls Callback for every record of Apid with T1Ns <= RxTimeNs <= T2Ns.
+**  Records are assumed to be in receive time order.
+*/
+uint32 ARC_ScanApid (ARC_Reader_t *Rd,
+                     uint16        Apid,
+                     uint64        T1Ns,
+                     uint64        T2Ns,
+                     void        (*Callback)(const ARC_Record_t *Rec, void *Arg),
+                     void         *Arg)
+{
+   ARC_Record_t Rec;
+   uint32       Matches = 0;
+   uint32       SegIdx;
+   uint32       Used;
+
+   for (SegIdx = 0; SegIdx < Rd->NumSegs; ++SegIdx)
+   {
+      if (!ARC_MapSegment(Rd, SegIdx)) continue;
+      if (((const ARC_SegHdr_t *)Rd->Seg)->FirstTimeNs > T2Ns) break;
+      if (!ARC_SeekInSegment(Rd, Apid, T1Ns)) continue;
+
+      /* Stay inside this segment, the loop above moves to the next one */
+      Used = ((const ARC_SegHdr_t *)Rd->Seg)->Used;
+      while (Rd->Offset < Used && ARC_NextRecord(Rd, &Rec))
+      {
+         if (Rec.RxTimeNs > T2Ns) return Matches;
+         if (Rec.RxTimeNs < T1Ns || Rec.Length < sizeof(CCSDS_PriHdr_t)) continue;
+         if (CCSDS_RD_APID(*(const CCSDS_PriHdr_t *)Rec.Data) != Apid) continue;
+
+         ++Matches;
+         if (Callback != NULL) Callback(&Rec, Arg);
+      }
+   }
+
+   return Matches;
+}
+
+/******************************************************************************
+**  Function:  ARC_CloseReader()
+*/
+void ARC_CloseReader (ARC_Reader_t *Rd)
+{
+   ARC_MapSegment(Rd, Rd->NumSegs);
+
+   free(Rd->SegNums);
+   Rd->SegNums = NULL;
+   Rd->NumSegs = 0;
+}
@@ -0,0 +1,140 @@
+/*
+**  CCSDS Packet Archive - Memory-mapped, append-only, segment-rotated
+**
+**  Every received packet is appended to the current segment file as a
+**  compact record. Segments are preallocated and mapped, so an append is a
+**  memcpy into the mapping; the only syscalls happen at segment rollover.
+**  A sidecar index per segment holds sparse (APID, time, offset) entries
+**  used to jump close to the first record of interest.
+**
+**  Files in the archive directory:
+**     seg_NNNNNN.arc   ARC_SegHdr_t followed by records
+**     seg_NNNNNN.idx   ARC_IdxHdr_t followed by ARC_IdxEntry_t
+*/
+
+#ifndef _archive_
+#define _archive_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define ARC_SEG_SIZE_DEFAULT   (64u * 1024u * 1024u)
+#define ARC_IDX_STRIDE_NS      (100ull * 1000000ull)   /* One index entry per APID per 100 ms */
+#define ARC_PATH_MAX           256
+#define ARC_DIR_MAX            (ARC_PATH_MAX - 32)     /* Room for the segment file name */
+#define ARC_START_TRIES        64                      /* Taken segment numbers skipped at start */
+
+#define ARC_SEG_MAGIC          0x43435344415243ull      /* "CCSDARC" */
+#define ARC_IDX_MAGIC          0x43435344494458ull      /* "CCSDIDX" */
+#define ARC_REC_ALIGN          4
+
+/*
+** -------------------------------------------------------------------------
+** ON-DISK LAYOUT (host byte order, archives are not meant to move between
+** hosts of different endianness)
+** -------------------------------------------------------------------------
+*/
+typedef struct {
+   uint64  Magic;
+   uint32  SegNum;
+   uint32  SegSize;
+   uint64  FirstTimeNs;
+   uint64  LastTimeNs;    /* Latest RxTimeNs, not the last one if the clock stepped back */
+   uint32  Used;          /* Bytes in use, header included */
+   uint32  RecCount;
+} ARC_SegHdr_t;
+
+/*----- Record header, the packet bytes follow (padded to ARC_REC_ALIGN) -----*/
+typedef struct {
+   uint64  RxTimeNs;      /* CLOCK_REALTIME at receive */
+   uint16  Length;        /* Packet bytes */
+   uint16  Spare;
+} __attribute__((packed)) ARC_RecHdr_t;
+
+typedef struct {
+   uint64  Magic;
+   uint32  Capacity;      /* Entries */
+   uint32  Count;
+   uint8   ApidMask[CCSDS_MAX_APID / 8];   /* APIDs present in the segment */
+} ARC_IdxHdr_t;
+
+typedef struct {
+   uint64  TimeNs;
+   uint32  Offset;        /* Record offset in the segment */
+   uint16  Apid;
+   uint16  Spare;
+} ARC_IdxEntry_t;
+
+/*
+** -------------------------------------------------------------------------
+** WRITER / READER STATE
+** -------------------------------------------------------------------------
+*/
+typedef struct {
+
+   char             Dir[ARC_DIR_MAX];
+   uint32           SegSize;
+   uint32           SegNum;
+
+   uint8           *Seg;          /* Current segment mapping */
+   ARC_SegHdr_t    *SegHdr;
+   ARC_IdxHdr_t    *IdxHdr;       /* Current index mapping */
+   ARC_IdxEntry_t  *Idx;
+
+   uint64           LastIdxNs[CCSDS_MAX_APID];
+
+} ARC_Writer_t;
+
+typedef struct {
+
+   const uint8     *Data;         /* Points into the mapped segment */
+   uint16           Length;
+   uint64           RxTimeNs;
+
+} ARC_Record_t;
+
+typedef struct {
+
+   char             Dir[ARC_DIR_MAX];
+   uint32           NumSegs;
+   uint32          *SegNums;      /* Ascending, ARC_CloseReader frees it */
+
+   /* Cursor */
+   uint32           CurSeg;       /* Index into SegNums */
+   const uint8     *Seg;
+   uint32           SegLen;
+   uint32           Offset;
+   const ARC_IdxHdr_t *Idx;
+   uint32           IdxLen;
+
+} ARC_Reader_t;
+
+
+/*
+** Exported Functions
+*/
+bool   ARC_OpenWriter  (ARC_Writer_t *Wr, const char *Dir, uint32 SegSize);
+bool   ARC_Append      (ARC_Writer_t *Wr, const uint8 *Pkt, uint16 Length, uint64 RxTimeNs);
+void   ARC_CloseWriter (ARC_Writer_t *Wr);
+
+bool   ARC_OpenReader  (ARC_Reader_t *Rd, const char *Dir);
+bool   ARC_NextRecord  (ARC_Reader_t *Rd, ARC_Record_t *Rec);
+bool   ARC_SegmentDone (const ARC_Reader_t *Rd);
+bool   ARC_SeekTime    (ARC_Reader_t *Rd, uint16 Apid, uint64 TimeNs);
+void   ARC_CloseReader (ARC_Reader_t *Rd);
+
+uint32 ARC_ScanApid    (ARC_Reader_t *Rd,
+                        uint16        Apid,
+                        uint64        T1Ns,
+                        uint64        T2Ns,
+                        void        (*Callback)(const ARC_Record_t *Rec, void *Arg),
+                        void         *Arg);
+
+uint64 ARC_TimeNowNs   (void);
+
+#endif  /* _archive_ */
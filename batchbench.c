@@ -0,0 +1,213 @@
+/*
+** File: batchbench.c
+** Role: BENCHMARK (structure-of-arrays header decode)
+** Description: Checks CCSDS_DecodeHdrBatch and the column scans against a
+**              scalar reference, then times the batch decode against one
+**              CCSDS_DecodeCmdHdr call per packet. Packets sit back to back
+**              at odd offsets in one buffer, the last one with only its 8
+**              header bytes before the end; every column, the APID
+**              histogram, an APID selection and a sequence gap scan must
+**              match, and a length field of 0xFFFF must give 0x10006. Any
+**              mismatch exits non-zero, and so does a batch decode that is
+**              not faster than the per-packet one (best of 3 runs each).
+**
+**              Built with -mavx2 the batch decode uses the AVX2 gather, so
+**              the check compares the vector path with the scalar one;
+**              without it only the column loops are vectorized (-O2).
+**
+** Usage:       batchbench [-n packets] [-r rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ccsds.h"
+#include "ccsds_batch.h"
+#include "latency.h"
+
+#define BENCH_APIDS    8
+#define MAX_GAPS       1024
+#define TIMING_RUNS    3
+
+static void cols_alloc(CCSDS_HdrColumns_t *c, uint32 n) {
+    memset(c, 0, sizeof(*c));
+    c->Capacity = n;
+    c->Apid = malloc(n * sizeof(uint16));
+    c->SeqCount = malloc(n * sizeof(uint16));
+    c->Length = malloc(n * sizeof(uint32));
+    c->FuncCode = malloc(n);
+    c->Type = malloc(n);
+    c->SecHdr = malloc(n);
+    c->SeqFlags = malloc(n);
+    c->Version = malloc(n);
+}
+
+static void cols_free(CCSDS_HdrColumns_t *c) {
+    free(c->Apid);
+    free(c->SeqCount);
+    free(c->Length);
+    free(c->FuncCode);
+    free(c->Type);
+    free(c->SecHdr);
+    free(c->SeqFlags);
+    free(c->Version);
+}
+
+// The reference: one scalar decode per packet into the same columns
+static void decode_scalar(const uint8 *buf, const uint64 *offsets, uint32 n, CCSDS_HdrColumns_t *c) {
+    for (uint32 i = 0; i < n; i++) {
+        CCSDS_CmdHdr_t h;
+        CCSDS_DecodeCmdHdr(buf + offsets[i], &h);
+        c->Apid[i] = h.Apid;
+        c->SeqCount[i] = h.SeqCount;
+        c->Length[i] = h.Length;
+        c->FuncCode[i] = h.FuncCode;
+        c->Type[i] = h.Type;
+        c->SecHdr[i] = h.SecHdr;
+        c->SeqFlags[i] = h.SeqFlags;
+        c->Version[i] = h.Version;
+    }
+    c->Count = n;
+}
+
+static void fail(const char *what, uint32 i) {
+    fprintf(stderr, "[BATCH] %s differs at row %u\n", what, i);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    long count = 100003, rounds = 50;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': count = atol(optarg); break;
+            case 'r': rounds = atol(optarg); break;
+            default:  count = 0; break;
+        }
+    }
+    if (count < 1 || count > 10000000 || rounds < 1) {
+        fprintf(stderr, "Usage: %s [-n packets] [-r rounds]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    uint32 n = (uint32)count;
+
+    // Random headers, a few APIDs with mostly consecutive sequence counts
+    uint64 *offsets = malloc(n * sizeof(uint64));
+    uint16 seq[BENCH_APIDS] = { 0 };
+    uint64 size = 0;
+    srand(1);
+    for (uint32 i = 0; i < n; i++) {
+        offsets[i] = size;
+        size += (i + 1 < n) ? 8 + (uint32)rand() % 57 : 8;
+    }
+    uint8 *buf = malloc(size);
+    for (uint64 k = 0; k < size; k++) buf[k] = (uint8)rand();
+    for (uint32 i = 0; i < n; i++) {
+        uint16 a = (uint16)((uint32)rand() % BENCH_APIDS);
+        uint16 s = (rand() % 1000 == 0) ? (uint16)(seq[a] + 2) : seq[a];
+        seq[a] = (uint16)((s + 1) & 0x3FFF);
+        buf[offsets[i]] = (uint8)((buf[offsets[i]] & 0xF8) | ((0x100 + a) >> 8));
+        buf[offsets[i] + 1] = (uint8)(0x100 + a);
+        buf[offsets[i] + 2] = (uint8)((buf[offsets[i] + 2] & 0xC0) | ((s >> 8) & 0x3F));
+        buf[offsets[i] + 3] = (uint8)s;
+    }
+    buf[offsets[0] + 4] = 0xFF;   // Length field 0xFFFF, a total of 0x10006
+    buf[offsets[0] + 5] = 0xFF;
+
+    CCSDS_HdrColumns_t ref, got;
+    cols_alloc(&ref, n);
+    cols_alloc(&got, n);
+    decode_scalar(buf, offsets, n, &ref);
+
+    // Two calls, so a batch that starts part way through the columns is covered
+    uint32 half = n / 2 + 1;
+    if (CCSDS_DecodeHdrBatch(buf, offsets, half, &got) != half ||
+        CCSDS_DecodeHdrBatch(buf, offsets + half, n - half, &got) != n - half || got.Count != n) {
+        fail("Row count", got.Count);
+    }
+    for (uint32 i = 0; i < n; i++) {
+        if (got.Apid[i] != ref.Apid[i]) fail("Apid", i);
+        if (got.SeqCount[i] != ref.SeqCount[i]) fail("SeqCount", i);
+        if (got.Length[i] != ref.Length[i]) fail("Length", i);
+        if (got.FuncCode[i] != ref.FuncCode[i]) fail("FuncCode", i);
+        if (got.Type[i] != ref.Type[i]) fail("Type", i);
+        if (got.SecHdr[i] != ref.SecHdr[i]) fail("SecHdr", i);
+        if (got.SeqFlags[i] != ref.SeqFlags[i]) fail("SeqFlags", i);
+        if (got.Version[i] != ref.Version[i]) fail("Version", i);
+    }
+    if (got.Length[0] != 0x10006) fail("Length 0xFFFF + 7", 0);
+
+    static uint32 hist[CCSDS_MAX_APID], naive[CCSDS_MAX_APID];
+    static CCSDS_HistScratch_t scratch;
+    CCSDS_ApidHistogram(got.Apid, n, hist, &scratch);
+    CCSDS_ApidHistogram(got.Apid, n, hist, NULL);
+    for (uint32 i = 0; i < n; i++) naive[ref.Apid[i]] += 2;
+    for (uint32 a = 0; a < CCSDS_MAX_APID; a++) {
+        if (hist[a] != naive[a]) fail("Histogram bin", a);
+    }
+
+    uint32 *sel = malloc(n * sizeof(uint32));
+    uint32 selected = CCSDS_SelectApid(got.Apid, n, 0x101, sel), expect = 0;
+    for (uint32 i = 0; i < n; i++) {
+        if (ref.Apid[i] != 0x101) continue;
+        if (expect >= selected || sel[expect] != i) fail("Selected row", i);
+        expect++;
+    }
+    if (expect != selected) fail("Selection size", selected);
+
+    uint32 gaps[MAX_GAPS], ngaps = CCSDS_FindSeqGaps(got.Apid, got.SeqCount, n, 0x101, gaps, MAX_GAPS);
+    uint32 found = 0;
+    bool first = true;
+    uint16 next = 0;
+    for (uint32 i = 0; i < n; i++) {
+        if (ref.Apid[i] != 0x101) continue;
+        if (!first && ref.SeqCount[i] != next) {
+            if (found < MAX_GAPS && gaps[found] != i) fail("Gap row", i);
+            found++;
+        }
+        next = (uint16)((ref.SeqCount[i] + 1) & 0x3FFF);
+        first = false;
+    }
+    if (found != ngaps) fail("Gap count", ngaps);
+
+    // Best of a few runs each, so one preemption does not decide the verdict
+    uint64 ns_scalar = ~0ull, ns_batch = ~0ull;
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        uint64 start = LAT_NowNs();
+        for (long r = 0; r < rounds; r++) decode_scalar(buf, offsets, n, &ref);
+        uint64 ns = LAT_NowNs() - start;
+        if (ns < ns_scalar) ns_scalar = ns;
+
+        start = LAT_NowNs();
+        for (long r = 0; r < rounds; r++) {
+            got.Count = 0;
+            CCSDS_DecodeHdrBatch(buf, offsets, n, &got);
+        }
+        ns = LAT_NowNs() - start;
+        if (ns < ns_batch) ns_batch = ns;
+    }
+
+    printf("[BATCH] %u packets: columns, histogram, selection (%u rows) and gaps (%u) match the scalar reference\n",
+           n, selected, ngaps);
+    printf("[BATCH] decode   per packet %5.2f ns   batch (%s) %5.2f ns\n", (double)ns_scalar / ((double)n * rounds),
+#if defined(__AVX2__)
+           "AVX2 gather",
+#else
+           "scalar",
+#endif
+           (double)ns_batch / ((double)n * rounds));
+    if (ns_batch >= ns_scalar) {
+        fprintf(stderr, "[BATCH] Batch decode is not faster than the per-packet decode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    cols_free(&ref);
+    cols_free(&got);
+    free(sel);
+    free(buf);
+    free(offsets);
+    return 0;
+}
@@ -33,7 +33,7 @@ bool CCSDS_ValidCheckSum (CCSDS_CommandPacket_t *PktPtr)
 uint8 CCSDS_ComputeCheckSum (CCSDS_CommandPacket_t *PktPtr)
 {
    /* Use macros to get length correctly */
-   uint16   PktLen   = CCSDS_RD_LEN(PktPtr->SpacePacket.Hdr);
+   uint32   PktLen   = (uint32)CCSDS_RD_LEN(PktPtr->SpacePacket.Hdr);
    
    /* Access as raw bytes - Works universally */
    uint8   *BytePtr  = (uint8 *)PktPtr;
@@ -56,6 +56,7 @@ uint16 CCSDS_BuildTelecommand(uint8       *PacketBuf,
                               uint16       PayloadLen)
 {
     CCSDS_CommandPacket_t *PktPtr;
+    CCSDS_CmdHdr_t         Hdr;
     uint16                 HeaderSize;
     uint32                 TotalLen32;
     uint16                 TotalLen;
@@ -72,20 +73,17 @@ uint16 CCSDS_BuildTelecommand(uint8       *PacketBuf,
     TotalLen = (uint16)TotalLen32;
     PktPtr = (CCSDS_CommandPacket_t *)PacketBuf;
 
-    /* Clear Headers */
-    CCSDS_CLR_PRI_HDR(PktPtr->SpacePacket.Hdr);
-    CCSDS_CLR_CMDSEC_HDR(PktPtr->Sec);
-
-    /* Set Primary Header - Macros handle the Endianness */
-    CCSDS_WR_APID (PktPtr->SpacePacket.Hdr, Apid);
-    CCSDS_WR_TYPE (PktPtr->SpacePacket.Hdr, CCSDS_CMD);         
-    CCSDS_WR_SHDR (PktPtr->SpacePacket.Hdr, CCSDS_HAS_SEC_HDR); 
-    CCSDS_WR_VERS (PktPtr->SpacePacket.Hdr, 0);                 
-    CCSDS_WR_SEQ  (PktPtr->SpacePacket.Hdr, SeqCount);          
-    CCSDS_WR_LEN  (PktPtr->SpacePacket.Hdr, TotalLen);          
-
-    /* Set Secondary Header */
-    CCSDS_WR_FC(PktPtr->Sec, FuncCode);
+    /* Primary and Secondary Header - one Big Endian store */
+    Hdr.Version  = 0;
+    Hdr.Type     = CCSDS_CMD;
+    Hdr.SecHdr   = CCSDS_HAS_SEC_HDR;
+    Hdr.Apid     = Apid;
+    Hdr.SeqFlags = CCSDS_INIT_SEQFLG;
+    Hdr.SeqCount = SeqCount;
+    Hdr.Length   = TotalLen;
+    Hdr.FuncCode = FuncCode;
+    Hdr.CheckSum = CCSDS_INIT_CHECKSUM;
+    CCSDS_EncodeCmdHdr(PktPtr, &Hdr);
 
     /* Copy Payload */
     DataPtr = PacketBuf + HeaderSize;
@@ -98,4 +96,129 @@ uint16 CCSDS_BuildTelecommand(uint8       *PacketBuf,
     CCSDS_LoadCheckSum(PktPtr);
 
     return TotalLen;
+}
+
+/******************************************************************************
+**  Function:  CCSDS_BuildTelemetry()
+**
+**  Telemetry packet with a secondary header holding the time as 4 bytes
+**  of seconds and 2 bytes of 1/65536 s subseconds. No checksum.
+*/
+uint16 CCSDS_BuildTelemetry(uint8       *PacketBuf,
+                            uint16       PacketBufSize,
+                            uint16       Apid,
+                            uint16       SeqCount,
+                            uint32       Seconds,
+                            uint16       Subsecs,
+                            const uint8 *Payload,
+                            uint16       PayloadLen)
+{
+    CCSDS_TelemetryPacket_t *PktPtr;
+    uint16                   HeaderSize;
+    uint32                   TotalLen32;
+
+    if (PacketBuf == NULL) return 0;
+
+    HeaderSize = (uint16)sizeof(CCSDS_TelemetryPacket_t);
+    TotalLen32 = (uint32)HeaderSize + (uint32)PayloadLen;
+
+    if (TotalLen32 > PacketBufSize || TotalLen32 > 0xFFFF) return 0;
+
+    PktPtr = (CCSDS_TelemetryPacket_t *)PacketBuf;
+
+    CCSDS_CLR_PRI_HDR(PktPtr->SpacePacket.Hdr);
+    CCSDS_WR_TYPE(PktPtr->SpacePacket.Hdr, CCSDS_TLM);
+    CCSDS_WR_SHDR(PktPtr->SpacePacket.Hdr, CCSDS_HAS_SEC_HDR);
+    CCSDS_WR_APID(PktPtr->SpacePacket.Hdr, Apid);
+    CCSDS_WR_SEQ(PktPtr->SpacePacket.Hdr, SeqCount);
+    CCSDS_WR_LEN(PktPtr->SpacePacket.Hdr, TotalLen32);
+
+    PktPtr->Sec.Time[0] = (uint8)(Seconds >> 24);
+    PktPtr->Sec.Time[1] = (uint8)(Seconds >> 16);
+    PktPtr->Sec.Time[2] = (uint8)(Seconds >> 8);
+    PktPtr->Sec.Time[3] = (uint8)(Seconds);
+    PktPtr->Sec.Time[4] = (uint8)(Subsecs >> 8);
+    PktPtr->Sec.Time[5] = (uint8)(Subsecs);
+
+    if (Payload != NULL && PayloadLen > 0) memcpy(PacketBuf + HeaderSize, Payload, PayloadLen);
+
+    return (uint16)TotalLen32;
+}
+
+/******************************************************************************
+**  Function:  CCSDS_InitCmdTemplate()
+**
+**  Builds the packet once (sequence count 0). Later instances are produced
+**  with CCSDS_SetTemplateSeq/CCSDS_PatchTemplate, which keep the checksum
+**  valid by XORing in the difference of the changed bytes only.
+*/
+uint16 CCSDS_InitCmdTemplate (CCSDS_CmdTemplate_t *Tmpl,
+                              uint8               *PacketBuf,
+                              uint16               PacketBufSize,
+                              uint16               Apid,
+                              uint8                FuncCode,
+                              const uint8         *Payload,
+                              uint16               PayloadLen)
+{
+    if (Tmpl == NULL) return 0;
+
+    Tmpl->Length = CCSDS_BuildTelecommand(PacketBuf, PacketBufSize, Apid, CCSDS_INIT_SEQ,
+                                          FuncCode, Payload, PayloadLen);
+    Tmpl->PktPtr = (Tmpl->Length > 0) ? (CCSDS_CommandPacket_t *)PacketBuf : NULL;
+
+    return Tmpl->Length;
+}
+
+/******************************************************************************
+**  Function:  CCSDS_SetTemplateSeq()
+**
+**  Returns false for a template that CCSDS_InitCmdTemplate did not build.
+*/
+bool CCSDS_SetTemplateSeq (CCSDS_CmdTemplate_t *Tmpl, uint16 SeqCount)
+{
+    CCSDS_PriHdr_t *HdrPtr;
+    uint8           Old0;
+    uint8           Old1;
+
+    if (Tmpl == NULL || Tmpl->PktPtr == NULL || Tmpl->Length == 0) return false;
+
+    HdrPtr = &Tmpl->PktPtr->SpacePacket.Hdr;
+    Old0   = HdrPtr->Sequence[0];
+    Old1   = HdrPtr->Sequence[1];
+
+    CCSDS_WR_SEQ(*HdrPtr, SeqCount);
+
+    CCSDS_WR_CHECKSUM(Tmpl->PktPtr->Sec, CCSDS_RD_CHECKSUM(Tmpl->PktPtr->Sec) ^
+                      Old0 ^ HdrPtr->Sequence[0] ^ Old1 ^ HdrPtr->Sequence[1]);
+
+    return true;
+}
+
+/******************************************************************************
+**  Function:  CCSDS_PatchTemplate()
+**
+**  Overwrites DataLen payload bytes starting at payload Offset.
+*/
+bool CCSDS_PatchTemplate (CCSDS_CmdTemplate_t *Tmpl,
+                          uint16               Offset,
+                          const uint8         *Data,
+                          uint16               DataLen)
+{
+    uint8  *DataPtr;
+    uint8   Delta = 0;
+    uint16  i;
+
+    if (Tmpl == NULL || Tmpl->PktPtr == NULL || (Data == NULL && DataLen > 0)) return false;
+    if ((uint32)sizeof(CCSDS_CommandPacket_t) + Offset + DataLen > Tmpl->Length) return false;
+
+    DataPtr = (uint8 *)Tmpl->PktPtr + sizeof(CCSDS_CommandPacket_t) + Offset;
+    for (i = 0; i < DataLen; ++i)
+    {
+        Delta     ^= DataPtr[i] ^ Data[i];
+        DataPtr[i] = Data[i];
+    }
+
+    CCSDS_WR_CHECKSUM(Tmpl->PktPtr->Sec, CCSDS_RD_CHECKSUM(Tmpl->PktPtr->Sec) ^ Delta);
+
+    return true;
 }
\ No newline at end of file
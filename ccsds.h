@@ -13,6 +13,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h> 
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /* 
 ** Platform Independent Types
@@ -20,12 +25,15 @@
 typedef uint8_t  uint8;
 typedef uint16_t uint16;
 typedef uint32_t uint32;
+typedef uint64_t uint64;
 typedef int32_t  int32;
+typedef int64_t  int64;
 
 /* 
 ** Configuration
 */
 #define CCSDS_TIME_SIZE 6
+#define CCSDS_MAX_APID  2048   /* APID is 11 bits */
 
 /*
 ** -------------------------------------------------------------------------
@@ -82,6 +90,25 @@ typedef struct {
     CCSDS_TlmSecHdr_t   Sec;
 } CCSDS_TelemetryPacket_t;
 
+/*----- Decoded command headers (host order, 16 Bytes) -----*/
+typedef struct {
+    uint32  Length;      /* Total packet length, same as CCSDS_RD_LEN (up to 0x10006) */
+    uint16  Apid;
+    uint16  SeqCount;
+    uint8   Version;
+    uint8   Type;
+    uint8   SecHdr;
+    uint8   SeqFlags;
+    uint8   FuncCode;
+    uint8   CheckSum;
+} CCSDS_CmdHdr_t;
+
+/*----- Prebuilt command packet (see CCSDS_InitCmdTemplate) -----*/
+typedef struct {
+    CCSDS_CommandPacket_t *PktPtr;    /* Points into the caller's buffer */
+    uint16                 Length;    /* Total packet length */
+} CCSDS_CmdTemplate_t;
+
 
 /*
 ** -------------------------------------------------------------------------
@@ -174,6 +201,105 @@ typedef struct {
     (shdr).Command[1] = (CCSDS_INIT_CHECKSUM) )
 
 
+/*
+** -------------------------------------------------------------------------
+** WHOLE HEADER DECODE / ENCODE
+** The primary and command secondary headers are moved as one 64-bit Big
+** Endian word: a single load (or store) and a byte swap on Little Endian
+** hosts, then every field is extracted with fixed shifts and masks.
+** Compilers that do not say their byte order get the word assembled a
+** byte at a time, which is correct on any host.
+** The buffer must hold at least sizeof(CCSDS_CommandPacket_t) bytes.
+** -------------------------------------------------------------------------
+*/
+static inline uint64 CCSDS_LoadHdrWord(const void *Buf)
+{
+    uint64 Word;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    memcpy(&Word, Buf, sizeof(Word));
+    Word = __builtin_bswap64(Word);
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    memcpy(&Word, Buf, sizeof(Word));
+#else
+    const uint8 *Bytes = (const uint8 *)Buf;
+    int          i;
+
+    Word = 0;
+    for (i = 0; i < 8; ++i) Word = (Word << 8) | Bytes[i];
+#endif
+    return Word;
+}
+
+static inline void CCSDS_StoreHdrWord(void *Buf, uint64 Word)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    Word = __builtin_bswap64(Word);
+    memcpy(Buf, &Word, sizeof(Word));
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    memcpy(Buf, &Word, sizeof(Word));
+#else
+    uint8 *Bytes = (uint8 *)Buf;
+    int    i;
+
+    for (i = 7; i >= 0; --i)
+    {
+        Bytes[i] = (uint8)(Word & 0xFF);
+        Word >>= 8;
+    }
+#endif
+}
+
+static inline void CCSDS_DecodeCmdHdr(const void *Buf, CCSDS_CmdHdr_t *Hdr)
+{
+    uint64 Word = CCSDS_LoadHdrWord(Buf);
+
+    Hdr->Version  = (uint8) ((Word >> 61) & 0x07);
+    Hdr->Type     = (uint8) ((Word >> 60) & 0x01);
+    Hdr->SecHdr   = (uint8) ((Word >> 59) & 0x01);
+    Hdr->Apid     = (uint16)((Word >> 48) & 0x07FF);
+    Hdr->SeqFlags = (uint8) ((Word >> 46) & 0x03);
+    Hdr->SeqCount = (uint16)((Word >> 32) & 0x3FFF);
+    Hdr->Length   = (uint32)(((Word >> 16) & 0xFFFF) + 7);
+    Hdr->FuncCode = (uint8) ((Word >> 8)  & 0x7F);
+    Hdr->CheckSum = (uint8) ( Word        & 0xFF);
+}
+
+/* Hdr->Length is the total, 7 to 0x10006; the field holds Length - 7 */
+static inline void CCSDS_EncodeCmdHdr(void *Buf, const CCSDS_CmdHdr_t *Hdr)
+{
+    uint64 Word = ((uint64)(Hdr->Version  & 0x07)             << 61) |
+                  ((uint64)(Hdr->Type     & 0x01)             << 60) |
+                  ((uint64)(Hdr->SecHdr   & 0x01)             << 59) |
+                  ((uint64)(Hdr->Apid     & 0x07FF)           << 48) |
+                  ((uint64)(Hdr->SeqFlags & 0x03)             << 46) |
+                  ((uint64)(Hdr->SeqCount & 0x3FFF)           << 32) |
+                  ((uint64)((Hdr->Length - 7) & 0xFFFF)       << 16) |
+                  ((uint64)(Hdr->FuncCode & 0x7F)             << 8)  |
+                  ((uint64)(Hdr->CheckSum));
+
+    CCSDS_StoreHdrWord(Buf, Word);
+}
+
+/*
+** -------------------------------------------------------------------------
+** SPIN WAIT HINT
+** For busy-wait loops: tells the core it is spinning (x86 PAUSE, ARM
+** YIELD) so it saves power and yields to its hyper-thread sibling. Other
+** targets only get a compiler barrier, so the loop still re-reads memory.
+** -------------------------------------------------------------------------
+*/
+static inline void CCSDS_CpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+
 /*
 ** Exported Functions
 */
@@ -187,5 +313,29 @@ uint16 CCSDS_BuildTelecommand(uint8       *PacketBuf,
                               uint8        FuncCode,
                               const uint8 *Payload,
                               uint16       PayloadLen);
+uint16 CCSDS_BuildTelemetry(uint8       *PacketBuf,
+                            uint16       PacketBufSize,
+                            uint16       Apid,
+                            uint16       SeqCount,
+                            uint32       Seconds,
+                            uint16       Subsecs,
+                            const uint8 *Payload,
+                            uint16       PayloadLen);
+uint16 CCSDS_InitCmdTemplate (CCSDS_CmdTemplate_t *Tmpl,
+                              uint8               *PacketBuf,
+                              uint16               PacketBufSize,
+                              uint16               Apid,
+                              uint8                FuncCode,
+                              const uint8         *Payload,
+                              uint16               PayloadLen);
+bool CCSDS_SetTemplateSeq (CCSDS_CmdTemplate_t *Tmpl, uint16 SeqCount);
+bool CCSDS_PatchTemplate (CCSDS_CmdTemplate_t *Tmpl,
+                          uint16               Offset,
+                          const uint8         *Data,
+                          uint16               DataLen);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif  /* _ccsds_ */
\ No newline at end of file
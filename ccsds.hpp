@@ -0,0 +1,204 @@
+/*
+**  CCSDS Packet Views - Header-only C++20 layer over ccsds.h
+**
+**  PacketView, CommandView and TelemetryView are read-only views over a
+**  std::span<const std::byte>. Every header field is described once at
+**  compile time (byte offset, width, shift, mask, bias) and the accessors
+**  are generated from those descriptors.
+**
+**  Bounds: a view is created through parse(), which checks the buffer
+**  against the view's minimum size and the packet length field (or through
+**  assume_valid() when the caller has already done so).
+**  After that, reading a field that lies inside the minimum size needs no
+**  runtime check; reading one outside it does not compile.
+*/
+
+#ifndef _ccsds_hpp_
+#define _ccsds_hpp_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include "ccsds.h"
+
+namespace ccsds {
+
+/*
+** -------------------------------------------------------------------------
+** FIELD DESCRIPTORS
+** -------------------------------------------------------------------------
+*/
+template <std::size_t Offset, std::size_t Bytes, unsigned Shift, std::uint32_t Mask, std::uint32_t Bias = 0>
+struct Field {
+
+    static_assert(Bytes >= 1 && Bytes <= 4, "fields are 1 to 4 bytes wide");
+
+    static constexpr std::size_t offset = Offset;
+    static constexpr std::size_t end    = Offset + Bytes;
+
+    /* Wide enough for the largest value after the bias (Length reaches 0x10006) */
+    static constexpr std::uint64_t max_value = std::uint64_t{Mask} + Bias;
+
+    using value_type = std::conditional_t<(max_value > 0xFFFF), std::uint32_t,
+                       std::conditional_t<(max_value > 0xFF),   std::uint16_t, std::uint8_t>>;
+
+    /* Big Endian read, unrolled at compile time */
+    static constexpr value_type read(const std::byte *p) noexcept
+    {
+        std::uint32_t raw = 0;
+        for (std::size_t i = 0; i < Bytes; ++i) raw = (raw << 8) | std::to_integer<std::uint32_t>(p[Offset + i]);
+        return static_cast<value_type>(((raw >> Shift) & Mask) + Bias);
+    }
+};
+
+namespace field {
+    /* Primary header (ccsds.h CCSDS_PriHdr_t) */
+    using Version  = Field<0, 1, 5, 0x07>;
+    using Type     = Field<0, 1, 4, 0x01>;
+    using SecHdr   = Field<0, 1, 3, 0x01>;
+    using StreamId = Field<0, 2, 0, 0xFFFF>;
+    using Apid     = Field<0, 2, 0, 0x07FF>;
+    using SeqFlags = Field<2, 1, 6, 0x03>;
+    using SeqCount = Field<2, 2, 0, 0x3FFF>;
+    using Length   = Field<4, 2, 0, 0xFFFF, 7>;   /* Total packet length, as CCSDS_RD_LEN */
+
+    /* Command secondary header (ccsds.h CCSDS_CmdSecHdr_t) */
+    using FuncCode = Field<6, 1, 0, 0x7F>;
+    using CheckSum = Field<7, 1, 0, 0xFF>;
+}
+
+/*
+** -------------------------------------------------------------------------
+** VIEWS
+** -------------------------------------------------------------------------
+*/
+template <std::size_t MinSize, std::size_t HdrSize>
+class BasicView {
+
+public:
+    static constexpr std::size_t min_size    = MinSize;
+    static constexpr std::size_t header_size = HdrSize;
+
+    /* Field access, bounds proven at compile time */
+    template <class F>
+    constexpr typename F::value_type get() const noexcept
+    {
+        static_assert(F::end <= MinSize, "field lies outside the validated header");
+        return F::read(bytes_.data());
+    }
+
+    constexpr auto version()    const noexcept { return get<field::Version>();  }
+    constexpr auto type()       const noexcept { return get<field::Type>();     }
+    constexpr bool sec_hdr()    const noexcept { return get<field::SecHdr>();   }
+    constexpr auto apid()       const noexcept { return get<field::Apid>();     }
+    constexpr auto seq_flags()  const noexcept { return get<field::SeqFlags>(); }
+    constexpr auto seq_count()  const noexcept { return get<field::SeqCount>(); }
+    constexpr auto length()     const noexcept { return get<field::Length>();   }
+
+    /* Whole packet (trimmed to the length field) and user data */
+    constexpr std::span<const std::byte> bytes()   const noexcept { return bytes_; }
+    constexpr std::span<const std::byte> payload() const noexcept { return bytes_.subspan(HdrSize); }
+
+    /* Checked construction: buffer holds MinSize bytes and the whole packet */
+    static constexpr std::optional<BasicView> parse(std::span<const std::byte> buf) noexcept
+    {
+        if (buf.size() < MinSize) return std::nullopt;
+
+        std::size_t len = field::Length::read(buf.data());
+        if (len < MinSize || len > buf.size()) return std::nullopt;
+
+        return BasicView(buf.first(len));
+    }
+
+    /* Unchecked construction, for buffers already validated elsewhere */
+    static constexpr BasicView assume_valid(std::span<const std::byte> buf) noexcept
+    {
+        return BasicView(buf);
+    }
+
+protected:
+    constexpr explicit BasicView(std::span<const std::byte> buf) noexcept : bytes_(buf) {}
+
+    std::span<const std::byte> bytes_;
+};
+
+using PacketView = BasicView<sizeof(CCSDS_PriHdr_t), sizeof(CCSDS_PriHdr_t)>;
+
+class CommandView : public BasicView<sizeof(CCSDS_CommandPacket_t), sizeof(CCSDS_CommandPacket_t)> {
+
+    using Base = BasicView<sizeof(CCSDS_CommandPacket_t), sizeof(CCSDS_CommandPacket_t)>;
+
+public:
+    static constexpr CommandView assume_valid(std::span<const std::byte> buf) noexcept
+    {
+        return CommandView(Base::assume_valid(buf));
+    }
+
+    constexpr std::uint8_t func_code() const noexcept { return get<field::FuncCode>(); }
+    constexpr std::uint8_t checksum()  const noexcept { return get<field::CheckSum>(); }
+
+    /* XOR over the whole packet is zero when valid (CCSDS_ValidCheckSum) */
+    constexpr bool valid_checksum() const noexcept
+    {
+        std::uint8_t sum = 0xFF;
+        for (std::byte b : bytes_) sum ^= std::to_integer<std::uint8_t>(b);
+        return sum == 0;
+    }
+
+    static constexpr std::optional<CommandView> parse(std::span<const std::byte> buf) noexcept
+    {
+        auto v = Base::parse(buf);
+        if (!v || v->type() != CCSDS_CMD || !v->sec_hdr()) return std::nullopt;
+        return CommandView(*v);
+    }
+
+private:
+    /* Only from a view whose type and secondary header were checked */
+    constexpr explicit CommandView(Base b) noexcept : Base(b) {}
+};
+
+class TelemetryView : public BasicView<sizeof(CCSDS_TelemetryPacket_t), sizeof(CCSDS_TelemetryPacket_t)> {
+
+    using Base = BasicView<sizeof(CCSDS_TelemetryPacket_t), sizeof(CCSDS_TelemetryPacket_t)>;
+
+public:
+    static constexpr TelemetryView assume_valid(std::span<const std::byte> buf) noexcept
+    {
+        return TelemetryView(Base::assume_valid(buf));
+    }
+
+    /* Secondary header time code, raw CCSDS_TIME_SIZE bytes */
+    constexpr std::span<const std::byte, CCSDS_TIME_SIZE> time() const noexcept
+    {
+        return bytes_.subspan<sizeof(CCSDS_PriHdr_t), CCSDS_TIME_SIZE>();
+    }
+
+    static constexpr std::optional<TelemetryView> parse(std::span<const std::byte> buf) noexcept
+    {
+        auto v = Base::parse(buf);
+        if (!v || v->type() != CCSDS_TLM || !v->sec_hdr()) return std::nullopt;
+        return TelemetryView(*v);
+    }
+
+private:
+    /* Only from a view whose type and secondary header were checked */
+    constexpr explicit TelemetryView(Base b) noexcept : Base(b) {}
+};
+
+/* Narrow a generic packet to its typed view */
+constexpr std::optional<CommandView> as_command(const PacketView &p) noexcept
+{
+    return CommandView::parse(p.bytes());
+}
+
+constexpr std::optional<TelemetryView> as_telemetry(const PacketView &p) noexcept
+{
+    return TelemetryView::parse(p.bytes());
+}
+
+}  /* namespace ccsds */
+
+#endif  /* _ccsds_hpp_ */
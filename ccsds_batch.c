@@ -0,0 +1,206 @@
+/*
+**  CCSDS Batch Header Decode - Structure of Arrays
+**
+**  Decoding is done in two passes per block: the 8 header bytes of each
+**  packet are gathered into a contiguous array of Big Endian words
+**  (AVX2 gather + byte shuffle when available), then every column is
+**  extracted from that array with plain shift/mask loops. Their trip
+**  count is a multiple of 16, which is what GCC's -O2 vectorizer (the
+**  "very cheap" cost model, no scalar epilogue allowed) needs to take
+**  them; without vector loops the batch is slower than one
+**  CCSDS_DecodeCmdHdr per packet.
+*/
+
+#include "ccsds_batch.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define CCSDS_BATCH_BLOCK  256
+
+/******************************************************************************
+**  Function:  CCSDS_GatherHdrWords()
+**
+**  Words[i] = 8 header bytes at Buf + Offsets[i] as a host order Big
+**  Endian value.
+*/
+static void CCSDS_GatherHdrWords (const uint8 *Buf, const uint64 *Offsets, uint32 N, uint64 *Words)
+{
+   uint32 i = 0;
+
+#if defined(__AVX2__)
+   const __m256i Swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                         7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+   /* Byte offsets from the buffer base are the gather indices */
+   for (; i + 4 <= N; i += 4)
+   {
+      __m256i Offs = _mm256_loadu_si256((const __m256i *)&Offsets[i]);
+      __m256i Word = _mm256_i64gather_epi64((const long long *)Buf, Offs, 1);
+      _mm256_storeu_si256((__m256i *)&Words[i], _mm256_shuffle_epi8(Word, Swap));
+   }
+#endif
+
+   for (; i < N; ++i) Words[i] = CCSDS_LoadHdrWord(Buf + Offsets[i]);
+}
+
+/******************************************************************************
+**  Function:  CCSDS_ExtractColumns()
+**
+**  The columns never overlap each other or Words; saying so (restrict)
+**  is what lets the compiler vectorize the loops instead of reloading
+**  through Cols after every store. The column loops run over whole
+**  multiples of 16 rows so they vectorize at -O2, the last N % 16 rows
+**  are done together in one scalar loop.
+*/
+static void CCSDS_ExtractColumns (const uint64 *restrict Words, uint32 N,
+                                  uint16 *restrict Apid, uint16 *restrict SeqCount, uint32 *restrict Length,
+                                  uint8 *restrict FuncCode, uint8 *restrict Type, uint8 *restrict SecHdr,
+                                  uint8 *restrict SeqFlags, uint8 *restrict Version)
+{
+   uint32 V = N & ~15u;
+   uint32 i;
+
+   for (i = 0; i < V; ++i) Apid[i]     = (uint16)((Words[i] >> 48) & 0x07FF);
+   for (i = 0; i < V; ++i) SeqCount[i] = (uint16)((Words[i] >> 32) & 0x3FFF);
+   for (i = 0; i < V; ++i) Length[i]   = (uint32)(((Words[i] >> 16) & 0xFFFF) + 7);
+   for (i = 0; i < V; ++i) FuncCode[i] = (uint8) ((Words[i] >> 8)  & 0x7F);
+   for (i = 0; i < V; ++i) Type[i]     = (uint8) ((Words[i] >> 60) & 0x01);
+   for (i = 0; i < V; ++i) SecHdr[i]   = (uint8) ((Words[i] >> 59) & 0x01);
+   for (i = 0; i < V; ++i) SeqFlags[i] = (uint8) ((Words[i] >> 46) & 0x03);
+   for (i = 0; i < V; ++i) Version[i]  = (uint8) ((Words[i] >> 61) & 0x07);
+
+   for (i = V; i < N; ++i)
+   {
+      Apid[i]     = (uint16)((Words[i] >> 48) & 0x07FF);
+      SeqCount[i] = (uint16)((Words[i] >> 32) & 0x3FFF);
+      Length[i]   = (uint32)(((Words[i] >> 16) & 0xFFFF) + 7);
+      FuncCode[i] = (uint8) ((Words[i] >> 8)  & 0x7F);
+      Type[i]     = (uint8) ((Words[i] >> 60) & 0x01);
+      SecHdr[i]   = (uint8) ((Words[i] >> 59) & 0x01);
+      SeqFlags[i] = (uint8) ((Words[i] >> 46) & 0x03);
+      Version[i]  = (uint8) ((Words[i] >> 61) & 0x07);
+   }
+}
+
+/******************************************************************************
+**  Function:  CCSDS_DecodeHdrBatch()
+*/
+uint32 CCSDS_DecodeHdrBatch (const uint8 *Buf, const uint64 *Offsets, uint32 N, CCSDS_HdrColumns_t *Cols)
+{
+   uint64  Words[CCSDS_BATCH_BLOCK];
+   uint32  Done = 0;
+   uint32  Blk;
+   uint32  Base;
+
+   if (Buf == NULL || Offsets == NULL || Cols == NULL) return 0;
+   if (N > Cols->Capacity - Cols->Count) N = Cols->Capacity - Cols->Count;
+
+   while (Done < N)
+   {
+      Blk  = (N - Done < CCSDS_BATCH_BLOCK) ? (N - Done) : CCSDS_BATCH_BLOCK;
+      Base = Cols->Count;
+
+      CCSDS_GatherHdrWords(Buf, Offsets + Done, Blk, Words);
+
+      /* One pass per column keeps each loop a single vectorizable stream */
+      CCSDS_ExtractColumns(Words, Blk, Cols->Apid + Base, Cols->SeqCount + Base, Cols->Length + Base,
+                           Cols->FuncCode + Base, Cols->Type + Base, Cols->SecHdr + Base,
+                           Cols->SeqFlags + Base, Cols->Version + Base);
+
+      Cols->Count += Blk;
+      Done        += Blk;
+   }
+
+   return N;
+}
+
+/******************************************************************************
+**  Function:  CCSDS_ApidHistogram()
+**
+**  Adds the APID column into Hist. Four sub-histograms avoid store-to-load
+**  stalls when consecutive packets share an APID; they take 32 KiB, so the
+**  caller provides them (and may reuse them across calls). With a NULL
+**  Scratch the count goes straight to Hist.
+*/
+void CCSDS_ApidHistogram (const uint16 *Apid, uint32 N, uint32 Hist[CCSDS_MAX_APID], CCSDS_HistScratch_t *Scratch)
+{
+   uint32      (*Sub)[CCSDS_MAX_APID];
+   uint32        i;
+
+   if (Scratch == NULL)
+   {
+      for (i = 0; i < N; ++i) Hist[Apid[i] & 0x07FF]++;
+      return;
+   }
+   Sub = Scratch->Sub;
+   memset(Sub, 0, sizeof(Scratch->Sub));
+
+   for (i = 0; i + 4 <= N; i += 4)
+   {
+      Sub[0][Apid[i]     & 0x07FF]++;
+      Sub[1][Apid[i + 1] & 0x07FF]++;
+      Sub[2][Apid[i + 2] & 0x07FF]++;
+      Sub[3][Apid[i + 3] & 0x07FF]++;
+   }
+   for (; i < N; ++i) Sub[0][Apid[i] & 0x07FF]++;
+
+   for (i = 0; i < CCSDS_MAX_APID; ++i) Hist[i] += Sub[0][i] + Sub[1][i] + Sub[2][i] + Sub[3][i];
+}
+
+/******************************************************************************
+**  Function:  CCSDS_SelectApid()
+**
+**  Writes the row numbers whose APID equals Sel into OutIdx (branch-free
+**  selection vector, OutIdx must hold N entries). Returns the number of
+**  rows selected.
+*/
+uint32 CCSDS_SelectApid (const uint16 *Apid, uint32 N, uint16 Sel, uint32 *OutIdx)
+{
+   uint32 Count = 0;
+   uint32 i;
+
+   for (i = 0; i < N; ++i)
+   {
+      OutIdx[Count] = i;
+      Count += (Apid[i] == Sel);
+   }
+
+   return Count;
+}
+
+/******************************************************************************
+**  Function:  CCSDS_FindSeqGaps()
+**
+**  Scans the rows of one APID (Sel) and records the row index of every
+**  packet whose sequence count does not follow the previous one (14-bit
+**  wrap). Returns the number of gaps found, which may exceed MaxGaps.
+*/
+uint32 CCSDS_FindSeqGaps (const uint16 *Apid,
+                          const uint16 *SeqCount,
+                          uint32        N,
+                          uint16        Sel,
+                          uint32       *GapIdx,
+                          uint32        MaxGaps)
+{
+   uint32 Gaps  = 0;
+   bool   First = true;
+   uint16 Expect = 0;
+   uint32 i;
+
+   for (i = 0; i < N; ++i)
+   {
+      if (Apid[i] != Sel) continue;
+
+      if (!First && SeqCount[i] != Expect)
+      {
+         if (Gaps < MaxGaps) GapIdx[Gaps] = i;
+         ++Gaps;
+      }
+      Expect = (uint16)((SeqCount[i] + 1) & 0x3FFF);
+      First  = false;
+   }
+
+   return Gaps;
+}
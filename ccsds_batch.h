@@ -0,0 +1,59 @@
+/*
+**  CCSDS Batch Header Decode - Structure of Arrays
+**  Decodes many recorded packets at once into columnar arrays so that
+**  offline analysis (histograms, gap scans, filters) runs as column scans.
+*/
+
+#ifndef _ccsds_batch_
+#define _ccsds_batch_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*----- Header columns (caller owns the arrays, each Capacity long) -----*/
+typedef struct {
+
+   uint32   Count;
+   uint32   Capacity;
+
+   uint16  *Apid;
+   uint16  *SeqCount;
+   uint32  *Length;      /* Total packet length, same as CCSDS_RD_LEN (up to 0x10006) */
+   uint8   *FuncCode;    /* Only meaningful when Type == CCSDS_CMD */
+   uint8   *Type;
+   uint8   *SecHdr;
+   uint8   *SeqFlags;
+   uint8   *Version;
+
+} CCSDS_HdrColumns_t;
+
+/*----- Sub-histograms for CCSDS_ApidHistogram (32 KiB, reusable) -----*/
+typedef struct {
+
+   uint32   Sub[4][CCSDS_MAX_APID];
+
+} CCSDS_HistScratch_t;
+
+
+/*
+** Exported Functions
+*/
+
+/* Appends the N packets at Buf + Offsets[i] to Cols (recorded packets
+   normally share one buffer: a segment, a capture). Every packet must
+   have 8 readable bytes. */
+uint32 CCSDS_DecodeHdrBatch (const uint8 *Buf, const uint64 *Offsets, uint32 N, CCSDS_HdrColumns_t *Cols);
+
+/* Column scans */
+void   CCSDS_ApidHistogram  (const uint16 *Apid, uint32 N, uint32 Hist[CCSDS_MAX_APID], CCSDS_HistScratch_t *Scratch);
+uint32 CCSDS_SelectApid     (const uint16 *Apid, uint32 N, uint16 Sel, uint32 *OutIdx);
+uint32 CCSDS_FindSeqGaps    (const uint16 *Apid,
+                             const uint16 *SeqCount,
+                             uint32        N,
+                             uint16        Sel,
+                             uint32       *GapIdx,
+                             uint32        MaxGaps);
+
+#endif  /* _ccsds_batch_ */
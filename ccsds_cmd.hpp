@@ -0,0 +1,209 @@
+/*
+**  CCSDS Command Schemas - Header-only C++20 compile-time serialization
+**
+**  A command is a plain struct that names its APID, function code and the
+**  members that make up its payload, in wire order:
+**
+**      struct SetHeater {
+**          static constexpr uint16 apid      = 0x1A5;
+**          static constexpr uint8  func_code = 0x0A;
+**
+**          uint8   heater_id;
+**          int16_t setpoint;
+**          uint32  duration_ms;
+**
+**          using fields = ccsds::Fields<&SetHeater::heater_id,
+**                                       &SetHeater::setpoint,
+**                                       &SetHeater::duration_ms>;
+**      };
+**
+**  CommandSchema<SetHeater> computes every payload offset, the Big Endian
+**  encoding of each member and the total packet length at compile time.
+**  encode() is then a fixed sequence of stores plus the checksum, and
+**  decode() reads back through the same offsets.
+*/
+
+#ifndef _ccsds_cmd_hpp_
+#define _ccsds_cmd_hpp_
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "ccsds.h"
+
+namespace ccsds {
+
+/*
+** -------------------------------------------------------------------------
+** WIRE ENCODINGS
+** Integers and enums are Big Endian two's complement, floats are IEEE 754
+** Big Endian, std::array<uint8, N> is copied as raw bytes.
+** -------------------------------------------------------------------------
+*/
+template <class T, class Enable = void>
+struct Wire;
+
+template <std::size_t N>
+using UintOf = std::conditional_t<N == 1, std::uint8_t,
+               std::conditional_t<N == 2, std::uint16_t,
+               std::conditional_t<N == 4, std::uint32_t, std::uint64_t>>>;
+
+template <class T>
+struct Wire<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>> {
+
+    static constexpr std::size_t size = sizeof(T);
+    using U = UintOf<size>;
+
+    static constexpr void store(uint8 *p, T v) noexcept
+    {
+        U u = static_cast<U>(v);
+        for (std::size_t i = 0; i < size; ++i) p[i] = static_cast<uint8>(u >> (8 * (size - 1 - i)));
+    }
+
+    static constexpr T load(const uint8 *p) noexcept
+    {
+        U u = 0;
+        for (std::size_t i = 0; i < size; ++i) u = static_cast<U>((u << 8) | p[i]);
+        return static_cast<T>(u);
+    }
+};
+
+template <class T>
+struct Wire<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+
+    static constexpr std::size_t size = sizeof(T);
+    using Bits = UintOf<size>;
+
+    static constexpr void store(uint8 *p, T v) noexcept { Wire<Bits>::store(p, std::bit_cast<Bits>(v)); }
+    static constexpr T    load (const uint8 *p) noexcept { return std::bit_cast<T>(Wire<Bits>::load(p)); }
+};
+
+template <std::size_t N>
+struct Wire<std::array<uint8, N>> {
+
+    static constexpr std::size_t size = N;
+
+    static constexpr void store(uint8 *p, const std::array<uint8, N> &v) noexcept
+    {
+        for (std::size_t i = 0; i < N; ++i) p[i] = v[i];
+    }
+
+    static constexpr std::array<uint8, N> load(const uint8 *p) noexcept
+    {
+        std::array<uint8, N> v{};
+        for (std::size_t i = 0; i < N; ++i) v[i] = p[i];
+        return v;
+    }
+};
+
+/*
+** -------------------------------------------------------------------------
+** SCHEMA
+** -------------------------------------------------------------------------
+*/
+template <auto... Members>
+struct Fields {};
+
+template <class M>
+struct MemberOf;
+
+template <class C, class T>
+struct MemberOf<T C::*> {
+    using type = T;
+};
+
+template <auto Member>
+using MemberType = typename MemberOf<decltype(Member)>::type;
+
+template <class Cmd, class FieldList = typename Cmd::fields>
+struct CommandSchema;
+
+template <class Cmd, auto... Members>
+struct CommandSchema<Cmd, Fields<Members...>> {
+
+    static constexpr std::size_t field_count  = sizeof...(Members);
+    static constexpr std::size_t header_size  = sizeof(CCSDS_CommandPacket_t);
+
+    /* Payload offset of each member, prefix sum of the wire sizes */
+    static constexpr std::array<std::size_t, field_count> offsets = [] {
+        std::array<std::size_t, field_count> off{};
+        std::size_t sizes[] = { Wire<MemberType<Members>>::size..., 0 };
+        std::size_t at = 0;
+        for (std::size_t i = 0; i < field_count; ++i) { off[i] = at; at += sizes[i]; }
+        return off;
+    }();
+
+    static constexpr std::size_t payload_size = (std::size_t{0} + ... + Wire<MemberType<Members>>::size);
+    static constexpr std::size_t total_size   = header_size + payload_size;
+
+    static_assert(total_size <= 0xFFFF, "command does not fit a Space Packet");
+    static_assert((Cmd::apid & ~0x07FF) == 0, "APID is 11 bits");
+    static_assert((Cmd::func_code & ~0x7F) == 0, "function code is 7 bits");
+
+    /* Builds the whole packet into Buf, returns total_size */
+    static uint16 encode(const Cmd &cmd, uint16 SeqCount, std::span<uint8, total_size> Buf) noexcept
+    {
+        CCSDS_CmdHdr_t Hdr = { .Length = static_cast<uint32>(total_size), .Apid = Cmd::apid, .SeqCount = SeqCount,
+                               .Version = 0, .Type = CCSDS_CMD, .SecHdr = CCSDS_HAS_SEC_HDR,
+                               .SeqFlags = CCSDS_INIT_SEQFLG, .FuncCode = Cmd::func_code,
+                               .CheckSum = CCSDS_INIT_CHECKSUM };
+
+        CCSDS_EncodeCmdHdr(Buf.data(), &Hdr);
+        store_fields(cmd, Buf.data() + header_size, std::make_index_sequence<field_count>{});
+        CCSDS_LoadCheckSum(reinterpret_cast<CCSDS_CommandPacket_t *>(Buf.data()));
+
+        return static_cast<uint16>(total_size);
+    }
+
+    /* Checked decode: length, APID, function code and checksum must match */
+    static std::optional<Cmd> decode(std::span<const uint8> Buf) noexcept
+    {
+        CCSDS_CmdHdr_t Hdr;
+
+        if (Buf.size() < total_size) return std::nullopt;
+
+        CCSDS_DecodeCmdHdr(Buf.data(), &Hdr);
+        if (Hdr.Length != total_size || Hdr.Apid != Cmd::apid || Hdr.FuncCode != Cmd::func_code) return std::nullopt;
+        if (!CCSDS_ValidCheckSum(reinterpret_cast<CCSDS_CommandPacket_t *>(const_cast<uint8 *>(Buf.data())))) return std::nullopt;
+
+        Cmd cmd{};
+        load_fields(cmd, Buf.data() + header_size, std::make_index_sequence<field_count>{});
+        return cmd;
+    }
+
+private:
+    template <std::size_t... I>
+    static constexpr void store_fields(const Cmd &cmd, uint8 *p, std::index_sequence<I...>) noexcept
+    {
+        (Wire<MemberType<Members>>::store(p + offsets[I], cmd.*Members), ...);
+    }
+
+    template <std::size_t... I>
+    static constexpr void load_fields(Cmd &cmd, const uint8 *p, std::index_sequence<I...>) noexcept
+    {
+        ((cmd.*Members = Wire<MemberType<Members>>::load(p + offsets[I])), ...);
+    }
+};
+
+/* Convenience wrappers */
+template <class Cmd>
+inline uint16 EncodeCommand(const Cmd &cmd, uint16 SeqCount, std::span<uint8, CommandSchema<Cmd>::total_size> Buf) noexcept
+{
+    return CommandSchema<Cmd>::encode(cmd, SeqCount, Buf);
+}
+
+template <class Cmd>
+inline std::optional<Cmd> DecodeCommand(std::span<const uint8> Buf) noexcept
+{
+    return CommandSchema<Cmd>::decode(Buf);
+}
+
+}  /* namespace ccsds */
+
+#endif  /* _ccsds_cmd_hpp_ */
@@ -2,8 +2,18 @@
 ** File: flight_software.c
 ** Role: RECEIVER (Spacecraft Flight Software)
 ** Description: Receives raw bytes, validates checksum, and decodes CCSDS headers.
+**
+**              With -p the work is split into a staged pipeline, one thread
+**              per stage: receive -> validate -> decode -> dispatch -> record.
+**              -W N instead steers packets by APID to N workers that each
+**              validate, decode and dispatch, keeping every APID in order.
+**              -X N moves heavy command handlers (MemLoad) off dispatch onto
+**              a work-stealing pool; -S keeps each APID's handlers in order.
+**              -C apid[:fc] marks critical commands, which the pipeline
+**              moves to a lane dispatched ahead of bulk traffic.
 */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,11 +21,54 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <ctype.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 #include "ccsds.h"
+#include "archive.h"
+#include "pcap.h"
+#include "colstore.h"
+#include "latency.h"
+#include "uring.h"
+#include "shmring.h"
+#include "pktpool.h"
+#include "ringq.h"
+#include "steer.h"
+#include "workq.h"
 
 #define LISTEN_PORT 8888
-#define BUF_SIZE    1024
+#define BUF_SIZE    65535       // Largest UDP datagram (and largest GRO run)
+
+#define RX_RING_ENTRIES  64
+#define RX_BUF_COUNT     256         // Provided buffer slots (power of two)
+#define RX_BUF_SIZE      (BUF_SIZE + 1 + 128)   // recvmsg header, source address, cmsg, datagram
+#define RX_BUF_GROUP     1
+#define RX_BATCH_MAX     256         // CQEs retired per CQ head update
+
+#define SHM_SLOTS        1024
+#define SHM_SLOT_SIZE    BUF_SIZE
+#define SHM_WAIT_NS      100000000ull   // Peek timeout, so the loop sees Ctrl-C
+
+// Packet pool per size class (256, 2 KiB, 16 KiB, 64 KiB): acks come from
+// the smallest, classic receives from the largest (a datagram or GRO run)
+#define POOL_COUNTS      { 64, 4096, 0, 16 }
+
+#define PIPE_BATCH       32          // Packets a stage takes from its queue at once
+#define PIPE_QUEUE       512         // Slots per inter-stage queue (power of two)
+#define PIPE_MTU         2048        // Pipeline receive buffers (pool class), longer datagrams are dropped
+#define PRIO_BULK_QUANTUM 4          // Bulk packets dispatch takes between looks at the critical lane
+#define SHARD_MAX        16          // Workers with -W
+#define SHARD_MAX_PINS   16          // -M apid:worker placements
+#define SHARD_POLL_MS    10          // Receive timeout, so held packets move on when traffic stops
+
+#define MEM_IMAGE_SIZE      (1u << 20)   // Memory image patched by MemLoad
+#define MEMLOAD_PROGRAM_NS  200000       // Simulated EEPROM program time per MemLoad
 
 // --- VISUALIZATION HELPER ---
 void print_byte_as_bits(uint8 byte) {
@@ -41,11 +94,1230 @@ void visualize_packet(uint8* buffer, int len) {
     printf("=================================================================\n\n");
 }
 
-int main() {
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t report_requested = 0;
+static volatile sig_atomic_t rebalance_requested = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void on_report(int sig) {
+    (void)sig;
+    report_requested = 1;
+}
+
+static void on_rebalance(int sig) {
+    (void)sig;
+    rebalance_requested = 1;
+}
+
+// --- RECEIVE BACKENDS ---
+// Classic: one recvmsg per datagram into a pool buffer. The buffer is
+// reused for the next receive unless a consumer took a reference to it.
+// io_uring: one multishot recvmsg keeps receiving into provided buffer
+// slots; each completion names the slot, the packet is processed in place
+// and the slot goes back to the kernel. Completions are retired and slots
+// republished once per batch, and the only syscall is the wait when the
+// completion queue runs dry.
+// Shared memory: the sender builds packets in the slots of an SPSC ring
+// on the same host and the packet is decoded in its slot, no socket at all.
+// With UDP_GRO the kernel may hand over one buffer holding a run of
+// same-size datagrams from one sender, with the segment size in a cmsg.
+// rx_next splits it back into the original datagrams.
+struct rx {
+    int sockfd;
+    bool uring;
+    SHM_Ring_t shm;             // Attached when Hdr != NULL
+    bool shm_held;              // Slot handed out, released on the next call
+    URING_Ring_t ring;
+    URING_BufRing_t bufs;
+    struct msghdr msg;          // Multishot template: name and control lengths only
+    uint32 batch;               // CQEs reaped in the current batch
+    uint32 next;
+    int held;                   // Slot being handed out, -1 if none
+    PKT_Pool_t *pool;
+    PKT_Cache_t cache;
+    PKT_Buf_t *cur;             // Classic receive buffer being handed out
+    uint8 *seg;                 // Rest of the current (possibly coalesced) buffer
+    uint32 seg_left;
+    uint32 seg_size;
+    struct sockaddr_in from;
+    socklen_t from_len;
+    uint64 syscalls;
+    uint64 coalesced;           // Buffers that held more than one datagram
+    uint8 control[CMSG_SPACE(sizeof(int))];
+};
+
+static bool rx_arm(struct rx *rx) {
+    struct io_uring_sqe *sqe = URING_GetSqe(&rx->ring);
+    if (sqe == NULL) return false;
+    sqe->opcode    = IORING_OP_RECVMSG;
+    sqe->fd        = rx->sockfd;
+    sqe->addr      = (uint64)(uintptr_t)&rx->msg;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RX_BUF_GROUP;
+    return true;
+}
+
+static bool rx_open(struct rx *rx, int sockfd, PKT_Pool_t *pool, bool uring, bool gro) {
+    memset(rx, 0, sizeof(*rx));
+    rx->sockfd = sockfd;
+    rx->held = -1;
+    rx->pool = pool;
+    PKT_InitCache(pool, &rx->cache);
+
+    int on = 1;
+    if (gro && setsockopt(sockfd, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0) return false;
+    if (!uring) return true;
+
+    if (!URING_Init(&rx->ring, RX_RING_ENTRIES, IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN)) return false;
+    if (!URING_SetupBufRing(&rx->ring, &rx->bufs, RX_BUF_GROUP, RX_BUF_COUNT, RX_BUF_SIZE)) {
+        URING_Close(&rx->ring);
+        return false;
+    }
+    rx->msg.msg_namelen = sizeof(struct sockaddr_in);
+    rx->msg.msg_controllen = gro ? sizeof(rx->control) : 0;
+    rx->uring = true;
+    return rx_arm(rx);
+}
+
+static bool rx_open_shm(struct rx *rx, const char *name, bool busy_poll) {
+    return SHM_Create(&rx->shm, name, SHM_SLOTS, SHM_SLOT_SIZE, busy_poll);
+}
+
+static void rx_close(struct rx *rx) {
+    if (rx->cur != NULL) PKT_Release(&rx->cache, rx->cur);
+    PKT_FlushCache(&rx->cache);
+    if (rx->shm.Hdr != NULL) SHM_Detach(&rx->shm);
+    if (!rx->uring) return;
+    URING_FreeBufRing(&rx->ring, &rx->bufs);
+    URING_Close(&rx->ring);
+}
+
+// GRO segment size from the control messages, 0 if the buffer is one datagram
+static uint32 rx_gro_size(struct msghdr *mh) {
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(mh); c != NULL; c = CMSG_NXTHDR(mh, c)) {
+        if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(c), sizeof(size));
+            return size > 0 ? (uint32)size : 0;
+        }
+    }
+    return 0;
+}
+
+// Starts handing out a received buffer, one datagram per rx_next call.
+// Boundaries come from the GRO segment size (all segments full size but
+// the last), not from the CCSDS length field: a corrupt length must cost
+// one packet, not misframe the rest of the run.
+static void rx_begin(struct rx *rx, uint8 *data, uint32 len, uint32 gro_size) {
+    rx->seg = data;
+    rx->seg_left = len;
+    rx->seg_size = (gro_size > 0 && gro_size < len) ? gro_size : len;
+    if (rx->seg_size < len) rx->coalesced++;
+}
+
+static int rx_segment(struct rx *rx, uint8 **pkt, struct sockaddr_in *from, socklen_t *from_len) {
+    uint32 n = rx->seg_left < rx->seg_size ? rx->seg_left : rx->seg_size;
+    *pkt = rx->seg;
+    rx->seg += n;
+    rx->seg_left -= n;
+    *from = rx->from;
+    *from_len = rx->from_len;
+    return (int)n;
+}
+
+// Next datagram, valid until the following call. Returns its length, or -1
+// with errno set; 0 means nothing usable arrived (the loop just goes round).
+static int rx_next(struct rx *rx, uint8 **pkt, struct sockaddr_in *from, socklen_t *from_len) {
+    if (rx->seg_left > 0) return rx_segment(rx, pkt, from, from_len);
+
+    if (rx->shm.Hdr != NULL) {
+        uint32 len;
+        if (rx->shm_held) {
+            SHM_Release(&rx->shm);
+            rx->shm_held = false;
+        }
+        *pkt = SHM_Peek(&rx->shm, &len, SHM_WAIT_NS);
+        if (*pkt == NULL) return 0;
+        rx->shm_held = true;
+        memset(from, 0, sizeof(*from));
+        from->sin_family = AF_INET;
+        from->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        *from_len = sizeof(*from);
+        return (int)len;
+    }
+
+    if (!rx->uring) {
+        if (rx->cur != NULL && __atomic_load_n(&rx->cur->RefCount, __ATOMIC_ACQUIRE) != 1) {
+            PKT_Release(&rx->cache, rx->cur);
+            rx->cur = NULL;
+        }
+        if (rx->cur == NULL) {
+            rx->cur = PKT_Alloc(rx->pool, &rx->cache, BUF_SIZE);
+            if (rx->cur == NULL) return 0;
+        }
+        struct iovec iov = { PKT_Data(rx->cur), BUF_SIZE };
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_name = &rx->from;
+        mh.msg_namelen = sizeof(rx->from);
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = rx->control;
+        mh.msg_controllen = sizeof(rx->control);
+
+        rx->syscalls++;
+        int n = (int)recvmsg(rx->sockfd, &mh, 0);
+        if (n <= 0) return n;
+        rx->from_len = mh.msg_namelen;
+        rx->cur->Length = (uint32)n;
+        rx_begin(rx, PKT_Data(rx->cur), (uint32)n, rx_gro_size(&mh));
+        return rx_segment(rx, pkt, from, from_len);
+    }
+
+    if (rx->held >= 0) {
+        URING_RecycleBuf(&rx->bufs, (uint16)rx->held);
+        rx->held = -1;
+    }
+
+    // Batch done: retire it, hand the slots back, then wait for more
+    if (rx->next == rx->batch) {
+        URING_CqAdvance(&rx->ring, rx->batch);
+        URING_PublishBufs(&rx->bufs);
+        rx->batch = rx->next = 0;
+
+        if (URING_CqReady(&rx->ring) == 0) {
+            rx->syscalls++;
+            if (URING_Submit(&rx->ring, 1) < 0) return -1;
+        }
+        rx->batch = URING_CqReady(&rx->ring);
+        if (rx->batch > RX_BATCH_MAX) rx->batch = RX_BATCH_MAX;
+        if (rx->batch == 0) return 0;
+    }
+
+    struct io_uring_cqe *cqe = URING_Cqe(&rx->ring, rx->next++);
+
+    // Multishot ends on errors and on an empty buffer ring (-ENOBUFS);
+    // slots come back as the batch is retired, so just re-arm
+    if (!(cqe->flags & IORING_CQE_F_MORE) && !rx_arm(rx)) {
+        fprintf(stderr, "[FLIGHT SOFTWARE] io_uring submission queue full\n");
+    }
+    if (cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER)) return 0;
+
+    uint16 bid = (uint16)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    uint8 *slot = URING_BufAddr(&rx->bufs, bid);
+    struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)slot;
+    rx->held = bid;
+
+    if ((uint32)cqe->res < sizeof(*out) + rx->msg.msg_namelen + rx->msg.msg_controllen) return 0;
+    memcpy(&rx->from, slot + sizeof(*out), sizeof(rx->from));
+    rx->from_len = out->namelen < sizeof(rx->from) ? out->namelen : sizeof(rx->from);
+
+    // The control data sits after the name, parse it through a msghdr view
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_control = slot + sizeof(*out) + rx->msg.msg_namelen;
+    mh.msg_controllen = out->controllen;
+    uint32 gro_size = out->controllen > 0 ? rx_gro_size(&mh) : 0;
+
+    // The slot always holds the full datagram (or GRO run, at most 64 KiB)
+    rx_begin(rx, slot + sizeof(*out) + rx->msg.msg_namelen + rx->msg.msg_controllen, out->payloadlen, gro_size);
+    return rx_segment(rx, pkt, from, from_len);
+}
+
+// User + system CPU time since start
+static double cpu_ns_since(const struct rusage *start) {
+    struct rusage now;
+    getrusage(RUSAGE_SELF, &now);
+    return (double)(now.ru_utime.tv_sec - start->ru_utime.tv_sec + now.ru_stime.tv_sec - start->ru_stime.tv_sec) * 1e9 +
+           (double)(now.ru_utime.tv_usec - start->ru_utime.tv_usec + now.ru_stime.tv_usec - start->ru_stime.tv_usec) * 1e3;
+}
+
+// --- LATENCY STAGES ---
+// LAT_CRITICAL repeats validated -> dispatched for the critical lane only
+enum { LAT_BUILD_SEND, LAT_SEND_RECV, LAT_RECV_VALID, LAT_VALID_DISPATCH, LAT_END_TO_END, LAT_CRITICAL, LAT_NUM_STAGES };
+
+static const char *lat_stage_names[LAT_NUM_STAGES] = {
+    "build -> send", "send -> receive", "receive -> validated", "validated -> dispatched", "build -> dispatched",
+    "  critical lane"
+};
+
+static LAT_Hist_t lat_hists[LAT_NUM_STAGES];
+
+static void report_latency(void) {
+    printf("\n   [LATENCY] Uplink stage latencies\n");
+    for (int i = 0; i < LAT_NUM_STAGES; i++) {
+        if (i == LAT_CRITICAL && __atomic_load_n(&lat_hists[i].Total, __ATOMIC_ACQUIRE) == 0) continue;
+        LAT_Report(stdout, lat_stage_names[i], &lat_hists[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// --- COMMAND HANDLERS ---
+// Looked up by APID and function code (commands.csv, big-endian fields).
+// Cheap handlers run inline wherever the command is dispatched. Heavy ones
+// (MemLoad, which waits out the program time and verifies) go to the
+// executor when the pipeline has one (-X), so they never hold up dispatch.
+static struct {
+    uint64 noops;
+    int16_t heater_setpoint[256];
+    float gain[256];
+    uint64 memloads;
+    uint64 memload_rejects;     // Out of range or short
+    uint64 memload_verify_fails;  // Read back differed: an overlapping load ran concurrently
+} fsw;
+
+static uint8 mem_image[MEM_IMAGE_SIZE];
+
+static uint32 be32(const uint8 *p) {
+    return (uint32)p[0] << 24 | (uint32)p[1] << 16 | (uint32)p[2] << 8 | p[3];
+}
+
+static void handle_noop(const uint8 *payload, uint32 len) {
+    (void)payload;
+    (void)len;
+    __atomic_fetch_add(&fsw.noops, 1, __ATOMIC_RELAXED);
+}
+
+static void handle_set_heater(const uint8 *payload, uint32 len) {
+    if (len >= 3) fsw.heater_setpoint[payload[0]] = (int16_t)(payload[1] << 8 | payload[2]);
+}
+
+static void handle_set_gain(const uint8 *payload, uint32 len) {
+    if (len >= 5) {
+        uint32 bits = be32(payload + 1);
+        memcpy(&fsw.gain[payload[0]], &bits, sizeof(float));
+    }
+}
+
+static void handle_memload(const uint8 *payload, uint32 len) {
+    if (len < 4 || be32(payload) > MEM_IMAGE_SIZE || len - 4 > MEM_IMAGE_SIZE - be32(payload)) {
+        __atomic_fetch_add(&fsw.memload_rejects, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    uint32 address = be32(payload);
+    memcpy(mem_image + address, payload + 4, len - 4);
+
+    struct timespec program = { 0, MEMLOAD_PROGRAM_NS };
+    nanosleep(&program, NULL);
+    if (memcmp(mem_image + address, payload + 4, len - 4) != 0) {
+        __atomic_fetch_add(&fsw.memload_verify_fails, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&fsw.memloads, 1, __ATOMIC_RELAXED);
+}
+
+struct handler {
+    uint16 apid;
+    uint8 func_code;
+    bool heavy;
+    void (*run)(const uint8 *payload, uint32 len);
+};
+
+static const struct handler handlers[] = {
+    { 0x1A5, 0x00, false, handle_noop },
+    { 0x1A5, 0x0A, false, handle_set_heater },
+    { 0x1A6, 0x02, false, handle_set_gain },
+    { 0x1B0, 0x10, true,  handle_memload },
+};
+
+static const struct handler *handler_find(uint16 apid, uint8 func_code) {
+    for (size_t i = 0; i < sizeof(handlers) / sizeof(handlers[0]); i++) {
+        if (handlers[i].apid == apid && handlers[i].func_code == func_code) return &handlers[i];
+    }
+    return NULL;
+}
+
+// --- STAGED PIPELINE (-p) ---
+// One thread per stage (pinned one per core when there are enough cores),
+// linked by bounded queues of pool buffer handles; the bytes stay where
+// they were received. Each stage takes up to PIPE_BATCH packets at a time.
+// Validate, decode and dispatch wait while the next queue is full
+// (backpressure). The receive stage never waits: if validate falls behind
+// it sheds what does not fit and counts it, so the socket keeps draining.
+// Packets failing the checksum skip decode and dispatch and go straight to
+// record, so record has two producers (MPMC queue) and archives them ahead
+// of valid packets still in flight.
+//
+// Sharded (-W N): the receive stage steers each packet by APID to one of N
+// workers, which validate, decode and dispatch it and pass it to record.
+// One worker owns an APID at a time (see steer.h), so every APID is
+// dispatched in arrival order however the kernel spread the senders. The
+// hottest APID on the busiest worker can be moved off it with
+// kill -USR2 <pid>; -M apid:worker places APIDs up front.
+//
+// Handler executor (-X N, with -p or -W): heavy handlers run on a
+// work-stealing pool of N threads and the packet goes to record from there.
+// Their completion order is free unless -S, which gives every APID a strand
+// so its handlers run one at a time in dispatch order. Under -S a light
+// handler also goes through the strand while the APID has heavy work
+// queued, so it cannot overtake it.
+//
+// Priority lanes (-C apid[:fc], with -p): validate classifies each valid
+// packet and critical ones travel a second pair of queues that decode and
+// dispatch always drain first. Dispatch takes at most PRIO_BULK_QUANTUM
+// bulk packets between looks at the critical lane, so a critical packet
+// waits for at most that many bulk handlers. To keep the bound, validate
+// and decode never wait on a full bulk queue: validate sheds the bulk
+// packets that do not fit (counted), decode only takes what fits. Classes
+// by function code let a command overtake earlier packets of its APID,
+// which the order check then counts.
+enum { PIPE_RECEIVE, PIPE_VALIDATE, PIPE_DECODE, PIPE_DISPATCH, PIPE_RECORD, PIPE_NUM_STAGES };
+
+static const char *pipe_stage_names[PIPE_NUM_STAGES] = { "receive", "validate", "decode", "dispatch", "record" };
+
+// Per-packet metadata in the pool buffer header
+#define PIPE_RX_NS(b)     ((b)->User[0])
+#define PIPE_FROM(b)      ((b)->User[1])   // IPv4 address << 16 | port, network order
+#define PIPE_VALID_NS(b)  ((b)->User[2])   // 0 when the checksum failed
+#define PIPE_HDR(b)       ((b)->User[3])   // APID, sequence, length, function code
+
+struct pipe_stage {
+    pthread_t thread;
+    uint64 batches;
+    uint64 packets;
+    bool done;                  // Finished, nothing more goes into its output queues
+} __attribute__((aligned(64)));
+
+struct exec_job {
+    WQ_Task_t task;             // First member: Run recovers the job from it
+    PKT_Buf_t *buf;
+    const struct handler *h;
+    struct pipe *p;
+};
+
+struct shard_worker {
+    struct pipe_stage stage;
+    RQ_Spsc_t in;
+    uint64 done;                // Packets finished, read by the steering stage
+    struct pipe *p;
+} __attribute__((aligned(64)));
+
+struct pipe {
+    PKT_Pool_t *pool;
+    RQ_Spsc_t to_validate;
+    RQ_Spsc_t to_decode;
+    RQ_Spsc_t to_dispatch;
+    RQ_Spsc_t to_decode_critical;
+    RQ_Spsc_t to_dispatch_critical;
+    RQ_Mpmc_t to_record;        // From validate (failed) and dispatch
+    struct pipe_stage stage[PIPE_NUM_STAGES];
+    uint64 shed;                // Dropped at receive, validate queue full
+    uint64 no_buffer;           // Dropped at receive, pool empty
+    uint64 oversize;            // Dropped at receive, longer than PIPE_MTU
+    uint64 invalid;
+    uint64 bulk_shed;           // Dropped at validate, bulk lane full (lanes only)
+    bool lanes;                 // Any critical class configured
+    uint8 critical[STEER_NUM_APIDS][16];   // Bit per function code
+    uint64 out_of_order;        // Dispatched behind a later packet of the same APID
+    uint32 feeders;             // Threads still passing packets to record
+    uint32 last_seq[STEER_NUM_APIDS];   // Sequence + 1 of each APID's last dispatch, 0 none
+    uint32 num_workers;         // Sharded when > 0
+    struct shard_worker workers[SHARD_MAX];
+    const uint64 *done[STEER_MAX_WORKERS];
+    STEER_Table_t steer;
+    WQ_Pool_t *exec;            // NULL: all handlers run inline
+    uint32 exec_threads;
+    bool serialize;
+    struct exec_job *jobs;      // One per pool buffer, by buffer index
+    uint64 handled_inline;
+    uint64 offloaded;
+    WQ_Strand_t strands[STEER_NUM_APIDS];
+    bool quiet;
+    bool latency;
+    ARC_Writer_t *archive;
+    PCAP_Writer_t *capture;
+    COL_Store_t *store;
+    const struct sockaddr_in *local;
+};
+
+static void pipe_idle(uint32 *idle) {
+    if (++*idle < 64) {
+        CCSDS_CpuRelax();
+    } else if (*idle < 1024) {
+        sched_yield();
+    } else {
+        struct timespec ts = { 0, 50000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Next batch from the input queue, waiting while it is empty; 0 once the
+// upstream stage has finished and the queue is drained
+static uint32 pipe_take(RQ_Spsc_t *in, const struct pipe_stage *up, struct pipe_stage *self, PKT_Buf_t **batch) {
+    for (uint32 idle = 0;;) {
+        bool up_done = __atomic_load_n(&up->done, __ATOMIC_ACQUIRE);
+        uint32 n = RQ_SpscPop(in, (void **)batch, PIPE_BATCH);
+        if (n > 0) {
+            self->batches++;
+            self->packets += n;
+            return n;
+        }
+        if (up_done) return 0;
+        pipe_idle(&idle);
+    }
+}
+
+// As pipe_take, but from the critical lane whenever it has packets, else
+// at most bulk_max from the bulk lane; also no more than still fits in
+// bulk_out if given. A batch is all from one lane, *from_critical says which.
+static uint32 pipe_take_lanes(RQ_Spsc_t *critical, RQ_Spsc_t *bulk, uint32 bulk_max, const RQ_Spsc_t *bulk_out,
+                              const struct pipe_stage *up, struct pipe_stage *self, PKT_Buf_t **batch,
+                              bool *from_critical) {
+    for (uint32 idle = 0;;) {
+        bool up_done = __atomic_load_n(&up->done, __ATOMIC_ACQUIRE);
+        uint32 n = RQ_SpscPop(critical, (void **)batch, PIPE_BATCH);
+        *from_critical = (n > 0);
+        if (n == 0) {
+            uint32 max = bulk_max < PIPE_BATCH ? bulk_max : PIPE_BATCH;
+            if (bulk_out != NULL && PIPE_QUEUE - RQ_SpscDepth(bulk_out) < max) max = PIPE_QUEUE - RQ_SpscDepth(bulk_out);
+            if (max > 0) n = RQ_SpscPop(bulk, (void **)batch, max);
+        }
+        if (n > 0) {
+            self->batches++;
+            self->packets += n;
+            return n;
+        }
+        if (up_done && RQ_SpscDepth(critical) == 0 && RQ_SpscDepth(bulk) == 0) return 0;
+        pipe_idle(&idle);
+    }
+}
+
+// Hands the whole batch on, waiting while the next queue is full
+static void pipe_give(RQ_Spsc_t *out, PKT_Buf_t **batch, uint32 n) {
+    uint32 idle = 0;
+    for (uint32 sent = 0; sent < n;) {
+        uint32 k = RQ_SpscPush(out, (void *const *)(batch + sent), n - sent);
+        sent += k;
+        if (k == 0) pipe_idle(&idle);
+    }
+}
+
+static void pipe_give_record(struct pipe *p, PKT_Buf_t *b) {
+    uint32 idle = 0;
+    while (!RQ_MpmcPush(&p->to_record, b)) pipe_idle(&idle);
+}
+
+static void pipe_finish(struct pipe_stage *self) {
+    __atomic_store_n(&self->done, true, __ATOMIC_RELEASE);
+}
+
+// A whole command in the n bytes received: the checksum and decode walk
+// CCSDS_RD_LEN bytes, and a GRO segment or short datagram may hold less
+static bool pkt_complete(const uint8 *buf, uint32 n) {
+    return n >= sizeof(CCSDS_CommandPacket_t) && (uint32)CCSDS_RD_LEN(*(const CCSDS_PriHdr_t *)buf) <= n;
+}
+
+// Per-packet work, shared by the stage threads and the shard workers
+static bool pipe_check(struct pipe *p, PKT_Buf_t *b) {
+    if (pkt_complete(PKT_Data(b), b->Length) && CCSDS_ValidCheckSum((CCSDS_CommandPacket_t *)PKT_Data(b))) {
+        PIPE_VALID_NS(b) = LAT_NowNs();
+        return true;
+    }
+    PIPE_VALID_NS(b) = 0;
+    __atomic_fetch_add(&p->invalid, 1, __ATOMIC_RELAXED);
+    if (!p->quiet && b->Length >= sizeof(CCSDS_CommandPacket_t)) {
+        printf("   [-] Integrity Check: FAILED! Dropping packet.\n");
+    }
+    return false;
+}
+
+static bool pipe_is_critical(const struct pipe *p, uint16 apid, uint8 func_code) {
+    return (p->critical[apid & (STEER_NUM_APIDS - 1)][(func_code & 0x7F) >> 3] >> (func_code & 7)) & 1;
+}
+
+// True for a critical packet; after pipe_check, before decode
+static bool pipe_classify(const struct pipe *p, PKT_Buf_t *b) {
+    const CCSDS_CommandPacket_t *pkt = (const CCSDS_CommandPacket_t *)PKT_Data(b);
+    return pipe_is_critical(p, (uint16)CCSDS_RD_APID(pkt->SpacePacket.Hdr), pkt->Sec.Command[0]);
+}
+
+static void pipe_decode_one(PKT_Buf_t *b) {
+    CCSDS_CmdHdr_t hdr;
+    CCSDS_DecodeCmdHdr(PKT_Data(b), &hdr);
+    PIPE_HDR(b) = (uint64)hdr.Apid << 48 | (uint64)hdr.SeqCount << 32 | (uint64)hdr.Length << 16 | hdr.FuncCode;
+}
+
+static void exec_run(WQ_Task_t *task) {
+    struct exec_job *job = (struct exec_job *)task;
+    PKT_Buf_t *b = job->buf;
+
+    job->h->run(PKT_Data(b) + sizeof(CCSDS_CommandPacket_t), b->Length - (uint32)sizeof(CCSDS_CommandPacket_t));
+    pipe_give_record(job->p, b);
+}
+
+// Runs the command's handler, or queues it on the executor; true if the
+// executor now owns the buffer (and passes it to record)
+static bool pipe_handle(struct pipe *p, PKT_Buf_t *b) {
+    uint64 hdr = PIPE_HDR(b);
+    uint16 apid = (uint16)(hdr >> 48);
+    const struct handler *h = handler_find(apid, (uint8)hdr);
+    WQ_Strand_t *strand = &p->strands[apid & (STEER_NUM_APIDS - 1)];
+
+    if (h == NULL) return false;
+    bool queue_behind = p->serialize && __atomic_load_n(&strand->Pending, __ATOMIC_ACQUIRE) != 0;
+    if (p->exec == NULL || (!h->heavy && !queue_behind)) {
+        h->run(PKT_Data(b) + sizeof(CCSDS_CommandPacket_t), b->Length - (uint32)sizeof(CCSDS_CommandPacket_t));
+        __atomic_fetch_add(&p->handled_inline, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    struct exec_job *job = &p->jobs[b->Index];
+    job->task.Run = exec_run;
+    job->buf = b;
+    job->h = h;
+    job->p = p;
+    __atomic_fetch_add(&p->offloaded, 1, __ATOMIC_RELAXED);
+    if (p->serialize) WQ_SubmitStrand(strand, &job->task);
+    else              WQ_Submit(p->exec, &job->task);
+    return true;
+}
+
+// True if the handler took the buffer
+static bool pipe_dispatch_one(struct pipe *p, PKT_Buf_t *b) {
+    uint8 *buffer = PKT_Data(b);
+    uint64 hdr = PIPE_HDR(b);
+    uint16 rcv_apid = (uint16)(hdr >> 48);
+    uint16 rcv_seq = (uint16)(hdr >> 32);
+    uint32 payload_len = b->Length - (uint32)sizeof(CCSDS_CommandPacket_t);
+
+    // Only the APID's owner writes its entry. A step back of less than half
+    // the 14-bit sequence space is a reorder; a step forward may be a loss.
+    uint32 last = p->last_seq[rcv_apid];
+    if (last != 0 && ((rcv_seq - (last - 1)) & 0x3FFF) >= 0x2000) {
+        __atomic_fetch_add(&p->out_of_order, 1, __ATOMIC_RELAXED);
+    }
+    p->last_seq[rcv_apid] = (uint32)rcv_seq + 1;
+
+    if (!p->quiet) {
+        char *payload_str = (char *)(buffer + sizeof(CCSDS_CommandPacket_t));
+        flockfile(stdout);
+        visualize_packet(buffer, (int)b->Length);
+        printf("   [CCSDS DECODER ENGINE]\n");
+        printf("   [+] Integrity Check: PASSED (Valid Checksum)\n");
+        printf("   [+] Packet Details:\n");
+        printf("       - Application ID: 0x%03X (%d)\n", rcv_apid, rcv_apid);
+        printf("       - Sequence Count: %d\n", rcv_seq);
+        printf("       - Total Length:   %d bytes\n", (int)(uint16)(hdr >> 16));
+        printf("       - Function Code:  0x%02X\n", (unsigned)(uint8)hdr);
+        printf("   [+] Payload Content: \"%.*s\"\n", (int)strnlen(payload_str, payload_len), payload_str);
+        printf("   [+] Action: Dispatching to Application %d...\n", rcv_apid);
+        funlockfile(stdout);
+    }
+
+    LAT_Stamp_t stamp;
+    if (p->latency && payload_len >= sizeof(stamp)) {
+        uint64 dispatch_ns = LAT_NowNs();
+        memcpy(&stamp, buffer + b->Length - sizeof(stamp), sizeof(stamp));
+        if (stamp.Magic == LAT_STAMP_MAGIC) {
+            LAT_Record(&lat_hists[LAT_BUILD_SEND], stamp.SendNs - stamp.BuildNs);
+            LAT_Record(&lat_hists[LAT_SEND_RECV], PIPE_RX_NS(b) - stamp.SendNs);
+            LAT_Record(&lat_hists[LAT_RECV_VALID], PIPE_VALID_NS(b) - PIPE_RX_NS(b));
+            LAT_Record(&lat_hists[LAT_VALID_DISPATCH], dispatch_ns - PIPE_VALID_NS(b));
+            LAT_Record(&lat_hists[LAT_END_TO_END], dispatch_ns - stamp.BuildNs);
+            if (p->lanes && pipe_is_critical(p, rcv_apid, (uint8)hdr)) {
+                LAT_Record(&lat_hists[LAT_CRITICAL], dispatch_ns - PIPE_VALID_NS(b));
+            }
+        }
+    }
+    return pipe_handle(p, b);
+}
+
+static void pipe_feeder_done(struct pipe *p) {
+    __atomic_sub_fetch(&p->feeders, 1, __ATOMIC_RELEASE);
+}
+
+static void *pipe_validate(void *arg) {
+    struct pipe *p = arg;
+    PKT_Buf_t *batch[PIPE_BATCH], *valid[PIPE_BATCH], *critical[PIPE_BATCH];
+    uint32 n;
+
+    while ((n = pipe_take(&p->to_validate, &p->stage[PIPE_RECEIVE], &p->stage[PIPE_VALIDATE], batch)) > 0) {
+        uint32 nvalid = 0, ncritical = 0;
+        for (uint32 i = 0; i < n; i++) {
+            if (!pipe_check(p, batch[i])) {
+                pipe_give_record(p, batch[i]);
+            } else if (p->lanes && pipe_classify(p, batch[i])) {
+                critical[ncritical++] = batch[i];
+            } else {
+                valid[nvalid++] = batch[i];
+            }
+        }
+        if (!p->lanes) {
+            pipe_give(&p->to_decode, valid, nvalid);
+            continue;
+        }
+        pipe_give(&p->to_decode_critical, critical, ncritical);
+        uint32 pushed = RQ_SpscPush(&p->to_decode, (void *const *)valid, nvalid);
+        for (uint32 i = pushed; i < nvalid; i++) PKT_Release(NULL, valid[i]);
+        if (pushed < nvalid) __atomic_fetch_add(&p->bulk_shed, nvalid - pushed, __ATOMIC_RELAXED);
+    }
+    pipe_finish(&p->stage[PIPE_VALIDATE]);
+    pipe_feeder_done(p);
+    return NULL;
+}
+
+static void *pipe_decode(void *arg) {
+    struct pipe *p = arg;
+    PKT_Buf_t *batch[PIPE_BATCH];
+    uint32 n;
+
+    bool critical;
+
+    // Bulk only as far as it fits downstream, so decode never waits behind it
+    while ((n = pipe_take_lanes(&p->to_decode_critical, &p->to_decode, PIPE_BATCH, &p->to_dispatch,
+                                &p->stage[PIPE_VALIDATE], &p->stage[PIPE_DECODE], batch, &critical)) > 0) {
+        for (uint32 i = 0; i < n; i++) pipe_decode_one(batch[i]);
+        pipe_give(critical ? &p->to_dispatch_critical : &p->to_dispatch, batch, n);
+    }
+    pipe_finish(&p->stage[PIPE_DECODE]);
+    return NULL;
+}
+
+static void *pipe_dispatch(void *arg) {
+    struct pipe *p = arg;
+    PKT_Buf_t *batch[PIPE_BATCH];
+    uint32 n;
+
+    uint32 quantum = p->lanes ? PRIO_BULK_QUANTUM : PIPE_BATCH;
+    bool critical;
+
+    while ((n = pipe_take_lanes(&p->to_dispatch_critical, &p->to_dispatch, quantum, NULL, &p->stage[PIPE_DECODE],
+                                &p->stage[PIPE_DISPATCH], batch, &critical)) > 0) {
+        for (uint32 i = 0; i < n; i++) {
+            if (!pipe_dispatch_one(p, batch[i])) pipe_give_record(p, batch[i]);
+        }
+    }
+    pipe_finish(&p->stage[PIPE_DISPATCH]);
+    pipe_feeder_done(p);
+    return NULL;
+}
+
+// Shard worker: the validate, decode and dispatch stages in one thread,
+// for the APIDs the steering table gives it
+static void *shard_run(void *arg) {
+    struct shard_worker *w = arg;
+    struct pipe *p = w->p;
+    PKT_Buf_t *batch[PIPE_BATCH];
+    uint32 n;
+
+    while ((n = pipe_take(&w->in, &p->stage[PIPE_RECEIVE], &w->stage, batch)) > 0) {
+        for (uint32 i = 0; i < n; i++) {
+            if (pipe_check(p, batch[i])) {
+                pipe_decode_one(batch[i]);
+                if (pipe_dispatch_one(p, batch[i])) continue;
+            }
+            pipe_give_record(p, batch[i]);
+        }
+        // Dispatched: the steering stage may now move these APIDs elsewhere
+        __atomic_store_n(&w->done, w->done + n, __ATOMIC_RELEASE);
+    }
+    pipe_finish(&w->stage);
+    pipe_feeder_done(p);
+    return NULL;
+}
+
+static void *pipe_record(void *arg) {
+    struct pipe *p = arg;
+    struct pipe_stage *self = &p->stage[PIPE_RECORD];
+    PKT_Buf_t *batch[PIPE_BATCH];
+    PKT_Cache_t cache;
+    uint32 idle = 0;
+
+    PKT_InitCache(p->pool, &cache);
+    for (;;) {
+        bool up_done = __atomic_load_n(&p->feeders, __ATOMIC_ACQUIRE) == 0;
+        uint32 n = 0;
+        while (n < PIPE_BATCH && RQ_MpmcPop(&p->to_record, (void **)&batch[n])) n++;
+        if (n == 0) {
+            if (up_done) break;
+            pipe_idle(&idle);
+            continue;
+        }
+        idle = 0;
+        self->batches++;
+        self->packets += n;
+
+        for (uint32 i = 0; i < n; i++) {
+            PKT_Buf_t *b = batch[i];
+            if (p->archive != NULL) ARC_Append(p->archive, PKT_Data(b), (uint16)b->Length, ARC_TimeNowNs());
+            if (p->capture != NULL) {
+                struct sockaddr_in from;
+                memset(&from, 0, sizeof(from));
+                from.sin_family = AF_INET;
+                from.sin_addr.s_addr = (uint32)(PIPE_FROM(b) >> 16);
+                from.sin_port = (uint16)PIPE_FROM(b);
+                PCAP_WriteUdp(p->capture, ARC_TimeNowNs(), &from, p->local, PKT_Data(b), (uint16)b->Length);
+            }
+            if (p->store != NULL && PIPE_VALID_NS(b) != 0) {
+                uint64 hdr = PIPE_HDR(b);
+                COL_Append(p->store, ARC_TimeNowNs(), (uint16)(hdr >> 48), (uint16)(hdr >> 32),
+                           PKT_Data(b) + sizeof(CCSDS_CommandPacket_t),
+                           (uint16)(b->Length - sizeof(CCSDS_CommandPacket_t)));
+            }
+            PKT_Release(&cache, b);
+        }
+    }
+    PKT_FlushCache(&cache);
+    pipe_finish(self);
+    return NULL;
+}
+
+static void shard_report(struct pipe *p) {
+    RQ_Stats_t st;
+
+    printf("\n   [SHARDS] %-8s %12s %10s %8s %8s %10s %6s\n", "worker", "packets", "per batch", "depth", "max", "full", "APIDs");
+    for (uint32 w = 0; w < p->num_workers; w++) {
+        struct shard_worker *sw = &p->workers[w];
+        uint64 batches = __atomic_load_n(&sw->stage.batches, __ATOMIC_RELAXED);
+        uint64 packets = __atomic_load_n(&sw->stage.packets, __ATOMIC_RELAXED);
+        uint32 apids = 0;
+        for (uint32 a = 0; a < STEER_NUM_APIDS; a++) apids += (p->steer.Owner[a] == w);
+        RQ_SpscStats(&sw->in, &st);
+        printf("   [SHARDS] %-8u %12llu %10.1f %8u %8llu %10llu %6u\n", w, (unsigned long long)packets,
+               batches ? (double)packets / batches : 0.0, RQ_SpscDepth(&sw->in),
+               (unsigned long long)st.MaxDepth, (unsigned long long)st.Full, apids);
+    }
+    printf("   [SHARDS] %llu APID moves, %llu held packets dropped, %llu dispatched out of order\n",
+           (unsigned long long)p->steer.Moves, (unsigned long long)p->steer.HoldOverflows,
+           (unsigned long long)__atomic_load_n(&p->out_of_order, __ATOMIC_RELAXED));
+}
+
+static void exec_report(struct pipe *p) {
+    printf("\n   [EXECUTOR] handlers: %llu inline, %llu offloaded to %u threads%s\n",
+           (unsigned long long)__atomic_load_n(&p->handled_inline, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&p->offloaded, __ATOMIC_RELAXED), p->exec->NumWorkers,
+           p->serialize ? " (serialized per APID)" : "");
+    for (uint32 i = 0; i < p->exec->NumWorkers; i++) {
+        printf("   [EXECUTOR] thread %-3u %12llu tasks, %10llu stolen\n", i,
+               (unsigned long long)__atomic_load_n(&p->exec->Workers[i].Executed, __ATOMIC_RELAXED),
+               (unsigned long long)__atomic_load_n(&p->exec->Workers[i].Stolen, __ATOMIC_RELAXED));
+    }
+    printf("   [EXECUTOR] %llu memory loads, %llu rejected, %llu failed verify\n",
+           (unsigned long long)__atomic_load_n(&fsw.memloads, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&fsw.memload_rejects, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&fsw.memload_verify_fails, __ATOMIC_RELAXED));
+}
+
+static void pipe_report(struct pipe *p) {
+    if (p->num_workers > 0) shard_report(p);
+    if (p->exec != NULL) exec_report(p);
+
+    struct { const char *name; RQ_Stats_t st; uint32 depth; bool critical; } q[6] = {
+        { "receive -> validate", {0}, RQ_SpscDepth(&p->to_validate), false },
+        { "validate -> decode", {0}, RQ_SpscDepth(&p->to_decode), false },
+        { "  critical lane", {0}, RQ_SpscDepth(&p->to_decode_critical), true },
+        { "decode -> dispatch", {0}, RQ_SpscDepth(&p->to_dispatch), false },
+        { "  critical lane", {0}, RQ_SpscDepth(&p->to_dispatch_critical), true },
+        { "-> record", {0}, RQ_MpmcDepth(&p->to_record), false },
+    };
+    RQ_SpscStats(&p->to_validate, &q[0].st);
+    RQ_SpscStats(&p->to_decode, &q[1].st);
+    RQ_SpscStats(&p->to_decode_critical, &q[2].st);
+    RQ_SpscStats(&p->to_dispatch, &q[3].st);
+    RQ_SpscStats(&p->to_dispatch_critical, &q[4].st);
+    RQ_MpmcStats(&p->to_record, &q[5].st);
+
+    printf("\n   [PIPELINE] %-22s %8s %8s %12s %12s\n", "queue", "depth", "max", "pushed", "full");
+    for (int i = p->num_workers > 0 ? 5 : 0; i < 6; i++) {
+        if (q[i].critical && !p->lanes) continue;
+        printf("   [PIPELINE] %-22s %8u %8llu %12llu %12llu\n", q[i].name, q[i].depth,
+               (unsigned long long)q[i].st.MaxDepth, (unsigned long long)q[i].st.Pushed,
+               (unsigned long long)q[i].st.Full);
+    }
+    for (int i = 0; i < PIPE_NUM_STAGES; i++) {
+        if (p->num_workers > 0 && i != PIPE_RECEIVE && i != PIPE_RECORD) continue;
+        uint64 batches = __atomic_load_n(&p->stage[i].batches, __ATOMIC_RELAXED);
+        uint64 packets = __atomic_load_n(&p->stage[i].packets, __ATOMIC_RELAXED);
+        printf("   [PIPELINE] stage %-16s %12llu packets, %.1f per batch\n", pipe_stage_names[i],
+               (unsigned long long)packets, batches ? (double)packets / batches : 0.0);
+    }
+    printf("   [PIPELINE] dropped at receive: %llu shed (next queue full), %llu no buffer, %llu oversize; %llu failed checksum\n",
+           (unsigned long long)__atomic_load_n(&p->shed, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&p->no_buffer, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&p->oversize, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&p->invalid, __ATOMIC_RELAXED));
+    if (p->lanes) {
+        printf("   [PIPELINE] dropped at validate: %llu bulk shed (bulk lane full)\n",
+               (unsigned long long)__atomic_load_n(&p->bulk_shed, __ATOMIC_RELAXED));
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void pipe_pin(pthread_t thread, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+// Pins: pairs of APID and worker for -M, applied before any traffic
+static bool pipe_start(struct pipe *p, const uint32 (*pins)[2], uint32 num_pins) {
+    static void *(*const fn[PIPE_NUM_STAGES])(void *) = { NULL, pipe_validate, pipe_decode, pipe_dispatch, pipe_record };
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    sigset_t all, old;
+
+    if (!RQ_SpscInit(&p->to_validate, PIPE_QUEUE) || !RQ_SpscInit(&p->to_decode, PIPE_QUEUE) ||
+        !RQ_SpscInit(&p->to_dispatch, PIPE_QUEUE) || !RQ_MpmcInit(&p->to_record, PIPE_QUEUE) ||
+        !RQ_SpscInit(&p->to_decode_critical, PIPE_QUEUE) || !RQ_SpscInit(&p->to_dispatch_critical, PIPE_QUEUE)) {
+        return false;
+    }
+    if (p->num_workers > 0) {
+        if (!STEER_Init(&p->steer, p->num_workers)) return false;
+        for (uint32 w = 0; w < p->num_workers; w++) {
+            p->workers[w].p = p;
+            p->done[w] = &p->workers[w].done;
+            if (!RQ_SpscInit(&p->workers[w].in, PIPE_QUEUE)) return false;
+        }
+        for (uint32 i = 0; i < num_pins; i++) {
+            if (pins[i][1] >= p->num_workers) return false;
+            STEER_Move(&p->steer, (uint16)pins[i][0], pins[i][1], p->done);
+        }
+    }
+    p->feeders = p->num_workers > 0 ? p->num_workers : 2;
+    if (p->exec != NULL) {
+        // Every pipeline buffer is the same class, so its index picks the job
+        uint32 max_bufs = 0;
+        for (int c = 0; c < PKT_NUM_CLASSES; c++) {
+            if (p->pool->Classes[c].Count > max_bufs) max_bufs = p->pool->Classes[c].Count;
+        }
+        p->jobs = calloc(max_bufs, sizeof(*p->jobs));
+        if (p->jobs == NULL) return false;
+        for (uint32 a = 0; a < STEER_NUM_APIDS; a++) WQ_InitStrand(p->exec, &p->strands[a]);
+        p->feeders++;
+    }
+
+    // Signals stay with the receive stage (this thread), so Ctrl-C interrupts its recvmmsg
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = PIPE_VALIDATE; i < PIPE_NUM_STAGES; i++) {
+        if (p->num_workers > 0 && i != PIPE_RECORD) continue;
+        if (pthread_create(&p->stage[i].thread, NULL, fn[i], p) != 0) return false;
+    }
+    for (uint32 w = 0; w < p->num_workers; w++) {
+        if (pthread_create(&p->workers[w].stage.thread, NULL, shard_run, &p->workers[w]) != 0) return false;
+    }
+    if (p->exec != NULL && !WQ_Init(p->exec, p->exec_threads)) return false;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    // A core per thread when there are enough, otherwise leave it to the scheduler
+    if (p->num_workers > 0 && cpus >= (long)p->num_workers + 2) {
+        pipe_pin(pthread_self(), 0);
+        for (uint32 w = 0; w < p->num_workers; w++) pipe_pin(p->workers[w].stage.thread, (int)w + 1);
+        pipe_pin(p->stage[PIPE_RECORD].thread, (int)p->num_workers + 1);
+    } else if (p->num_workers == 0 && cpus >= PIPE_NUM_STAGES) {
+        for (int i = 0; i < PIPE_NUM_STAGES; i++) {
+            pipe_pin(i == PIPE_RECEIVE ? pthread_self() : p->stage[i].thread, i);
+        }
+    }
+    return true;
+}
+
+static uint16 shard_apid(PKT_Buf_t *b) {
+    return b->Length >= sizeof(CCSDS_PriHdr_t) ? (uint16)CCSDS_RD_APID(*(CCSDS_PriHdr_t *)PKT_Data(b)) : 0;
+}
+
+// Queues the packets held during an APID move, once the old owner is done
+// with the APID. They must all go before anything newer, so this waits for
+// room instead of shedding.
+static void shard_release_held(struct pipe *p) {
+    void **held;
+    uint32 to = 0;
+    uint32 n = STEER_Poll(&p->steer, p->done, &held, &to);
+
+    pipe_give(&p->workers[to].in, (PKT_Buf_t **)held, n);
+    for (uint32 i = 0; i < n; i++) STEER_Sent(&p->steer, shard_apid(held[i]), to);
+}
+
+// Steers a received batch by APID, one push per worker
+static void shard_steer(struct pipe *p, PKT_Buf_t **ready, uint32 n, PKT_Cache_t *cache) {
+    PKT_Buf_t *out[SHARD_MAX][PIPE_BATCH];
+    uint16 apids[SHARD_MAX][PIPE_BATCH];
+    uint32 count[SHARD_MAX] = {0};
+
+    shard_release_held(p);
+    for (uint32 i = 0; i < n; i++) {
+        uint16 apid = shard_apid(ready[i]);
+        int32 w = STEER_Route(&p->steer, apid);
+        if (w == STEER_HOLD) {
+            if (!STEER_Hold(&p->steer, ready[i])) PKT_Release(cache, ready[i]);
+            continue;
+        }
+        apids[w][count[w]] = apid;
+        out[w][count[w]++] = ready[i];
+    }
+
+    for (uint32 w = 0; w < p->num_workers; w++) {
+        uint32 pushed = RQ_SpscPush(&p->workers[w].in, (void *const *)out[w], count[w]);
+        for (uint32 i = 0; i < pushed; i++) STEER_Sent(&p->steer, apids[w][i], w);
+        for (uint32 i = pushed; i < count[w]; i++) PKT_Release(cache, out[w][i]);
+        if (pushed < count[w]) __atomic_fetch_add(&p->shed, count[w] - pushed, __ATOMIC_RELAXED);
+    }
+}
+
+// Moves the hottest APID it can off the busiest worker (kill -USR2)
+static void shard_rebalance(struct pipe *p) {
+    uint16 apid;
+    uint32 from, to;
+
+    if (!STEER_Plan(&p->steer, &apid, &from, &to)) {
+        printf("[FLIGHT SOFTWARE] Rebalance: no APID move would even out the workers\n");
+    } else if (!STEER_Move(&p->steer, apid, to, p->done)) {
+        printf("[FLIGHT SOFTWARE] Rebalance: a move is still in progress\n");
+    } else {
+        printf("[FLIGHT SOFTWARE] Rebalance: APID 0x%03X moves from worker %u to worker %u\n", apid, from, to);
+    }
+    fflush(stdout);
+}
+
+// Receive stage, on the main thread until Ctrl-C: recvmmsg a batch straight
+// into pool buffers and hand the handles to validate (or steer them)
+static void pipe_receive(struct pipe *p, int sockfd, uint64 *packets, uint64 *bytes, uint64 *first_ns, uint64 *last_ns) {
+    static uint8 scratch[BUF_SIZE];
+    PKT_Buf_t *bufs[PIPE_BATCH], *ready[PIPE_BATCH];
+    struct mmsghdr msgs[PIPE_BATCH];
+    struct iovec iov[PIPE_BATCH];
+    struct sockaddr_in from[PIPE_BATCH];
+    struct pipe_stage *self = &p->stage[PIPE_RECEIVE];
+    PKT_Cache_t cache;
+    uint32 have = 0;
+
+    PKT_InitCache(p->pool, &cache);
+    if (p->num_workers > 0) {
+        struct timeval tv = { 0, SHARD_POLL_MS * 1000 };
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    while (running) {
+        if (report_requested) {
+            report_requested = 0;
+            if (p->latency) report_latency();
+            pipe_report(p);
+        }
+        if (p->num_workers > 0) {
+            if (rebalance_requested) {
+                rebalance_requested = 0;
+                shard_rebalance(p);
+            }
+            shard_release_held(p);
+        }
+
+        // Empty buffers for the batch; with none left, read into scratch and drop
+        while (have < PIPE_BATCH && (bufs[have] = PKT_Alloc(p->pool, &cache, PIPE_MTU)) != NULL) have++;
+        uint32 slots = have > 0 ? have : 1;
+        memset(msgs, 0, slots * sizeof(msgs[0]));
+        for (uint32 i = 0; i < slots; i++) {
+            iov[i].iov_base = have > 0 ? PKT_Data(bufs[i]) : scratch;
+            iov[i].iov_len = have > 0 ? PIPE_MTU : sizeof(scratch);
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = recvmmsg(sockfd, msgs, slots, MSG_WAITFORONE, NULL);
+        if (n <= 0) continue;
+        uint64 now = LAT_NowNs();
+        if (*packets == 0) *first_ns = now;
+        *last_ns = now;
+        *packets += (uint64)n;
+        for (int i = 0; i < n; i++) *bytes += msgs[i].msg_len;
+        self->batches++;
+        self->packets += (uint64)n;
+
+        if (have == 0) {
+            __atomic_fetch_add(&p->no_buffer, (uint64)n, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // Filled buffers go on, truncated and unused ones stay for the next batch
+        uint32 keep = 0, nready = 0;
+        for (uint32 i = 0; i < have; i++) {
+            PKT_Buf_t *b = bufs[i];
+            if (i >= (uint32)n || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+                if (i < (uint32)n) __atomic_fetch_add(&p->oversize, 1, __ATOMIC_RELAXED);
+                bufs[keep++] = b;
+                continue;
+            }
+            b->Length = msgs[i].msg_len;
+            PIPE_RX_NS(b) = now;
+            PIPE_FROM(b) = (uint64)from[i].sin_addr.s_addr << 16 | from[i].sin_port;
+            ready[nready++] = b;
+        }
+        have = keep;
+
+        if (p->num_workers > 0) {
+            shard_steer(p, ready, nready, &cache);
+            continue;
+        }
+        uint32 pushed = RQ_SpscPush(&p->to_validate, (void *const *)ready, nready);
+        for (uint32 i = pushed; i < nready; i++) PKT_Release(&cache, ready[i]);
+        if (pushed < nready) __atomic_fetch_add(&p->shed, nready - pushed, __ATOMIC_RELAXED);
+    }
+
+    // A move still waiting at shutdown: the old owner drains, then the held packets follow
+    if (p->num_workers > 0) {
+        uint32 idle = 0;
+        while (p->steer.MoveApid >= 0) {
+            shard_release_held(p);
+            if (p->steer.MoveApid >= 0) pipe_idle(&idle);
+        }
+    }
+    for (uint32 i = 0; i < have; i++) PKT_Release(&cache, bufs[i]);
+    PKT_FlushCache(&cache);
+    pipe_finish(self);
+}
+
+// After the receive stage has returned: lets the others drain and exit,
+// then reports
+static void pipe_stop(struct pipe *p) {
+    for (uint32 w = 0; w < p->num_workers; w++) pthread_join(p->workers[w].stage.thread, NULL);
+    for (int i = PIPE_VALIDATE; i < PIPE_RECORD; i++) {
+        if (p->num_workers == 0) pthread_join(p->stage[i].thread, NULL);
+    }
+    // Dispatch has finished submitting; the executor is record's last feeder
+    if (p->exec != NULL) {
+        WQ_Wait(p->exec);
+        pipe_feeder_done(p);
+    }
+    pthread_join(p->stage[PIPE_RECORD].thread, NULL);
+    pipe_report(p);
+    if (p->exec != NULL) {
+        WQ_Destroy(p->exec);
+        free(p->jobs);
+    }
+    for (uint32 w = 0; w < p->num_workers; w++) RQ_SpscFree(&p->workers[w].in);
+    RQ_SpscFree(&p->to_validate);
+    RQ_SpscFree(&p->to_decode);
+    RQ_SpscFree(&p->to_dispatch);
+    RQ_SpscFree(&p->to_decode_critical);
+    RQ_SpscFree(&p->to_dispatch_critical);
+    RQ_MpmcFree(&p->to_record);
+}
+
+int main(int argc, char **argv) {
     int sockfd;
     struct sockaddr_in servaddr, cliaddr;
-    uint8 buffer[BUF_SIZE];
+    uint8 *buffer;
     socklen_t addr_len;
+    static struct rx rx;
+    static PKT_Pool_t pool;
+    static const uint32 pool_counts[PKT_NUM_CLASSES] = POOL_COUNTS;
+    bool huge_pages = false;
+    bool pipeline_mode = false;
+    static struct pipe pipe;
+    uint32 pins[SHARD_MAX_PINS][2];
+    uint32 num_pins = 0;
+    long num_workers = 0;
+    static WQ_Pool_t executor;
+    long exec_threads = 0;
+    bool serialize = false;
+    long num_classes = 0;
+    int class_apid, class_fc;
+    const char *archive_dir = NULL;
+    const char *pcap_file = NULL;
+    const char *store_file = NULL;
+    static ARC_Writer_t archive;
+    PCAP_Writer_t capture;
+    static COL_Store_t store;
+    bool latency_mode = false;
+    bool echo_mode = false;
+    bool quiet = false;
+    bool use_uring = false;
+    bool use_gro = false;
+    const char *shm_name = NULL;
+    bool busy_poll = false;
+    uint16 ack_seq = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:w:c:lequgs:PHpW:M:X:SC:")) != -1) {
+        switch (opt) {
+            case 'r': archive_dir = optarg; break;
+            case 'w': pcap_file = optarg; break;
+            case 'c': store_file = optarg; break;
+            case 'l': latency_mode = true; break;
+            case 'e': echo_mode = true; break;
+            case 'q': quiet = true; break;
+            case 'u': use_uring = true; break;
+            case 'g': use_gro = true; break;
+            case 's': shm_name = optarg; break;
+            case 'P': busy_poll = true; break;
+            case 'H': huge_pages = true; break;
+            case 'p': pipeline_mode = true; break;
+            case 'W': pipeline_mode = true; num_workers = atol(optarg); break;
+            case 'X': exec_threads = atol(optarg); break;
+            case 'S': serialize = true; break;
+            case 'C':
+                // Critical class: a whole APID, or one function code of it
+                switch (sscanf(optarg, "%i:%i", &class_apid, &class_fc)) {
+                    case 1:
+                        if (class_apid < 0 || class_apid >= STEER_NUM_APIDS) { num_classes = -1; break; }
+                        memset(pipe.critical[class_apid], 0xFF, sizeof(pipe.critical[class_apid]));
+                        if (num_classes >= 0) num_classes++;
+                        break;
+                    case 2:
+                        if (class_apid < 0 || class_apid >= STEER_NUM_APIDS || class_fc < 0 || class_fc > 0x7F) {
+                            num_classes = -1;
+                            break;
+                        }
+                        pipe.critical[class_apid][class_fc >> 3] |= (uint8)(1u << (class_fc & 7));
+                        if (num_classes >= 0) num_classes++;
+                        break;
+                    default:
+                        num_classes = -1;
+                        break;
+                }
+                break;
+            case 'M':
+                if (num_pins == SHARD_MAX_PINS || sscanf(optarg, "%i:%u", (int *)&pins[num_pins][0], &pins[num_pins][1]) != 2) {
+                    num_workers = -1;
+                } else {
+                    num_pins++;
+                }
+                break;
+            default:
+                shm_name = "";
+                break;
+        }
+    }
+    // Echo needs a return path, the shared-memory ring is one way; the
+    // pipeline has its own batched socket receive
+    if ((shm_name != NULL && (shm_name[0] == '\0' || echo_mode || use_uring)) || (busy_poll && shm_name == NULL) ||
+        (pipeline_mode && (echo_mode || use_uring || use_gro || shm_name != NULL)) ||
+        num_workers < 0 || num_workers > SHARD_MAX || (num_pins > 0 && num_workers == 0) ||
+        exec_threads < 0 || exec_threads > WQ_MAX_WORKERS || (exec_threads > 0 && !pipeline_mode) ||
+        (serialize && exec_threads == 0) || num_classes < 0 || (num_classes > 0 && (!pipeline_mode || num_workers > 0))) {
+        fprintf(stderr, "Usage: %s [-r archive_dir] [-w capture.pcap] [-c column_store] [-l] [-e] [-q] [-u] [-g] [-H]\n"
+                        "       [-s shm_name [-P]]  (shared-memory uplink, -P busy-polls)\n"
+                        "       [-p]                (staged pipeline, not with -e -u -g -s)\n"
+                        "       [-W workers [-M apid:worker]...]  (pipeline sharded by APID, up to %d workers)\n"
+                        "       [-X threads [-S]]   (with -p or -W: heavy handlers on a work-stealing pool,\n"
+                        "                            -S keeps each APID's handlers in order)\n"
+                        "       [-C apid[:fc]]...   (with -p: critical class, dispatched ahead of bulk traffic)\n",
+                argv[0], SHARD_MAX);
+        exit(EXIT_FAILURE);
+    }
+
+    // Stop cleanly on Ctrl-C so the archive segment is trimmed (no SA_RESTART)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Latency report on demand: kill -USR1 <pid>
+    sa.sa_handler = on_report;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    // Sharded pipeline: move a hot APID to the idlest worker, kill -USR2 <pid>
+    sa.sa_handler = on_rebalance;
+    sigaction(SIGUSR2, &sa, NULL);
+    for (int i = 0; i < LAT_NUM_STAGES; i++) LAT_InitHist(&lat_hists[i]);
 
     // 1. Create UDP Socket
     if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
@@ -64,51 +1336,243 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
+    // Packet memory, mapped once up front
+    if (!PKT_Init(&pool, pool_counts, huge_pages ? PKT_FLAG_HUGEPAGES : 0)) {
+        perror("Packet pool setup failed");
+        exit(EXIT_FAILURE);
+    }
+    if (huge_pages) {
+        printf("[FLIGHT SOFTWARE] Packet pool on %s huge pages\n", pool.HugePages ? "explicit" : "transparent");
+    }
+
+    if (!rx_open(&rx, sockfd, &pool, use_uring, use_gro)) {
+        perror("Receive setup failed");
+        exit(EXIT_FAILURE);
+    }
+    if (shm_name != NULL) {
+        if (!rx_open_shm(&rx, shm_name, busy_poll)) {
+            perror("Shared-memory ring setup failed");
+            exit(EXIT_FAILURE);
+        }
+        printf("[FLIGHT SOFTWARE] Receiving from shared memory /dev/shm%s%s, %d slots of %d bytes, %s\n",
+               shm_name[0] == '/' ? "" : "/", shm_name, SHM_SLOTS, SHM_SLOT_SIZE,
+               busy_poll ? "busy-polling" : "futex wakeups");
+    }
+    if (use_uring) {
+        printf("[FLIGHT SOFTWARE] io_uring multishot receive, %d provided buffers of %d bytes\n",
+               RX_BUF_COUNT, RX_BUF_SIZE);
+    }
+    if (use_gro) {
+        printf("[FLIGHT SOFTWARE] UDP GRO on, coalesced runs are split back into datagrams\n");
+    }
+
+    if (archive_dir != NULL) {
+        if (!ARC_OpenWriter(&archive, archive_dir, ARC_SEG_SIZE_DEFAULT)) {
+            perror("Archive open failed");
+            exit(EXIT_FAILURE);
+        }
+        printf("[FLIGHT SOFTWARE] Recording all packets to %s\n", archive_dir);
+    }
+
+    if (pcap_file != NULL) {
+        if (!PCAP_OpenWriter(&capture, pcap_file)) {
+            perror("Capture open failed");
+            exit(EXIT_FAILURE);
+        }
+        printf("[FLIGHT SOFTWARE] Exporting received packets to %s\n", pcap_file);
+    }
+
+    if (store_file != NULL) {
+        if (!COL_Open(&store, store_file, true)) {
+            perror("Column store open failed");
+            exit(EXIT_FAILURE);
+        }
+        printf("[FLIGHT SOFTWARE] Storing decoded packets in %s\n", store_file);
+    }
+
+    if (latency_mode) {
+        printf("[FLIGHT SOFTWARE] Latency stamping on, report with kill -USR1 %d\n", (int)getpid());
+    }
+
+    if (echo_mode) {
+        printf("[FLIGHT SOFTWARE] Echo mode: acknowledging every valid command, dump and decode output off\n");
+    }
+
     printf("[FLIGHT SOFTWARE] Boot successful. Listening on port %d...\n", LISTEN_PORT);
 
-    while (1) {
+    // Receive cost, for comparing backends: wall time from the first packet
+    // and user + system CPU over the run
+    uint64 rx_packets = 0, rx_bytes = 0, rx_first_ns = 0, rx_last_ns = 0;
+    struct rusage ru_start;
+    getrusage(RUSAGE_SELF, &ru_start);
+
+    // The pipeline's receive stage runs here until Ctrl-C, so the loop below is skipped
+    if (pipeline_mode) {
+        pipe.pool = &pool;
+        pipe.quiet = quiet;
+        pipe.latency = latency_mode;
+        pipe.archive = archive_dir != NULL ? &archive : NULL;
+        pipe.capture = pcap_file != NULL ? &capture : NULL;
+        pipe.store = store_file != NULL ? &store : NULL;
+        pipe.local = &servaddr;
+        pipe.num_workers = (uint32)num_workers;
+        pipe.exec = exec_threads > 0 ? &executor : NULL;
+        pipe.exec_threads = (uint32)exec_threads;
+        pipe.serialize = serialize;
+        pipe.lanes = num_classes > 0;
+        if (!pipe_start(&pipe, (const uint32 (*)[2])pins, num_pins)) {
+            perror("Pipeline start failed");
+            exit(EXIT_FAILURE);
+        }
+        if (num_workers > 0) {
+            printf("[FLIGHT SOFTWARE] Sharded pipeline: %ld workers by APID, batches of %d, queues of %d, "
+                   "report with kill -USR1 %d, rebalance with kill -USR2 %d\n",
+                   num_workers, PIPE_BATCH, PIPE_QUEUE, (int)getpid(), (int)getpid());
+        } else {
+            printf("[FLIGHT SOFTWARE] Staged pipeline: %d stages, batches of %d, queues of %d, report with kill -USR1 %d\n",
+                   PIPE_NUM_STAGES, PIPE_BATCH, PIPE_QUEUE, (int)getpid());
+        }
+        if (pipe.lanes) {
+            printf("[FLIGHT SOFTWARE] Priority lanes: %ld critical classes, at most %d bulk packets dispatched ahead of one\n",
+                   num_classes, PRIO_BULK_QUANTUM);
+        }
+        pipe_receive(&pipe, sockfd, &rx_packets, &rx_bytes, &rx_first_ns, &rx_last_ns);
+        pipe_stop(&pipe);
+        rx.syscalls = pipe.stage[PIPE_RECEIVE].batches;   // One recvmmsg per batch
+    }
+
+    while (running) {
         addr_len = sizeof(cliaddr);
+
+        if (report_requested) {
+            report_requested = 0;
+            report_latency();
+        }
         
         // 3. Receive Raw Data (Simulating Radio Link)
-        int n = recvfrom(sockfd, buffer, BUF_SIZE, 0, (struct sockaddr *)&cliaddr, &addr_len);
+        int n = rx_next(&rx, &buffer, &cliaddr, &addr_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) continue;
+        uint64 rx_ns = LAT_NowNs();
+        if (rx_packets++ == 0) rx_first_ns = rx_ns;
+        rx_last_ns = rx_ns;
+        rx_bytes += (uint64)n;
 
-        if (n > 0) {
+        // Record every packet as received, before any validation
+        if (n > 0 && archive_dir != NULL) {
+            ARC_Append(&archive, buffer, (uint16)n, ARC_TimeNowNs());
+        }
+        if (n > 0 && pcap_file != NULL) {
+            PCAP_WriteUdp(&capture, ARC_TimeNowNs(), &cliaddr, &servaddr, buffer, (uint16)n);
+        }
+
+        // Round-trip benchmark: answer each valid command with an acknowledgement
+        // telemetry packet carrying the command's headers, skipping the slow
+        // console output so the measured path is receive -> validate -> send
+        if (echo_mode) {
+            if (pkt_complete(buffer, (uint32)n) && CCSDS_ValidCheckSum((CCSDS_CommandPacket_t *)buffer)) {
+                PKT_Buf_t *ack = PKT_Alloc(&pool, &rx.cache, sizeof(CCSDS_TelemetryPacket_t) + sizeof(CCSDS_CommandPacket_t));
+                if (ack == NULL) continue;
+                uint64 now = ARC_TimeNowNs();
+                uint16 ack_len = CCSDS_BuildTelemetry(PKT_Data(ack), (uint16)ack->Capacity,
+                                                      (uint16)CCSDS_RD_APID(*(CCSDS_PriHdr_t *)buffer),
+                                                      ack_seq, (uint32)(now / 1000000000ull),
+                                                      (uint16)((now % 1000000000ull) * 65536 / 1000000000ull),
+                                                      buffer, sizeof(CCSDS_CommandPacket_t));
+                ack_seq = (ack_seq + 1) & 0x3FFF;
+                if (ack_len > 0) {
+                    sendto(sockfd, PKT_Data(ack), ack_len, 0, (const struct sockaddr *)&cliaddr, addr_len);
+                }
+                PKT_Release(&rx.cache, ack);
+            }
+            continue;
+        }
+
+        if (n >= (int)sizeof(CCSDS_CommandPacket_t)) {
             // 4. Show Raw Data (Layer 1 View)
-            visualize_packet(buffer, n);
+            if (!quiet) visualize_packet(buffer, n);
 
             // 5. CCSDS Processing (Layer 2 View)
             CCSDS_CommandPacket_t *pkt = (CCSDS_CommandPacket_t *)buffer;
 
-            printf("   [CCSDS DECODER ENGINE]\n");
+            if (!quiet) printf("   [CCSDS DECODER ENGINE]\n");
             
             // Check Integrity
-            if (CCSDS_ValidCheckSum(pkt)) {
-                printf("   [+] Integrity Check: PASSED (Valid Checksum)\n");
-
-                // Decode Headers using CCSDS Macros
-                uint16 rcv_apid = CCSDS_RD_APID(pkt->SpacePacket.Hdr);
-                uint16 rcv_seq  = CCSDS_RD_SEQ(pkt->SpacePacket.Hdr);
-                uint16 rcv_len  = CCSDS_RD_LEN(pkt->SpacePacket.Hdr);
-                uint8  rcv_fc   = CCSDS_RD_FC(pkt->Sec);
+            if (pkt_complete(buffer, (uint32)n) && CCSDS_ValidCheckSum(pkt)) {
+                uint64 valid_ns = latency_mode ? LAT_NowNs() : 0;
+                if (!quiet) printf("   [+] Integrity Check: PASSED (Valid Checksum)\n");
+
+                // Decode Headers (single 8-byte load)
+                CCSDS_CmdHdr_t hdr;
+                CCSDS_DecodeCmdHdr(pkt, &hdr);
+                uint16 rcv_apid = hdr.Apid;
+                uint16 rcv_seq  = hdr.SeqCount;
+                uint32 rcv_len  = hdr.Length;
+                uint8  rcv_fc   = hdr.FuncCode;
+
+                // Ingest validated packets into the columnar store
+                if (store_file != NULL) {
+                    COL_Append(&store, ARC_TimeNowNs(), rcv_apid, rcv_seq,
+                               buffer + sizeof(CCSDS_CommandPacket_t),
+                               (uint16)(n - (int)sizeof(CCSDS_CommandPacket_t)));
+                }
                 
                 // Extract Payload
                 char *payload_str = (char *)(buffer + sizeof(CCSDS_CommandPacket_t));
 
                 // Process Command
-                printf("   [+] Packet Details:\n");
-                printf("       - Application ID: 0x%03X (%d)\n", rcv_apid, rcv_apid);
-                printf("       - Sequence Count: %d\n", rcv_seq);
-                printf("       - Total Length:   %d bytes\n", rcv_len);
-                printf("       - Function Code:  0x%02X\n", rcv_fc);
-                printf("   [+] Payload Content: \"%s\"\n", payload_str);
-                printf("   [+] Action: Dispatching to Application %d...\n", rcv_apid);
+                if (!quiet) {
+                    printf("   [+] Packet Details:\n");
+                    printf("       - Application ID: 0x%03X (%d)\n", rcv_apid, rcv_apid);
+                    printf("       - Sequence Count: %d\n", rcv_seq);
+                    printf("       - Total Length:   %u bytes\n", rcv_len);
+                    printf("       - Function Code:  0x%02X\n", rcv_fc);
+                    printf("   [+] Payload Content: \"%.*s\"\n",
+                           (int)strnlen(payload_str, (size_t)(n - (int)sizeof(CCSDS_CommandPacket_t))), payload_str);
+                    printf("   [+] Action: Dispatching to Application %d...\n", rcv_apid);
+                }
 
-            } else {
+                // Stamped packets carry LAT_Stamp_t at the end of the payload
+                LAT_Stamp_t stamp;
+                if (latency_mode && n >= (int)(sizeof(CCSDS_CommandPacket_t) + sizeof(stamp))) {
+                    uint64 dispatch_ns = LAT_NowNs();
+                    memcpy(&stamp, buffer + n - sizeof(stamp), sizeof(stamp));
+                    if (stamp.Magic == LAT_STAMP_MAGIC) {
+                        LAT_Record(&lat_hists[LAT_BUILD_SEND], stamp.SendNs - stamp.BuildNs);
+                        LAT_Record(&lat_hists[LAT_SEND_RECV], rx_ns - stamp.SendNs);
+                        LAT_Record(&lat_hists[LAT_RECV_VALID], valid_ns - rx_ns);
+                        LAT_Record(&lat_hists[LAT_VALID_DISPATCH], dispatch_ns - valid_ns);
+                        LAT_Record(&lat_hists[LAT_END_TO_END], dispatch_ns - stamp.BuildNs);
+                    }
+                }
+
+                // One thread here: every handler runs inline, heavy or not
+                const struct handler *h = handler_find(rcv_apid, rcv_fc);
+                if (h != NULL) {
+                    h->run(buffer + sizeof(CCSDS_CommandPacket_t), (uint32)(n - (int)sizeof(CCSDS_CommandPacket_t)));
+                }
+
+            } else if (!quiet) {
                 printf("   [-] Integrity Check: FAILED! Dropping packet.\n");
             }
         }
     }
 
+    if (archive_dir != NULL) ARC_CloseWriter(&archive);
+    if (pcap_file != NULL) PCAP_CloseWriter(&capture);
+    if (store_file != NULL) COL_Close(&store);
+    if (latency_mode) report_latency();
+
+    double cpu_ns = cpu_ns_since(&ru_start);
+    double rx_secs = (double)(rx_last_ns - rx_first_ns) / 1e9;
+    printf("[FLIGHT SOFTWARE] %s: %llu packets, %llu bytes, %.0f pkt/s, %.0f ns CPU and %.3f syscalls per packet\n",
+           shm_name != NULL ? "shared memory" : use_uring ? "io_uring" : pipeline_mode ? "pipeline" : "recvfrom", (unsigned long long)rx_packets, (unsigned long long)rx_bytes,
+           rx_secs > 0 ? rx_packets / rx_secs : 0.0, rx_packets ? cpu_ns / rx_packets : 0.0,
+           rx_packets ? (double)(rx.syscalls + rx.shm.FutexWaits) / rx_packets : 0.0);
+    if (use_gro) printf("[FLIGHT SOFTWARE] %llu receives carried a coalesced GRO run\n", (unsigned long long)rx.coalesced);
+
+    rx_close(&rx);
+    PKT_Destroy(&pool);
     close(sockfd);
     return 0;
 }
\ No newline at end of file
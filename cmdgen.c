@@ -0,0 +1,374 @@
+/*
+** File: cmdgen.c
+** Role: TOOL (Command Database Code Generator)
+** Description: Reads a command database CSV export and emits one specialized
+**              C encoder/decoder pair per command. APID, function code,
+**              packet length and payload offsets are folded into the code
+**              as constants, so nothing is interpreted at run time.
+**
+** Usage:       cmdgen <commands.csv> <output_basename>
+**              -> <output_basename>.h / <output_basename>.c
+**
+** CSV format:  command,apid,func_code,field,type,count
+**              One row per payload field in wire order. A command without
+**              payload has one row with empty field/type. The rows of a
+**              command are contiguous and names are unique ignoring case;
+**              field names are unique within a command and not C keywords;
+**              lines are at most 511 characters. Types are
+**              u8 u16 u32 u64 i8 i16 i32 i64 f32 f64, or bytes with count.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <strings.h>
+
+#include "ccsds.h"
+
+#define MAX_COMMANDS 1024
+#define MAX_FIELDS   64
+#define MAX_NAME     64
+#define LINE_SIZE    512
+
+typedef struct {
+    char   name[MAX_NAME];
+    char   type[8];
+    int    size;      // Wire size in bytes
+    int    count;     // Element count for "bytes"
+    int    offset;    // Offset from start of payload
+    int    line;      // CSV line of the field
+} field_t;
+
+typedef struct {
+    char    name[MAX_NAME];
+    char    upper[MAX_NAME];
+    int     apid;
+    int     fc;
+    int     line;      // First CSV line of the command
+    int     num_fields;
+    int     payload_len;
+    field_t fields[MAX_FIELDS];
+} command_t;
+
+static command_t commands[MAX_COMMANDS];
+static int       num_commands = 0;
+
+// --- TYPE TABLE ---
+static const struct { const char *name; const char *ctype; int size; } type_table[] = {
+    { "u8",  "uint8",    1 }, { "u16", "uint16",   2 }, { "u32", "uint32",   4 }, { "u64", "uint64",   8 },
+    { "i8",  "int8_t",   1 }, { "i16", "int16_t",  2 }, { "i32", "int32",    4 }, { "i64", "int64_t",  8 },
+    { "f32", "float",    4 }, { "f64", "double",   8 }, { "bytes", "uint8",  1 },
+};
+
+// Field names become struct members, so none of these (C11 and C23)
+static const char *const c_keywords[] = {
+    "alignas", "alignof", "auto", "bool", "break", "case", "char", "const", "constexpr", "continue",
+    "default", "do", "double", "else", "enum", "extern", "false", "float", "for", "goto", "if",
+    "inline", "int", "long", "nullptr", "register", "restrict", "return", "short", "signed", "sizeof",
+    "static", "static_assert", "struct", "switch", "thread_local", "true", "typedef", "typeof",
+    "typeof_unqual", "union", "unsigned", "void", "volatile", "while",
+};
+
+static int is_keyword(const char *s) {
+    if (s[0] == '_' && isupper((unsigned char)s[1])) return 1;  // _Bool, _Atomic, ... (all reserved)
+    for (size_t i = 0; i < sizeof(c_keywords) / sizeof(c_keywords[0]); i++) {
+        if (strcmp(c_keywords[i], s) == 0) return 1;
+    }
+    return 0;
+}
+
+static int find_type(const char *name) {
+    for (size_t i = 0; i < sizeof(type_table) / sizeof(type_table[0]); i++) {
+        if (strcmp(type_table[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static int valid_ident(const char *s) {
+    if (!isalpha((unsigned char)*s) && *s != '_') return 0;
+    for (; *s; s++) if (!isalnum((unsigned char)*s) && *s != '_') return 0;
+    return 1;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *e = s + strlen(s);
+    while (e > s && isspace((unsigned char)e[-1])) *--e = '\0';
+    return s;
+}
+
+// --- CSV INPUT ---
+static int load_csv(const char *path) {
+    FILE *fp = fopen(path, "r");
+    char line[LINE_SIZE];
+    int lineno = 0;
+
+    if (fp == NULL) { perror(path); return -1; }
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *col[6] = { 0 };
+        char *p = line;
+        int ncol = 0;
+
+        lineno++;
+        if (strchr(line, '\n') == NULL && getc(fp) != EOF) {
+            fprintf(stderr, "%s:%d: line longer than %d characters\n", path, lineno, LINE_SIZE - 1);
+            fclose(fp);
+            return -1;
+        }
+        if (lineno == 1 && strncmp(line, "command", 7) == 0) continue;  // Header row
+        if (*trim(line) == '\0' || line[0] == '#') continue;
+
+        while (ncol < 6) {
+            col[ncol++] = p;
+            p = strchr(p, ',');
+            if (p == NULL) break;
+            *p++ = '\0';
+        }
+        for (int i = 0; i < 6; i++) col[i] = col[i] ? trim(col[i]) : "";
+
+        if (!valid_ident(col[0]) || strlen(col[0]) >= MAX_NAME) {
+            fprintf(stderr, "%s:%d: bad command name '%s'\n", path, lineno, col[0]);
+            fclose(fp);
+            return -1;
+        }
+
+        // Rows of one command are contiguous
+        command_t *cmd = (num_commands > 0 && strcmp(commands[num_commands - 1].name, col[0]) == 0)
+                       ? &commands[num_commands - 1] : NULL;
+        if (cmd == NULL) {
+            // Generated names are CMD_<name>_* and CMD_<NAME>_*, so a second
+            // block or a case-only variant would redefine the first
+            for (int c = 0; c < num_commands; c++) {
+                if (strcasecmp(commands[c].name, col[0]) != 0) continue;
+                if (strcmp(commands[c].name, col[0]) == 0) {
+                    fprintf(stderr, "%s:%d: rows of command '%s' are not contiguous (first block at line %d)\n",
+                            path, lineno, col[0], commands[c].line);
+                } else {
+                    fprintf(stderr, "%s:%d: command '%s' differs from '%s' (line %d) only in case\n",
+                            path, lineno, col[0], commands[c].name, commands[c].line);
+                }
+                fclose(fp);
+                return -1;
+            }
+            if (num_commands == MAX_COMMANDS) { fprintf(stderr, "too many commands\n"); fclose(fp); return -1; }
+            cmd = &commands[num_commands++];
+            memset(cmd, 0, sizeof(*cmd));
+            snprintf(cmd->name, MAX_NAME, "%s", col[0]);
+            cmd->line = lineno;
+            for (int i = 0; cmd->name[i]; i++) cmd->upper[i] = (char)toupper((unsigned char)cmd->name[i]);
+            cmd->apid = (int)strtol(col[1], NULL, 0);
+            cmd->fc   = (int)strtol(col[2], NULL, 0);
+
+            if (cmd->apid < 0 || cmd->apid > 0x7FF || cmd->fc < 0 || cmd->fc > 0x7F) {
+                fprintf(stderr, "%s:%d: APID or function code out of range\n", path, lineno);
+                fclose(fp);
+                return -1;
+            }
+        }
+
+        if (col[3][0] == '\0') continue;  // Command without payload
+
+        int t = find_type(col[4]);
+        if (!valid_ident(col[3]) || strlen(col[3]) >= MAX_NAME || t < 0 || cmd->num_fields == MAX_FIELDS) {
+            fprintf(stderr, "%s:%d: bad field '%s' of type '%s'\n", path, lineno, col[3], col[4]);
+            fclose(fp);
+            return -1;
+        }
+        if (is_keyword(col[3])) {
+            fprintf(stderr, "%s:%d: field name '%s' is a C keyword\n", path, lineno, col[3]);
+            fclose(fp);
+            return -1;
+        }
+        for (int i = 0; i < cmd->num_fields; i++) {
+            if (strcmp(cmd->fields[i].name, col[3]) != 0) continue;
+            fprintf(stderr, "%s:%d: duplicate field '%s' in command '%s' (first at line %d)\n",
+                    path, lineno, col[3], cmd->name, cmd->fields[i].line);
+            fclose(fp);
+            return -1;
+        }
+
+        field_t *f = &cmd->fields[cmd->num_fields++];
+        snprintf(f->name, MAX_NAME, "%s", col[3]);
+        snprintf(f->type, sizeof(f->type), "%s", col[4]);
+        f->count  = (strcmp(f->type, "bytes") == 0) ? atoi(col[5]) : 1;
+        f->size   = type_table[t].size * f->count;
+        f->offset = cmd->payload_len;
+        f->line   = lineno;
+        cmd->payload_len += f->size;
+
+        if (f->count <= 0 || sizeof(CCSDS_CommandPacket_t) + cmd->payload_len > 0xFFFF) {
+            fprintf(stderr, "%s:%d: bad size for field '%s'\n", path, lineno, f->name);
+            fclose(fp);
+            return -1;
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+// --- CODE EMITTERS ---
+static void emit_store(FILE *out, const field_t *f) {
+    if (strcmp(f->type, "bytes") == 0) {
+        fprintf(out, "    memcpy(P + %d, Cmd->%s, %d);\n", f->offset, f->name, f->count);
+        return;
+    }
+    if (f->size == 1) {
+        fprintf(out, "    P[%d] = (uint8)Cmd->%s;\n", f->offset, f->name);
+        return;
+    }
+
+    const char *bits = (f->size == 2) ? "uint16" : (f->size == 4) ? "uint32" : "uint64";
+    if (f->type[0] == 'f') {
+        fprintf(out, "    { %s B; memcpy(&B, &Cmd->%s, %d);\n", bits, f->name, f->size);
+    } else {
+        fprintf(out, "    { %s B = (%s)Cmd->%s;\n", bits, bits, f->name);
+    }
+    for (int i = 0; i < f->size; i++) {
+        fprintf(out, "      P[%d] = (uint8)(B >> %d);\n", f->offset + i, 8 * (f->size - 1 - i));
+    }
+    fprintf(out, "    }\n");
+}
+
+static void emit_load(FILE *out, const field_t *f) {
+    const char *ctype = type_table[find_type(f->type)].ctype;
+
+    if (strcmp(f->type, "bytes") == 0) {
+        fprintf(out, "    memcpy(Cmd->%s, P + %d, %d);\n", f->name, f->offset, f->count);
+        return;
+    }
+    if (f->size == 1) {
+        fprintf(out, "    Cmd->%s = (%s)P[%d];\n", f->name, ctype, f->offset);
+        return;
+    }
+
+    const char *bits = (f->size == 2) ? "uint16" : (f->size == 4) ? "uint32" : "uint64";
+    fprintf(out, "    { %s B = 0;\n", bits);
+    for (int i = 0; i < f->size; i++) {
+        fprintf(out, "      B = (%s)((B << 8) | P[%d]);\n", bits, f->offset + i);
+    }
+    if (f->type[0] == 'f') {
+        fprintf(out, "      memcpy(&Cmd->%s, &B, %d);\n", f->name, f->size);
+    } else {
+        fprintf(out, "      Cmd->%s = (%s)B;\n", f->name, ctype);
+    }
+    fprintf(out, "    }\n");
+}
+
+static void emit_header(FILE *out, const char *src, const char *guard) {
+    fprintf(out, "/*\n** Generated by cmdgen from %s - do not edit.\n*/\n\n", src);
+    fprintf(out, "#ifndef _%s_\n#define _%s_\n\n#include \"ccsds.h\"\n\n", guard, guard);
+
+    for (int c = 0; c < num_commands; c++) {
+        const command_t *cmd = &commands[c];
+        int total = (int)sizeof(CCSDS_CommandPacket_t) + cmd->payload_len;
+
+        fprintf(out, "/*----- %s -----*/\n", cmd->name);
+        fprintf(out, "#define CMD_%s_APID  0x%03X\n", cmd->upper, cmd->apid);
+        fprintf(out, "#define CMD_%s_FC    0x%02X\n", cmd->upper, cmd->fc);
+        fprintf(out, "#define CMD_%s_LEN   %d\n\n", cmd->upper, total);
+
+        if (cmd->num_fields > 0) {
+            fprintf(out, "typedef struct {\n");
+            for (int i = 0; i < cmd->num_fields; i++) {
+                const field_t *f = &cmd->fields[i];
+                const char *ctype = type_table[find_type(f->type)].ctype;
+                if (strcmp(f->type, "bytes") == 0) fprintf(out, "    %-8s %s[%d];\n", ctype, f->name, f->count);
+                else                               fprintf(out, "    %-8s %s;\n", ctype, f->name);
+            }
+            fprintf(out, "} CMD_%s_t;\n\n", cmd->name);
+            fprintf(out, "uint16 CMD_%s_Encode(uint8 *Buf, uint16 BufSize, uint16 SeqCount, const CMD_%s_t *Cmd);\n", cmd->name, cmd->name);
+            fprintf(out, "bool   CMD_%s_Decode(const uint8 *Buf, uint16 Len, CMD_%s_t *Cmd);\n\n", cmd->name, cmd->name);
+        } else {
+            fprintf(out, "uint16 CMD_%s_Encode(uint8 *Buf, uint16 BufSize, uint16 SeqCount);\n", cmd->name);
+            fprintf(out, "bool   CMD_%s_Decode(const uint8 *Buf, uint16 Len);\n\n", cmd->name);
+        }
+    }
+
+    fprintf(out, "#endif  /* _%s_ */\n", guard);
+}
+
+static void emit_source(FILE *out, const char *src, const char *hdr_name) {
+    fprintf(out, "/*\n** Generated by cmdgen from %s - do not edit.\n*/\n\n", src);
+    fprintf(out, "#include <string.h>\n\n#include \"%s\"\n", hdr_name);
+
+    for (int c = 0; c < num_commands; c++) {
+        const command_t *cmd = &commands[c];
+        int has_args = cmd->num_fields > 0;
+
+        // Encoder: header fields are all constants except the sequence count
+        fprintf(out, "\n/******************************************************************************\n");
+        fprintf(out, "**  Function:  CMD_%s_Encode()\n*/\n", cmd->name);
+        if (has_args) fprintf(out, "uint16 CMD_%s_Encode(uint8 *Buf, uint16 BufSize, uint16 SeqCount, const CMD_%s_t *Cmd)\n{\n", cmd->name, cmd->name);
+        else          fprintf(out, "uint16 CMD_%s_Encode(uint8 *Buf, uint16 BufSize, uint16 SeqCount)\n{\n", cmd->name);
+        fprintf(out, "    CCSDS_CommandPacket_t *PktPtr = (CCSDS_CommandPacket_t *)Buf;\n");
+        if (has_args) fprintf(out, "    uint8                 *P      = Buf + sizeof(CCSDS_CommandPacket_t);\n");
+        fprintf(out, "\n    if (Buf == NULL || BufSize < CMD_%s_LEN) return 0;\n\n", cmd->upper);
+        fprintf(out, "    CCSDS_CLR_PRI_HDR(PktPtr->SpacePacket.Hdr);\n");
+        fprintf(out, "    CCSDS_CLR_CMDSEC_HDR(PktPtr->Sec);\n");
+        fprintf(out, "    CCSDS_WR_APID(PktPtr->SpacePacket.Hdr, CMD_%s_APID);\n", cmd->upper);
+        fprintf(out, "    CCSDS_WR_TYPE(PktPtr->SpacePacket.Hdr, CCSDS_CMD);\n");
+        fprintf(out, "    CCSDS_WR_SHDR(PktPtr->SpacePacket.Hdr, CCSDS_HAS_SEC_HDR);\n");
+        fprintf(out, "    CCSDS_WR_SEQ (PktPtr->SpacePacket.Hdr, SeqCount);\n");
+        fprintf(out, "    CCSDS_WR_LEN (PktPtr->SpacePacket.Hdr, CMD_%s_LEN);\n", cmd->upper);
+        fprintf(out, "    CCSDS_WR_FC  (PktPtr->Sec, CMD_%s_FC);\n\n", cmd->upper);
+        for (int i = 0; i < cmd->num_fields; i++) emit_store(out, &cmd->fields[i]);
+        if (has_args) fprintf(out, "\n");
+        fprintf(out, "    CCSDS_LoadCheckSum(PktPtr);\n\n    return CMD_%s_LEN;\n}\n", cmd->upper);
+
+        // Decoder: fixed length and identity check, then fixed-offset loads
+        fprintf(out, "\n/******************************************************************************\n");
+        fprintf(out, "**  Function:  CMD_%s_Decode()\n*/\n", cmd->name);
+        if (has_args) fprintf(out, "bool CMD_%s_Decode(const uint8 *Buf, uint16 Len, CMD_%s_t *Cmd)\n{\n", cmd->name, cmd->name);
+        else          fprintf(out, "bool CMD_%s_Decode(const uint8 *Buf, uint16 Len)\n{\n", cmd->name);
+        fprintf(out, "    CCSDS_CommandPacket_t *PktPtr = (CCSDS_CommandPacket_t *)Buf;\n");
+        if (has_args) fprintf(out, "    const uint8           *P      = Buf + sizeof(CCSDS_CommandPacket_t);\n");
+        fprintf(out, "\n    if (Buf == NULL || Len < CMD_%s_LEN) return false;\n", cmd->upper);
+        fprintf(out, "    if (CCSDS_RD_APID(PktPtr->SpacePacket.Hdr) != CMD_%s_APID ||\n", cmd->upper);
+        fprintf(out, "        CCSDS_RD_FC(PktPtr->Sec)                != CMD_%s_FC   ||\n", cmd->upper);
+        fprintf(out, "        CCSDS_RD_LEN(PktPtr->SpacePacket.Hdr)  != CMD_%s_LEN) return false;\n", cmd->upper);
+        fprintf(out, "    if (!CCSDS_ValidCheckSum(PktPtr)) return false;\n\n");
+        for (int i = 0; i < cmd->num_fields; i++) emit_load(out, &cmd->fields[i]);
+        if (has_args) fprintf(out, "\n");
+        fprintf(out, "    return true;\n}\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    char hdr_path[256], src_path[256], guard[128];
+    const char *base;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <commands.csv> <output_basename>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (load_csv(argv[1]) != 0) return EXIT_FAILURE;
+
+    snprintf(hdr_path, sizeof(hdr_path), "%s.h", argv[2]);
+    snprintf(src_path, sizeof(src_path), "%s.c", argv[2]);
+
+    // Include guard and #include use the file name only
+    base = strrchr(argv[2], '/');
+    base = base ? base + 1 : argv[2];
+    snprintf(guard, sizeof(guard), "%s", base);
+    for (char *g = guard; *g; g++) if (!isalnum((unsigned char)*g)) *g = '_';
+
+    FILE *h = fopen(hdr_path, "w");
+    FILE *c = fopen(src_path, "w");
+    if (h == NULL || c == NULL) {
+        perror("Output open failed");
+        return EXIT_FAILURE;
+    }
+
+    emit_header(h, argv[1], guard);
+    emit_source(c, argv[1], strrchr(hdr_path, '/') ? strrchr(hdr_path, '/') + 1 : hdr_path);
+
+    fclose(h);
+    fclose(c);
+
+    printf("[CMDGEN] %d commands -> %s, %s\n", num_commands, hdr_path, src_path);
+    return 0;
+}
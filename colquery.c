@@ -0,0 +1,71 @@
+/*
+** File: colquery.c
+** Role: GROUND TOOL (Columnar Store Query)
+** Description: Lists the packets of one APID within a time window from a
+**              columnar store written by the flight software (-c).
+**
+** Usage:       colquery -f <store> -a <apid> [-s t1_ns] [-e t2_ns] [-q]
+**              -q  count only, print no rows
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "ccsds.h"
+#include "colstore.h"
+
+static uint64 mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ull + (uint64)ts.tv_nsec;
+}
+
+static void print_row(const COL_Row_t *row, void *arg) {
+    (void)arg;
+    printf("%llu.%09llu  APID 0x%03X  seq %5u  len %4u  \"%.*s\"\n",
+           (unsigned long long)(row->TimeNs / 1000000000ull), (unsigned long long)(row->TimeNs % 1000000000ull),
+           row->Apid, row->SeqCount, row->Length, row->Length > 32 ? 32 : row->Length, (const char *)row->Payload);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    int apid = -1;
+    uint64 t1 = 0, t2 = ~0ull;
+    int quiet = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:a:s:e:q")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 'a': apid = (int)strtol(optarg, NULL, 0); break;
+            case 's': t1 = strtoull(optarg, NULL, 0); break;
+            case 'e': t2 = strtoull(optarg, NULL, 0); break;
+            case 'q': quiet = 1; break;
+            default:  path = NULL; optind = argc; break;
+        }
+    }
+    if (path == NULL || apid < 0 || apid >= CCSDS_MAX_APID) {
+        fprintf(stderr, "Usage: %s -f store -a apid [-s t1_ns] [-e t2_ns] [-q]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    static COL_Store_t store;
+    if (!COL_Open(&store, path, false)) {
+        perror("Store open failed");
+        exit(EXIT_FAILURE);
+    }
+
+    COL_QueryStats_t stats;
+    uint64 start = mono_ns();
+    uint64 hits = COL_Query(&store, (uint16)apid, t1, t2, quiet ? NULL : print_row, NULL, &stats);
+    uint64 elapsed = mono_ns() - start;
+
+    printf("[QUERY] %llu packets, %u/%u blocks scanned, %llu rows scanned, %.3f ms\n",
+           (unsigned long long)hits, stats.BlocksScanned, stats.BlocksTotal,
+           (unsigned long long)stats.RowsScanned, elapsed / 1e6);
+
+    COL_Close(&store);
+    return 0;
+}
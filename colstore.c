@@ -0,0 +1,543 @@
+/*
+**  Columnar Telemetry Store - Block-compressed header columns with zone maps
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "colstore.h"
+
+/* Unpacking reads whole 64-bit words, so buffers carry this much slack */
+#define COL_PAD  16
+
+#define COL_PACKED_BYTES(rows, bits)  ((uint32)(((uint64)(rows) * (bits) + 7) / 8))
+
+/******************************************************************************
+**  Function:  COL_BitWidth()
+*/
+static uint8 COL_BitWidth (uint64 MaxValue)
+{
+   return (MaxValue == 0) ? 0 : (uint8)(64 - __builtin_clzll(MaxValue));
+}
+
+/******************************************************************************
+**  Function:  COL_GetBits()
+**
+**  Reads Bits (0..64) bits at BitPos from a little-endian bit stream.
+*/
+static inline uint64 COL_GetBits (const uint8 *Buf, uint64 BitPos, uint32 Bits)
+{
+   uint32 Shift = (uint32)(BitPos & 7);
+   uint64 Word;
+
+   memcpy(&Word, Buf + (BitPos >> 3), sizeof(Word));
+   Word >>= Shift;
+   if (Shift + Bits > 64) Word |= (uint64)Buf[(BitPos >> 3) + 8] << (64 - Shift);
+
+   return (Bits >= 64) ? Word : Word & ((1ull << Bits) - 1);
+}
+
+/******************************************************************************
+**  Function:  COL_Pack()
+**
+**  Writes Count values of Bits each to Out, which must be zeroed and hold
+**  COL_PACKED_BYTES(Count, Bits) bytes. Returns the bytes used.
+*/
+static uint32 COL_Pack (uint8 *Out, const uint64 *Values, uint32 Count, uint8 Bits)
+{
+   uint64 BitPos = 0;
+   uint32 i, b;
+
+   if (Bits == 0) return 0;
+
+   for (i = 0; i < Count; ++i)
+   {
+      uint64 V = Values[i];
+      for (b = 0; b < Bits; b += 8, V >>= 8)
+      {
+         uint32 Shift = (uint32)((BitPos + b) & 7);
+         uint64 Byte  = (BitPos + b) >> 3;
+         uint32 Take  = (Bits - b < 8) ? Bits - b : 8;
+         uint32 Chunk = (uint32)(V & ((1u << Take) - 1));
+
+         Out[Byte] |= (uint8)(Chunk << Shift);
+         if (Shift + Take > 8) Out[Byte + 1] |= (uint8)(Chunk >> (8 - Shift));
+      }
+      BitPos += Bits;
+   }
+
+   return COL_PACKED_BYTES(Count, Bits);
+}
+
+/******************************************************************************
+**  Function:  COL_Unpack()
+**
+**  Unpacks Count values of Bits each. Widths up to 56 bits never straddle
+**  a 64-bit load, which keeps the common loop to a load, shift and mask.
+*/
+static void COL_Unpack (uint64 *Out, const uint8 *Buf, uint32 Count, uint8 Bits)
+{
+   uint64 Mask = (Bits >= 64) ? ~0ull : (1ull << Bits) - 1;
+   uint64 Pos  = 0;
+   uint64 Word;
+   uint32 i;
+
+   if (Bits == 0)
+   {
+      memset(Out, 0, Count * sizeof(uint64));
+   }
+   else if (Bits <= 56)
+   {
+      for (i = 0; i < Count; ++i, Pos += Bits)
+      {
+         memcpy(&Word, Buf + (Pos >> 3), sizeof(Word));
+         Out[i] = (Word >> (Pos & 7)) & Mask;
+      }
+   }
+   else
+   {
+      for (i = 0; i < Count; ++i, Pos += Bits) Out[i] = COL_GetBits(Buf, Pos, Bits);
+   }
+}
+
+/******************************************************************************
+**  Function:  COL_Unpack16()
+**
+**  Frame-of-reference decode of a 16-bit column.
+*/
+static void COL_Unpack16 (uint16 *Out, const uint8 *Buf, uint32 Count, uint8 Bits, uint16 Base)
+{
+   static uint64 Tmp[COL_BLOCK_ROWS];
+   uint32        i;
+
+   COL_Unpack(Tmp, Buf, Count, Bits);
+   for (i = 0; i < Count; ++i) Out[i] = (uint16)(Base + Tmp[i]);
+}
+
+/******************************************************************************
+**  Function:  COL_UnpackTime()
+**
+**  Zigzag delta decode of the time column (prefix sum from FirstTimeNs).
+*/
+static void COL_UnpackTime (uint64 *Out, const uint8 *Buf, uint32 Count, uint8 Bits, uint64 First)
+{
+   uint64 T = First;
+   uint32 i;
+
+   COL_Unpack(Out, Buf, Count, Bits);
+   for (i = 0; i < Count; ++i)
+   {
+      T += (Out[i] >> 1) ^ (0 - (Out[i] & 1));
+      Out[i] = T;
+   }
+}
+
+/******************************************************************************
+**  Function:  COL_Select()
+**
+**  Writes the indexes of rows with ApidCol == Apid and T1 <= TimeCol <= T2
+**  to Sel. Returns the number of matches.
+*/
+static uint32 COL_Select (const uint16 *ApidCol, const uint64 *TimeCol, uint32 Count,
+                          uint16 Apid, uint64 T1, uint64 T2, uint16 *Sel)
+{
+   uint32 n = 0;
+   uint32 i = 0;
+
+#if defined(__AVX2__)
+   /* 16 rows per step: APID compare on 16-bit lanes, time compare on
+   ** 64-bit lanes (biased for an unsigned compare), the time result packed
+   ** down to the APID lane layout, one movemask, then the set bits */
+   const __m256i Bias  = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+   const __m256i Lo    = _mm256_set1_epi64x((long long)(T1 ^ 0x8000000000000000ull));
+   const __m256i Hi    = _mm256_set1_epi64x((long long)(T2 ^ 0x8000000000000000ull));
+   const __m256i Key   = _mm256_set1_epi16((short)Apid);
+   const __m256i Order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+   __m256i       Out[4];
+   uint32        k;
+
+   for (; i + 16 <= Count; i += 16)
+   {
+      __m256i Eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(ApidCol + i)), Key);
+
+      for (k = 0; k < 4; ++k)
+      {
+         __m256i T = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(TimeCol + i + 4 * k)), Bias);
+         Out[k] = _mm256_or_si256(_mm256_cmpgt_epi64(Lo, T), _mm256_cmpgt_epi64(T, Hi));
+      }
+
+      __m256i Bad = _mm256_packs_epi16(_mm256_packs_epi32(Out[0], Out[1]),
+                                       _mm256_packs_epi32(Out[2], Out[3]));
+      Bad = _mm256_permutevar8x32_epi32(Bad, Order);
+
+      uint32 Mask = (uint32)_mm256_movemask_epi8(_mm256_andnot_si256(Bad, Eq));
+      while (Mask != 0)
+      {
+         Sel[n++] = (uint16)(i + (__builtin_ctz(Mask) >> 1));
+         Mask &= Mask - 1;
+         Mask &= Mask - 1;
+      }
+   }
+#endif
+
+   for (; i < Count; ++i)
+   {
+      Sel[n] = (uint16)i;
+      n += (ApidCol[i] == Apid) & (TimeCol[i] - T1 <= T2 - T1);
+   }
+
+   return n;
+}
+
+/******************************************************************************
+**  Function:  COL_AddBlock()
+*/
+static bool COL_AddBlock (COL_Store_t *Store, const COL_BlockHdr_t *Hdr, uint8 *Data)
+{
+   if (Store->NumBlocks == Store->MaxBlocks)
+   {
+      uint32       Max = Store->MaxBlocks ? Store->MaxBlocks * 2 : 64;
+      COL_Block_t *New = realloc(Store->Blocks, Max * sizeof(COL_Block_t));
+      if (New == NULL) return false;
+      Store->Blocks    = New;
+      Store->MaxBlocks = Max;
+   }
+
+   Store->Blocks[Store->NumBlocks].Hdr  = *Hdr;
+   Store->Blocks[Store->NumBlocks].Data = Data;
+   Store->NumBlocks++;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  COL_DataBytes()
+*/
+static uint64 COL_DataBytes (const COL_BlockHdr_t *Hdr)
+{
+   return (uint64)Hdr->TimeBytes + Hdr->SeqBytes + Hdr->ApidBytes + Hdr->LenBytes + Hdr->PayloadBytes;
+}
+
+/******************************************************************************
+**  Function:  COL_Seal()
+**
+**  Compresses the staging rows into a new block and appends it to the file.
+*/
+static bool COL_Seal (COL_Store_t *Store)
+{
+   static uint64  Tmp[COL_BLOCK_ROWS];
+   COL_BlockHdr_t Hdr;
+   uint8         *Data;
+   uint8         *Ptr;
+   uint64         Prev, Or;
+   uint16         MaxSeq = 0, MaxLen = 0;
+   uint32         Rows = Store->Rows;
+   uint32         i;
+
+   if (Rows == 0) return true;
+
+   memset(&Hdr, 0, sizeof(Hdr));
+   Hdr.Magic       = COL_BLOCK_MAGIC;
+   Hdr.Rows        = Rows;
+   Hdr.FirstTimeNs = Store->Time[0];
+   Hdr.MinTimeNs   = Store->Time[0];
+   Hdr.MaxTimeNs   = Store->Time[0];
+   Hdr.MinApid     = Store->Apid[0];
+   Hdr.MaxApid     = Store->Apid[0];
+   Hdr.MinSeq      = Store->Seq[0];
+   Hdr.MinLen      = Store->Len[0];
+
+   /* Zone map and column ranges */
+   for (i = 0; i < Rows; ++i)
+   {
+      if (Store->Time[i] < Hdr.MinTimeNs) Hdr.MinTimeNs = Store->Time[i];
+      if (Store->Time[i] > Hdr.MaxTimeNs) Hdr.MaxTimeNs = Store->Time[i];
+      if (Store->Apid[i] < Hdr.MinApid)   Hdr.MinApid   = Store->Apid[i];
+      if (Store->Apid[i] > Hdr.MaxApid)   Hdr.MaxApid   = Store->Apid[i];
+      if (Store->Seq[i]  < Hdr.MinSeq)    Hdr.MinSeq    = Store->Seq[i];
+      if (Store->Seq[i]  > MaxSeq)        MaxSeq        = Store->Seq[i];
+      if (Store->Len[i]  < Hdr.MinLen)    Hdr.MinLen    = Store->Len[i];
+      if (Store->Len[i]  > MaxLen)        MaxLen        = Store->Len[i];
+      Hdr.ApidMask[Store->Apid[i] >> 3] |= (uint8)(1 << (Store->Apid[i] & 7));
+   }
+
+   /* Time deltas are zigzagged so an out-of-order stamp still packs */
+   for (i = 0, Prev = Hdr.FirstTimeNs, Or = 0; i < Rows; ++i)
+   {
+      int64 D = (int64)(Store->Time[i] - Prev);
+      Tmp[i]  = ((uint64)D << 1) ^ (uint64)(D >> 63);
+      Or     |= Tmp[i];
+      Prev    = Store->Time[i];
+   }
+
+   Hdr.TimeBits     = COL_BitWidth(Or);
+   Hdr.SeqBits      = COL_BitWidth((uint64)(MaxSeq - Hdr.MinSeq));
+   Hdr.ApidBits     = COL_BitWidth((uint64)(Hdr.MaxApid - Hdr.MinApid));
+   Hdr.LenBits      = COL_BitWidth((uint64)(MaxLen - Hdr.MinLen));
+   Hdr.TimeBytes    = COL_PACKED_BYTES(Rows, Hdr.TimeBits);
+   Hdr.SeqBytes     = COL_PACKED_BYTES(Rows, Hdr.SeqBits);
+   Hdr.ApidBytes    = COL_PACKED_BYTES(Rows, Hdr.ApidBits);
+   Hdr.LenBytes     = COL_PACKED_BYTES(Rows, Hdr.LenBits);
+   Hdr.PayloadBytes = Store->PayloadUsed;
+
+   Data = calloc(1, COL_DataBytes(&Hdr) + COL_PAD);
+   if (Data == NULL) return false;
+
+   Ptr  = Data;
+   Ptr += COL_Pack(Ptr, Tmp, Rows, Hdr.TimeBits);
+
+   for (i = 0; i < Rows; ++i) Tmp[i] = (uint64)(Store->Seq[i] - Hdr.MinSeq);
+   Ptr += COL_Pack(Ptr, Tmp, Rows, Hdr.SeqBits);
+
+   for (i = 0; i < Rows; ++i) Tmp[i] = (uint64)(Store->Apid[i] - Hdr.MinApid);
+   Ptr += COL_Pack(Ptr, Tmp, Rows, Hdr.ApidBits);
+
+   for (i = 0; i < Rows; ++i) Tmp[i] = (uint64)(Store->Len[i] - Hdr.MinLen);
+   Ptr += COL_Pack(Ptr, Tmp, Rows, Hdr.LenBits);
+
+   memcpy(Ptr, Store->Payload, Store->PayloadUsed);
+
+   if (Store->Fp != NULL)
+   {
+      if (fwrite(&Hdr, sizeof(Hdr), 1, Store->Fp) != 1 ||
+          fwrite(Data, COL_DataBytes(&Hdr), 1, Store->Fp) != 1)
+      {
+         free(Data);
+         return false;
+      }
+   }
+
+   if (!COL_AddBlock(Store, &Hdr, Data))
+   {
+      free(Data);
+      return false;
+   }
+
+   Store->Rows        = 0;
+   Store->PayloadUsed = 0;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  COL_Open()
+**
+**  Loads the blocks already in Path. When Writable, new blocks are appended
+**  after them and a torn block at the end of the file (crash during a
+**  write) is cut off. Path may be NULL for a store that lives only in
+**  memory.
+*/
+bool COL_Open (COL_Store_t *Store, const char *Path, bool Writable)
+{
+   COL_BlockHdr_t Hdr;
+   uint8         *Data;
+   long           Good = 0;
+
+   memset(Store, 0, sizeof(*Store));
+   if (Path == NULL) return true;
+
+   Store->Fp = fopen(Path, Writable ? "a+b" : "rb");
+   if (Store->Fp == NULL) return false;
+   rewind(Store->Fp);
+
+   while (fread(&Hdr, sizeof(Hdr), 1, Store->Fp) == 1)
+   {
+      if (Hdr.Magic != COL_BLOCK_MAGIC || Hdr.Rows == 0 || Hdr.Rows > COL_BLOCK_ROWS) break;
+
+      Data = calloc(1, COL_DataBytes(&Hdr) + COL_PAD);
+      if (Data == NULL) break;
+
+      if (fread(Data, COL_DataBytes(&Hdr), 1, Store->Fp) != 1 || !COL_AddBlock(Store, &Hdr, Data))
+      {
+         free(Data);
+         break;
+      }
+      Good = ftell(Store->Fp);
+   }
+
+   if (!Writable)
+   {
+      fclose(Store->Fp);
+      Store->Fp = NULL;
+      return true;
+   }
+
+   fflush(Store->Fp);
+   if (ftruncate(fileno(Store->Fp), Good) != 0)
+   {
+      COL_Close(Store);
+      return false;
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  COL_Append()
+*/
+bool COL_Append (COL_Store_t *Store, uint64 TimeNs, uint16 Apid, uint16 SeqCount,
+                 const uint8 *Payload, uint16 PayloadLen)
+{
+   uint32 Row;
+
+   if (Store->PayloadUsed + PayloadLen > Store->PayloadCap)
+   {
+      uint32 Cap = Store->PayloadCap ? Store->PayloadCap : 64 * 1024;
+      uint8 *New;
+
+      while (Cap < Store->PayloadUsed + PayloadLen) Cap *= 2;
+      New = realloc(Store->Payload, Cap);
+      if (New == NULL) return false;
+      Store->Payload    = New;
+      Store->PayloadCap = Cap;
+   }
+
+   Row = Store->Rows++;
+   Store->Time[Row] = TimeNs;
+   Store->Apid[Row] = Apid & 0x07FF;
+   Store->Seq[Row]  = SeqCount;
+   Store->Len[Row]  = PayloadLen;
+   memcpy(Store->Payload + Store->PayloadUsed, Payload, PayloadLen);
+   Store->PayloadUsed += PayloadLen;
+
+   return (Store->Rows < COL_BLOCK_ROWS) ? true : COL_Seal(Store);
+}
+
+/******************************************************************************
+**  Function:  COL_Flush()
+**
+**  Seals the staging rows as a (possibly short) block and flushes the file.
+*/
+bool COL_Flush (COL_Store_t *Store)
+{
+   if (!COL_Seal(Store)) return false;
+
+   return (Store->Fp == NULL) || (fflush(Store->Fp) == 0);
+}
+
+/******************************************************************************
+**  Function:  COL_Close()
+*/
+void COL_Close (COL_Store_t *Store)
+{
+   uint32 i;
+
+   COL_Flush(Store);
+   if (Store->Fp != NULL) fclose(Store->Fp);
+
+   for (i = 0; i < Store->NumBlocks; ++i) free(Store->Blocks[i].Data);
+   free(Store->Blocks);
+   free(Store->Payload);
+
+   memset(Store, 0, sizeof(*Store));
+}
+
+/******************************************************************************
+**  Function:  COL_Emit()
+**
+**  Hands the selected rows to the callback. Payload offsets are the prefix
+**  sum of the length column.
+*/
+static void COL_Emit (const uint16 *Sel, uint32 NumSel, const uint64 *TimeCol, const uint16 *ApidCol,
+                      const uint16 *SeqCol, const uint16 *LenCol, const uint8 *Payload,
+                      void (*Callback)(const COL_Row_t *Row, void *Arg), void *Arg)
+{
+   COL_Row_t Row;
+   uint32    Offset = 0;
+   uint32    Next   = 0;
+   uint32    s;
+
+   for (s = 0; s < NumSel; ++s)
+   {
+      while (Next < Sel[s]) Offset += LenCol[Next++];
+
+      Row.TimeNs   = TimeCol[Sel[s]];
+      Row.Apid     = ApidCol[Sel[s]];
+      Row.SeqCount = SeqCol[Sel[s]];
+      Row.Length   = LenCol[Sel[s]];
+      Row.Payload  = Payload + Offset;
+      Callback(&Row, Arg);
+   }
+}
+
+/******************************************************************************
+**  Function:  COL_Query()
+**
+**  Calls Callback for every row of Apid with T1Ns <= time <= T2Ns, in
+**  ingest order. Callback may be NULL to only count. Returns the number of
+**  matching rows.
+*/
+uint64 COL_Query (COL_Store_t      *Store,
+                  uint16            Apid,
+                  uint64            T1Ns,
+                  uint64            T2Ns,
+                  void            (*Callback)(const COL_Row_t *Row, void *Arg),
+                  void             *Arg,
+                  COL_QueryStats_t *Stats)
+{
+   static uint64    TimeCol[COL_BLOCK_ROWS];
+   static uint16    ApidCol[COL_BLOCK_ROWS];
+   static uint16    SeqCol[COL_BLOCK_ROWS];
+   static uint16    LenCol[COL_BLOCK_ROWS];
+   static uint16    Sel[COL_BLOCK_ROWS];
+   COL_QueryStats_t Local;
+   uint32           b, n;
+
+   if (Stats == NULL) Stats = &Local;
+   memset(Stats, 0, sizeof(*Stats));
+   if (T1Ns > T2Ns) return 0;
+
+   Apid &= 0x07FF;
+
+   for (b = 0; b < Store->NumBlocks; ++b)
+   {
+      const COL_BlockHdr_t *Hdr  = &Store->Blocks[b].Hdr;
+      const uint8          *Data = Store->Blocks[b].Data;
+
+      Stats->BlocksTotal++;
+
+      /* Zone map */
+      if (Hdr->MaxTimeNs < T1Ns || Hdr->MinTimeNs > T2Ns) continue;
+      if (Apid < Hdr->MinApid || Apid > Hdr->MaxApid) continue;
+      if ((Hdr->ApidMask[Apid >> 3] & (1 << (Apid & 7))) == 0) continue;
+
+      Stats->BlocksScanned++;
+      Stats->RowsScanned += Hdr->Rows;
+
+      COL_UnpackTime(TimeCol, Data, Hdr->Rows, Hdr->TimeBits, Hdr->FirstTimeNs);
+      COL_Unpack16(ApidCol, Data + Hdr->TimeBytes + Hdr->SeqBytes, Hdr->Rows, Hdr->ApidBits, Hdr->MinApid);
+
+      n = COL_Select(ApidCol, TimeCol, Hdr->Rows, Apid, T1Ns, T2Ns, Sel);
+      Stats->RowsMatched += n;
+      if (n == 0 || Callback == NULL) continue;
+
+      /* Remaining columns only for blocks with hits */
+      COL_Unpack16(SeqCol, Data + Hdr->TimeBytes, Hdr->Rows, Hdr->SeqBits, Hdr->MinSeq);
+      COL_Unpack16(LenCol, Data + Hdr->TimeBytes + Hdr->SeqBytes + Hdr->ApidBytes, Hdr->Rows,
+                   Hdr->LenBits, Hdr->MinLen);
+
+      COL_Emit(Sel, n, TimeCol, ApidCol, SeqCol, LenCol,
+               Data + Hdr->TimeBytes + Hdr->SeqBytes + Hdr->ApidBytes + Hdr->LenBytes, Callback, Arg);
+   }
+
+   /* Staging rows are already columnar, scan them in place */
+   if (Store->Rows > 0)
+   {
+      Stats->RowsScanned += Store->Rows;
+
+      n = COL_Select(Store->Apid, Store->Time, Store->Rows, Apid, T1Ns, T2Ns, Sel);
+      Stats->RowsMatched += n;
+      if (n > 0 && Callback != NULL)
+      {
+         COL_Emit(Sel, n, Store->Time, Store->Apid, Store->Seq, Store->Len, Store->Payload, Callback, Arg);
+      }
+   }
+
+   return Stats->RowsMatched;
+}
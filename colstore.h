@@ -0,0 +1,136 @@
+/*
+**  Columnar Telemetry Store
+**
+**  Decoded packets are ingested row by row into a staging block. When a
+**  block fills up it is sealed: each header column is compressed on its
+**  own and a zone map is computed. The sealed block is then appended to
+**  the store file.
+**
+**     Time      delta from the previous row, zigzag, bit-packed
+**     SeqCount  frame of reference (minus block minimum), bit-packed
+**     Apid      frame of reference, bit-packed
+**     Length    frame of reference, bit-packed
+**     Payload   concatenated bytes; offsets are the prefix sum of Length
+**
+**  Queries on (APID, time range) skip blocks by zone map: min/max time,
+**  min/max APID and an APID presence bitmap. Only the APID and time
+**  columns of the remaining blocks are decoded, then they are scanned
+**  (AVX2 when available) into a selection of matching rows.
+*/
+
+#ifndef _colstore_
+#define _colstore_
+
+/*
+** Includes
+*/
+#include <stdio.h>
+
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define COL_BLOCK_ROWS      4096
+#define COL_BLOCK_MAGIC     0x4B4C4243u      /* "CBLK" */
+
+/*----- Sealed block header (followed by the packed columns) -----*/
+typedef struct {
+
+   uint32  Magic;
+   uint32  Rows;
+
+   /* Zone map */
+   uint64  MinTimeNs;
+   uint64  MaxTimeNs;
+   uint16  MinApid;
+   uint16  MaxApid;
+   uint8   ApidMask[CCSDS_MAX_APID / 8];
+
+   /* Column encodings */
+   uint64  FirstTimeNs;
+   uint16  MinSeq;
+   uint16  MinLen;
+   uint8   TimeBits;
+   uint8   SeqBits;
+   uint8   ApidBits;
+   uint8   LenBits;
+
+   /* Column sizes in bytes, in storage order */
+   uint32  TimeBytes;
+   uint32  SeqBytes;
+   uint32  ApidBytes;
+   uint32  LenBytes;
+   uint32  PayloadBytes;
+
+} COL_BlockHdr_t;
+
+/*----- One sealed block in memory -----*/
+typedef struct {
+
+   COL_BlockHdr_t  Hdr;
+   uint8          *Data;       /* Packed columns then payload heap */
+
+} COL_Block_t;
+
+/*----- One query result row -----*/
+typedef struct {
+
+   uint64        TimeNs;
+   uint16        Apid;
+   uint16        SeqCount;
+   uint16        Length;      /* Payload bytes */
+   const uint8  *Payload;
+
+} COL_Row_t;
+
+/*----- Store -----*/
+typedef struct {
+
+   FILE         *Fp;          /* Sealed blocks are appended here, may be NULL */
+
+   COL_Block_t  *Blocks;
+   uint32        NumBlocks;
+   uint32        MaxBlocks;
+
+   /* Staging block */
+   uint32        Rows;
+   uint64        Time[COL_BLOCK_ROWS];
+   uint16        Seq[COL_BLOCK_ROWS];
+   uint16        Apid[COL_BLOCK_ROWS];
+   uint16        Len[COL_BLOCK_ROWS];
+   uint8        *Payload;
+   uint32        PayloadUsed;
+   uint32        PayloadCap;
+
+} COL_Store_t;
+
+/*----- Query statistics -----*/
+typedef struct {
+
+   uint32  BlocksTotal;
+   uint32  BlocksScanned;
+   uint64  RowsScanned;
+   uint64  RowsMatched;
+
+} COL_QueryStats_t;
+
+
+/*
+** Exported Functions
+*/
+bool   COL_Open   (COL_Store_t *Store, const char *Path, bool Writable);
+bool   COL_Append (COL_Store_t *Store, uint64 TimeNs, uint16 Apid, uint16 SeqCount,
+                   const uint8 *Payload, uint16 PayloadLen);
+bool   COL_Flush  (COL_Store_t *Store);
+void   COL_Close  (COL_Store_t *Store);
+
+uint64 COL_Query  (COL_Store_t      *Store,
+                   uint16            Apid,
+                   uint64            T1Ns,
+                   uint64            T2Ns,
+                   void            (*Callback)(const COL_Row_t *Row, void *Arg),
+                   void             *Arg,
+                   COL_QueryStats_t *Stats);
+
+#endif  /* _colstore_ */
@@ -0,0 +1,171 @@
+/*
+** File: hdrbench.c
+** Role: BENCHMARK (command header decode and encode)
+** Description: Compares the one-word header path in ccsds.h against the
+**              per-field CCSDS_RD_* / CCSDS_WR_* macros it replaced.
+**              Every random header is first decoded both ways and all
+**              fields compared, then re-encoded and compared byte for byte;
+**              a packet built with CCSDS_BuildTelecommand must equal one
+**              built field by field with the macros, and length fields
+**              0xFFF0-0xFFFF must decode to their full 32-bit totals. Any
+**              mismatch exits non-zero. Then each path is timed.
+**
+** Usage:       hdrbench [-n headers] [-r rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ccsds.h"
+#include "latency.h"
+
+#define BUILD_PAYLOAD  8
+
+// The macro path, field by field
+static void decode_macros(const uint8 *buf, CCSDS_CmdHdr_t *hdr) {
+    const CCSDS_CommandPacket_t *pkt = (const CCSDS_CommandPacket_t *)buf;
+
+    hdr->Version  = (uint8)CCSDS_RD_VERS(pkt->SpacePacket.Hdr);
+    hdr->Type     = (uint8)CCSDS_RD_TYPE(pkt->SpacePacket.Hdr);
+    hdr->SecHdr   = (uint8)CCSDS_RD_SHDR(pkt->SpacePacket.Hdr);
+    hdr->Apid     = (uint16)CCSDS_RD_APID(pkt->SpacePacket.Hdr);
+    hdr->SeqFlags = (uint8)CCSDS_RD_SEQFLG(pkt->SpacePacket.Hdr);
+    hdr->SeqCount = (uint16)CCSDS_RD_SEQ(pkt->SpacePacket.Hdr);
+    hdr->Length   = (uint32)CCSDS_RD_LEN(pkt->SpacePacket.Hdr);
+    hdr->FuncCode = (uint8)CCSDS_RD_FC(pkt->Sec);
+    hdr->CheckSum = (uint8)CCSDS_RD_CHECKSUM(pkt->Sec);
+}
+
+// CCSDS_BuildTelecommand as it was before the encoder; out of line like
+// the library function, so both calls cost the same
+static __attribute__((noinline)) uint16 build_macros(uint8 *buf, uint16 apid, uint16 seq, uint8 fc, const uint8 *payload, uint16 len) {
+    CCSDS_CommandPacket_t *pkt = (CCSDS_CommandPacket_t *)buf;
+    uint16 total = (uint16)(sizeof(CCSDS_CommandPacket_t) + len);
+
+    CCSDS_CLR_PRI_HDR(pkt->SpacePacket.Hdr);
+    CCSDS_CLR_CMDSEC_HDR(pkt->Sec);
+    CCSDS_WR_TYPE(pkt->SpacePacket.Hdr, CCSDS_CMD);
+    CCSDS_WR_SHDR(pkt->SpacePacket.Hdr, CCSDS_HAS_SEC_HDR);
+    CCSDS_WR_APID(pkt->SpacePacket.Hdr, apid);
+    CCSDS_WR_SEQ(pkt->SpacePacket.Hdr, seq);
+    CCSDS_WR_LEN(pkt->SpacePacket.Hdr, total);
+    CCSDS_WR_FC(pkt->Sec, fc);
+    for (uint16 i = 0; i < len; i++) buf[sizeof(CCSDS_CommandPacket_t) + i] = payload[i];
+    CCSDS_LoadCheckSum(pkt);
+    return total;
+}
+
+static bool same_fields(const CCSDS_CmdHdr_t *a, const CCSDS_CmdHdr_t *b) {
+    return a->Version == b->Version && a->Type == b->Type && a->SecHdr == b->SecHdr && a->Apid == b->Apid &&
+           a->SeqFlags == b->SeqFlags && a->SeqCount == b->SeqCount && a->Length == b->Length &&
+           a->FuncCode == b->FuncCode && a->CheckSum == b->CheckSum;
+}
+
+static void fail(const char *what, uint32 i) {
+    fprintf(stderr, "[HDR] %s differs at header %u\n", what, i);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    long count = 4096, rounds = 2000;
+    uint8 payload[BUILD_PAYLOAD] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8 a[sizeof(CCSDS_CommandPacket_t) + BUILD_PAYLOAD], b[sizeof(a)];
+    volatile uint32 sink = 0;
+    uint64 start, ns_macros, ns_word, ns_build_macros, ns_build_word;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': count = atol(optarg); break;
+            case 'r': rounds = atol(optarg); break;
+            default:  count = 0; break;
+        }
+    }
+    if (count < 1 || rounds < 1) {
+        fprintf(stderr, "Usage: %s [-n headers] [-r rounds]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Header bytes only (the reserved bit of Command[0] is part of the word)
+    uint8 *bufs = malloc((size_t)count * 8);
+    srand(1);
+    for (long i = 0; i < count * 8; i++) bufs[i] = (uint8)rand();
+
+    for (uint32 i = 0; i < (uint32)count; i++) {
+        CCSDS_CmdHdr_t m, w;
+        uint8 out[8];
+        decode_macros(bufs + i * 8, &m);
+        CCSDS_DecodeCmdHdr(bufs + i * 8, &w);
+        if (!same_fields(&m, &w)) fail("Decoded field", i);
+        CCSDS_EncodeCmdHdr(out, &w);
+        out[6] = (uint8)((out[6] & 0x7F) | (bufs[i * 8 + 6] & 0x80));   // Reserved bit is not a field
+        if (memcmp(out, bufs + i * 8, 8) != 0) fail("Re-encoded header", i);
+
+        uint16 apid = (uint16)(m.Apid), seq = m.SeqCount;
+        memset(a, 0xA5, sizeof(a));
+        memset(b, 0x5A, sizeof(b));
+        build_macros(a, apid, seq, m.FuncCode, payload, BUILD_PAYLOAD);
+        CCSDS_BuildTelecommand(b, sizeof(b), apid, seq, m.FuncCode, payload, BUILD_PAYLOAD);
+        if (memcmp(a, b, sizeof(a)) != 0) fail("Built packet", i);
+    }
+
+    // Length fields 0xFFF9 and up are totals past 0xFFFF, which a 16-bit
+    // Length would wrap (0xFFFF + 7 to 6)
+    for (uint32 field = 0xFFF0; field <= 0xFFFF; field++) {
+        CCSDS_CmdHdr_t m, w;
+        uint8 in[8] = { 0x18, 0x10, 0xC0, 0x01, (uint8)(field >> 8), (uint8)field, 0x0A, 0x5A }, out[8];
+        decode_macros(in, &m);
+        CCSDS_DecodeCmdHdr(in, &w);
+        if (!same_fields(&m, &w) || w.Length != field + 7) fail("Decoded length", field);
+        CCSDS_EncodeCmdHdr(out, &w);
+        if (memcmp(out, in, 8) != 0) fail("Re-encoded length", field);
+    }
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (uint32 i = 0; i < (uint32)count; i++) {
+            CCSDS_CmdHdr_t h;
+            decode_macros(bufs + i * 8, &h);
+            sink += h.Apid + h.SeqCount + h.Length + h.FuncCode;
+        }
+    }
+    ns_macros = LAT_NowNs() - start;
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (uint32 i = 0; i < (uint32)count; i++) {
+            CCSDS_CmdHdr_t h;
+            CCSDS_DecodeCmdHdr(bufs + i * 8, &h);
+            sink += h.Apid + h.SeqCount + h.Length + h.FuncCode;
+        }
+    }
+    ns_word = LAT_NowNs() - start;
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (uint32 i = 0; i < (uint32)count; i++) {
+            sink += build_macros(a, (uint16)(i & 0x7FF), (uint16)(r & 0x3FFF), 0x10, payload, BUILD_PAYLOAD) + a[7];
+        }
+    }
+    ns_build_macros = LAT_NowNs() - start;
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (uint32 i = 0; i < (uint32)count; i++) {
+            sink += CCSDS_BuildTelecommand(a, sizeof(a), (uint16)(i & 0x7FF), (uint16)(r & 0x3FFF), 0x10,
+                                           payload, BUILD_PAYLOAD) + a[7];
+        }
+    }
+    ns_build_word = LAT_NowNs() - start;
+
+    double n = (double)count * rounds;
+    printf("[HDR] %ld headers x %ld rounds, all fields and built packets identical\n", count, rounds);
+    printf("[HDR] decode   macros %6.2f ns/header   one word %6.2f ns/header\n", ns_macros / n, ns_word / n);
+    printf("[HDR] build    macros %6.2f ns/packet   one word %6.2f ns/packet  (%d byte payload)\n",
+           ns_build_macros / n, ns_build_word / n, BUILD_PAYLOAD);
+
+    free(bufs);
+    return sink == 0xFFFFFFFFu;
+}
@@ -0,0 +1,202 @@
+/*
+**  Latency Measurement - Stamps and HDR Histograms
+*/
+
+#include <string.h>
+#include <time.h>
+
+#include "latency.h"
+
+#define LAT_HALF  (1u << (LAT_SUB_BITS - 1))
+
+/******************************************************************************
+**  Function:  LAT_NowNs()
+*/
+uint64 LAT_NowNs (void)
+{
+   struct timespec Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return (uint64)Ts.tv_sec * 1000000000ull + (uint64)Ts.tv_nsec;
+}
+
+/******************************************************************************
+**  Function:  LAT_WaitUntil()
+**
+**  Waits for a LAT_NowNs() deadline: sleeps until 20 us before it when it
+**  is more than 50 us away, then spins the rest (with the CPU spin hint),
+**  so pacing is not at the mercy of timer slack.
+*/
+void LAT_WaitUntil (uint64 DeadlineNs)
+{
+   struct timespec Ts;
+   uint64          Wake;
+
+   if (DeadlineNs > LAT_NowNs() + 50000)
+   {
+      Wake       = DeadlineNs - 20000;
+      Ts.tv_sec  = (time_t)(Wake / 1000000000ull);
+      Ts.tv_nsec = (long)(Wake % 1000000000ull);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Ts, NULL);
+   }
+
+   while (LAT_NowNs() < DeadlineNs) CCSDS_CpuRelax();
+}
+
+/******************************************************************************
+**  Function:  LAT_BucketOf()
+*/
+static uint32 LAT_BucketOf (uint64 Value)
+{
+   uint32 Msb, Shift;
+
+   if (Value < (1u << LAT_SUB_BITS)) return (uint32)Value;
+
+   Msb   = 63 - (uint32)__builtin_clzll(Value);
+   Shift = Msb - (LAT_SUB_BITS - 1);
+
+   return (1u << LAT_SUB_BITS) + (Shift - 1) * LAT_HALF + (uint32)(Value >> Shift) - LAT_HALF;
+}
+
+/******************************************************************************
+**  Function:  LAT_BucketTop()
+**
+**  Highest value that falls in Bucket.
+*/
+static uint64 LAT_BucketTop (uint32 Bucket)
+{
+   uint32 Shift;
+   uint64 Sub;
+
+   if (Bucket < (1u << LAT_SUB_BITS)) return Bucket;
+
+   Shift = (Bucket - (1u << LAT_SUB_BITS)) / LAT_HALF + 1;
+   Sub   = (Bucket - (1u << LAT_SUB_BITS)) % LAT_HALF + LAT_HALF;
+
+   return ((Sub + 1) << Shift) - 1;
+}
+
+/******************************************************************************
+**  Function:  LAT_InitHist()
+*/
+void LAT_InitHist (LAT_Hist_t *Hist)
+{
+   memset(Hist, 0, sizeof(*Hist));
+   Hist->MinNs = ~0ull;
+}
+
+/******************************************************************************
+**  Function:  LAT_Record()
+*/
+void LAT_Record (LAT_Hist_t *Hist, uint64 ValueNs)
+{
+   uint64 Cur;
+
+   if (ValueNs > LAT_MAX_NS) ValueNs = LAT_MAX_NS;
+
+   __atomic_fetch_add(&Hist->Counts[LAT_BucketOf(ValueNs)], 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&Hist->SumNs, ValueNs, __ATOMIC_RELAXED);
+
+   Cur = __atomic_load_n(&Hist->MaxNs, __ATOMIC_RELAXED);
+   while (ValueNs > Cur &&
+          !__atomic_compare_exchange_n(&Hist->MaxNs, &Cur, ValueNs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+
+   Cur = __atomic_load_n(&Hist->MinNs, __ATOMIC_RELAXED);
+   while (ValueNs < Cur &&
+          !__atomic_compare_exchange_n(&Hist->MinNs, &Cur, ValueNs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+
+   /* Last, so a reader never sees a total its buckets do not add up to */
+   __atomic_fetch_add(&Hist->Total, 1, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+**  Function:  LAT_Percentile()
+**
+**  Value at or below which Percent of the recorded values fall, reported
+**  as the top of its bucket and never above the recorded maximum.
+*/
+uint64 LAT_Percentile (const LAT_Hist_t *Hist, double Percent)
+{
+   uint64 Total = __atomic_load_n(&Hist->Total, __ATOMIC_ACQUIRE);
+   uint64 Max   = __atomic_load_n(&Hist->MaxNs, __ATOMIC_RELAXED);
+   uint64 Target, Seen = 0;
+   uint32 b;
+
+   if (Total == 0) return 0;
+
+   Target = (uint64)(Percent / 100.0 * (double)Total + 0.5);
+   if (Target < 1)     Target = 1;
+   if (Target > Total) Target = Total;
+
+   for (b = 0; b < LAT_BUCKETS; ++b)
+   {
+      Seen += __atomic_load_n(&Hist->Counts[b], __ATOMIC_RELAXED);
+      if (Seen >= Target)
+      {
+         uint64 Top = LAT_BucketTop(b);
+         return (Top < Max) ? Top : Max;
+      }
+   }
+
+   return Max;
+}
+
+/******************************************************************************
+**  Function:  LAT_Report()
+*/
+void LAT_Report (FILE *Fp, const char *Name, const LAT_Hist_t *Hist)
+{
+   uint64 Total = __atomic_load_n(&Hist->Total, __ATOMIC_ACQUIRE);
+
+   if (Total == 0)
+   {
+      fprintf(Fp, "   %-24s      no samples\n", Name);
+      return;
+   }
+
+   fprintf(Fp, "   %-24s n=%-9llu mean %9.1f  p50 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f us\n",
+           Name, (unsigned long long)Total,
+           (double)__atomic_load_n(&Hist->SumNs, __ATOMIC_RELAXED) / (double)Total / 1e3,
+           LAT_Percentile(Hist, 50.0) / 1e3,
+           LAT_Percentile(Hist, 99.0) / 1e3,
+           LAT_Percentile(Hist, 99.9) / 1e3,
+           __atomic_load_n(&Hist->MaxNs, __ATOMIC_RELAXED) / 1e3);
+}
+
+/******************************************************************************
+**  Function:  LAT_WriteJson()
+**
+**  Writes the histogram as one JSON object: summary, percentile ladder and
+**  every non-empty bucket as [top_ns, count].
+*/
+void LAT_WriteJson (FILE *Fp, const LAT_Hist_t *Hist)
+{
+   static const double Ladder[] = { 50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 99.999 };
+   uint64 Total = __atomic_load_n(&Hist->Total, __ATOMIC_ACQUIRE);
+   uint64 Count;
+   bool   First = true;
+   uint32 i;
+
+   uint64 MinNs = __atomic_load_n(&Hist->MinNs, __ATOMIC_RELAXED);
+   uint64 MaxNs = __atomic_load_n(&Hist->MaxNs, __ATOMIC_RELAXED);
+   uint64 SumNs = __atomic_load_n(&Hist->SumNs, __ATOMIC_RELAXED);
+
+   fprintf(Fp, "{\"count\": %llu, \"min_ns\": %llu, \"max_ns\": %llu, \"mean_ns\": %.1f, \"percentiles_ns\": {",
+           (unsigned long long)Total, (unsigned long long)(Total ? MinNs : 0),
+           (unsigned long long)MaxNs, Total ? (double)SumNs / (double)Total : 0.0);
+
+   for (i = 0; i < sizeof(Ladder) / sizeof(Ladder[0]); ++i)
+   {
+      fprintf(Fp, "%s\"%g\": %llu", i ? ", " : "", Ladder[i], (unsigned long long)LAT_Percentile(Hist, Ladder[i]));
+   }
+
+   fprintf(Fp, "}, \"buckets\": [");
+   for (i = 0; i < LAT_BUCKETS; ++i)
+   {
+      Count = __atomic_load_n(&Hist->Counts[i], __ATOMIC_RELAXED);
+      if (Count == 0) continue;
+      fprintf(Fp, "%s[%llu, %llu]", First ? "" : ", ", (unsigned long long)LAT_BucketTop(i), (unsigned long long)Count);
+      First = false;
+   }
+   fprintf(Fp, "]}");
+}
@@ -0,0 +1,78 @@
+/*
+**  Latency Measurement - Stamps and HDR Histograms
+**
+**  A sender in latency mode appends an LAT_Stamp_t to the command payload
+**  with CLOCK_MONOTONIC times taken at build and at send. The receiver
+**  adds its own stage times and records the differences into histograms.
+**  Both ends must share the clock, i.e. run on the same host.
+**
+**  Histograms are HDR (high dynamic range) log-linear: values below
+**  2^LAT_SUB_BITS ns are exact, above that every power of two is split
+**  into 2^(LAT_SUB_BITS-1) linear sub-buckets, so the error stays under
+**  1% from nanoseconds to LAT_MAX_NS. Recording is a few relaxed atomic
+**  adds, so any thread may record while another reads percentiles.
+*/
+
+#ifndef _latency_
+#define _latency_
+
+/*
+** Includes
+*/
+#include <stdio.h>
+
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define LAT_SUB_BITS      8
+#define LAT_MAX_BITS      40                     /* Values clamp at ~18 minutes */
+#define LAT_MAX_NS        ((1ull << LAT_MAX_BITS) - 1)
+#define LAT_BUCKETS       ((1u << LAT_SUB_BITS) + (LAT_MAX_BITS - LAT_SUB_BITS) * (1u << (LAT_SUB_BITS - 1)))
+
+#define LAT_STAMP_MAGIC   0x4C415453u            /* "LATS" */
+
+/*----- Stamp carried at the end of the command payload -----*/
+typedef struct {
+
+   uint32  Magic;
+   uint32  Spare;
+   uint64  BuildNs;       /* Before CCSDS_BuildTelecommand */
+   uint64  SendNs;        /* Just before the send call */
+
+} LAT_Stamp_t;
+
+/*----- Histogram -----*/
+typedef struct {
+
+   uint64  Counts[LAT_BUCKETS];
+   uint64  Total;
+   uint64  SumNs;
+   uint64  MinNs;         /* ~0 while empty */
+   uint64  MaxNs;
+
+} LAT_Hist_t;
+
+
+/*
+** Exported Functions
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64 LAT_NowNs      (void);
+void   LAT_WaitUntil  (uint64 DeadlineNs);
+
+void   LAT_InitHist   (LAT_Hist_t *Hist);
+void   LAT_Record     (LAT_Hist_t *Hist, uint64 ValueNs);
+uint64 LAT_Percentile (const LAT_Hist_t *Hist, double Percent);
+void   LAT_Report     (FILE *Fp, const char *Name, const LAT_Hist_t *Hist);
+void   LAT_WriteJson  (FILE *Fp, const LAT_Hist_t *Hist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _latency_ */
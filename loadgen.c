@@ -0,0 +1,335 @@
+/*
+** File: loadgen.c
+** Role: SENDER (Load Generator)
+** Description: Sends telecommands on an open-loop schedule for capacity
+**              tests. Send times are fixed in advance from the rate
+**              profile. A sender that falls behind sends the overdue
+**              packets back to back (one sendmmsg) and never shifts the
+**              schedule, so a slow receiver or a stalled socket shows up
+**              as lag instead of a quietly lower rate (no coordinated
+**              omission). Lag behind schedule is recorded in a histogram.
+**
+**              With -l every packet carries a LAT_Stamp_t whose build time
+**              is the scheduled time, so the receiver's -l report measures
+**              from when the packet should have left.
+**
+**              With -g (fixed size only) each flush goes out as UDP GSO
+**              sends: the due packets of a batch are one message whose
+**              iovecs the kernel cuts back into datagrams of the packet
+**              size (UDP_SEGMENT), so a whole batch costs one trip down
+**              the stack instead of one per packet.
+**
+** Usage:       loadgen [-t ip] [-p port] [-r rate] [-m const|poisson|burst]
+**                      [-B burst] [-n streams] [-a apid] [-s sizes] [-d secs]
+**                      [-b batch] [-l] [-g]
+**              -r 0         line rate (no pacing)
+**              -s 64        fixed payload size (prebuilt templates)
+**              -s 16-512    uniform payload size
+**              -s 64,576,1400  one of the listed sizes, equally likely
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <errno.h>
+#include <stddef.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#include "ccsds.h"
+#include "latency.h"
+
+#define TARGET_IP     "127.0.0.1"
+#define TARGET_PORT   8888
+#define MAX_BATCH     64
+#define MAX_STREAMS   2048
+#define MAX_SIZES     16
+#define MAX_PAYLOAD   (65507 - sizeof(CCSDS_CommandPacket_t))   // Largest UDP/IPv4 datagram
+#define GSO_MAX_BYTES 65507                                     // One GSO send is still one UDP datagram
+
+enum { PROFILE_CONST, PROFILE_POISSON, PROFILE_BURST };
+
+struct stream {
+    uint16 apid;
+    uint16 seq;
+    CCSDS_CmdTemplate_t tmpl;      // Fixed-size mode only
+    uint8 *tmpl_buf;
+};
+
+static uint64 rng_state = 0x2545F4914F6CDD1Dull;
+
+static uint64 rng_next(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+// Uniform in (0, 1]
+static double rng_unit(void) {
+    return ((double)(rng_next() >> 11) + 1.0) / 9007199254740992.0;
+}
+
+// "64", "16-512" or "64,576,1400"
+static int parse_sizes(const char *spec, uint16 *sizes, uint16 *lo, uint16 *hi) {
+    char *end;
+    long a = strtol(spec, &end, 10);
+    int n = 0;
+
+    if (*end == '-') {
+        long b = strtol(end + 1, &end, 10);
+        if (*end != '\0' || a < 0 || b < a || b > (long)MAX_PAYLOAD) return -1;
+        *lo = (uint16)a;
+        *hi = (uint16)b;
+        return 0;
+    }
+
+    for (;;) {
+        if (a < 0 || a > (long)MAX_PAYLOAD || n == MAX_SIZES) return -1;
+        sizes[n++] = (uint16)a;
+        if (*end == '\0') return n;
+        if (*end != ',') return -1;
+        a = strtol(end + 1, &end, 10);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *target_ip = TARGET_IP;
+    int target_port = TARGET_PORT;
+    double rate = 1000.0;
+    int profile = PROFILE_CONST;
+    int burst = 16;
+    int num_streams = 1;
+    int base_apid = 0x100;
+    double duration = 10.0;
+    int batch = 32;
+    bool stamp_mode = false;
+    bool gso = false;
+    uint16 sizes[MAX_SIZES] = { 64 };
+    int num_sizes = 1;
+    uint16 size_lo = 0, size_hi = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:p:r:m:B:n:a:s:d:b:lg")) != -1) {
+        switch (opt) {
+            case 't': target_ip = optarg; break;
+            case 'p': target_port = atoi(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            case 'm':
+                if      (strcmp(optarg, "const") == 0)   profile = PROFILE_CONST;
+                else if (strcmp(optarg, "poisson") == 0) profile = PROFILE_POISSON;
+                else if (strcmp(optarg, "burst") == 0)   profile = PROFILE_BURST;
+                else rate = -1;
+                break;
+            case 'B': burst = atoi(optarg); break;
+            case 'n': num_streams = atoi(optarg); break;
+            case 'a': base_apid = (int)strtol(optarg, NULL, 0); break;
+            case 's': num_sizes = parse_sizes(optarg, sizes, &size_lo, &size_hi); break;
+            case 'd': duration = atof(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            case 'l': stamp_mode = true; break;
+            case 'g': gso = true; break;
+            default:  rate = -1; break;
+        }
+    }
+    if (rate < 0 || burst < 1 || num_streams < 1 || num_streams > MAX_STREAMS || num_sizes < 0 ||
+        base_apid < 0 || base_apid + num_streams > CCSDS_MAX_APID || duration <= 0 ||
+        batch < 1 || batch > MAX_BATCH || (gso && num_sizes != 1)) {
+        fprintf(stderr, "Usage: %s [-t ip] [-p port] [-r rate|0] [-m const|poisson|burst] [-B burst]\n"
+                        "       [-n streams] [-a base_apid] [-s N|A-B|A,B,..] [-d secs] [-b batch<=%d] [-l]\n"
+                        "       [-g]  (UDP GSO, fixed size only)\n",
+                argv[0], MAX_BATCH);
+        exit(EXIT_FAILURE);
+    }
+
+    // The stamp needs room at the end of every payload
+    uint16 min_payload = stamp_mode ? (uint16)sizeof(LAT_Stamp_t) : 0;
+    if (num_sizes == 0 && size_lo < min_payload) size_lo = min_payload;
+    for (int i = 0; i < num_sizes; i++) if (sizes[i] < min_payload) sizes[i] = min_payload;
+    if (size_hi < size_lo) size_hi = size_lo;
+
+    int sockfd;
+    struct sockaddr_in servaddr;
+
+    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        perror("Socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_port = htons(target_port);
+    servaddr.sin_addr.s_addr = inet_addr(target_ip);
+
+    if (connect(sockfd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
+        perror("Connect failed");
+        exit(EXIT_FAILURE);
+    }
+
+    // GSO: every datagram is one packet of the fixed size, a send carries
+    // at most as many as fit in one 64 KiB UDP datagram
+    int per_msg = 1;
+    if (gso) {
+        int seg = (int)(sizeof(CCSDS_CommandPacket_t) + sizes[0]);
+        per_msg = GSO_MAX_BYTES / seg;
+        if (per_msg > batch) per_msg = batch;
+        if (per_msg < 1) per_msg = 1;
+        if (setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &seg, sizeof(seg)) < 0) {
+            perror("UDP_SEGMENT not supported");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Payload pattern shared by every packet
+    static uint8 pattern[MAX_PAYLOAD];
+    for (size_t i = 0; i < sizeof(pattern); i++) pattern[i] = (uint8)('A' + i % 26);
+
+    // Fixed size: one prebuilt template per stream, patched per packet
+    bool fixed = (num_sizes == 1);
+    static struct stream streams[MAX_STREAMS];
+    for (int i = 0; i < num_streams; i++) {
+        streams[i].apid = (uint16)(base_apid + i);
+        if (fixed) {
+            streams[i].tmpl_buf = malloc(sizeof(CCSDS_CommandPacket_t) + sizes[0]);
+            if (streams[i].tmpl_buf == NULL ||
+                CCSDS_InitCmdTemplate(&streams[i].tmpl, streams[i].tmpl_buf,
+                                      (uint16)(sizeof(CCSDS_CommandPacket_t) + sizes[0]),
+                                      streams[i].apid, 0x0A, pattern, sizes[0]) == 0) {
+                fprintf(stderr, "[LOADGEN] Template build failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    static uint8 slots[MAX_BATCH][sizeof(CCSDS_CommandPacket_t) + MAX_PAYLOAD];
+    static struct mmsghdr msgs[MAX_BATCH];
+    static struct iovec iovs[MAX_BATCH];
+    static uint64 slot_due[MAX_BATCH];
+    static LAT_Hist_t lag;
+    LAT_InitHist(&lag);
+    memset(msgs, 0, sizeof(msgs));
+
+    const char *profile_names[] = { "constant", "poisson", "burst" };
+    printf("[LOADGEN] %s -> %s:%d, %.0f pkt/s, %d streams from APID 0x%03X, %.1f s%s%s\n",
+           rate > 0 ? profile_names[profile] : "line rate", target_ip, target_port,
+           rate, num_streams, base_apid, duration, stamp_mode ? ", latency stamps" : "",
+           gso ? ", UDP GSO" : "");
+
+    uint64 start = LAT_NowNs() + 1000000;   // First packet 1 ms out
+    uint64 end = start + (uint64)(duration * 1e9);
+    uint64 due = start;
+    uint64 sent = 0, bytes = 0, errors = 0, scheduled = 0;
+    uint64 burst_left = (uint64)burst;
+    int pending = 0;
+    int stream_rr = 0;
+
+    for (;;) {
+        bool last = (due >= end);
+
+        // Next slot not due yet (or schedule over): flush what is due, then wait
+        if (pending > 0 && (last || pending == batch || due > LAT_NowNs())) {
+            uint64 now = LAT_NowNs();
+            int num_msgs = 0;
+            int done = 0;
+
+            // One message per packet, or per GSO run of per_msg packets
+            for (int i = 0; i < pending; i += per_msg) {
+                msgs[num_msgs].msg_hdr.msg_iov = &iovs[i];
+                msgs[num_msgs].msg_hdr.msg_iovlen = (size_t)(pending - i < per_msg ? pending - i : per_msg);
+                num_msgs++;
+            }
+
+            while (done < num_msgs) {
+                int n = sendmmsg(sockfd, msgs + done, (unsigned)(num_msgs - done), 0);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    errors += msgs[done].msg_hdr.msg_iovlen;   // ENOBUFS and friends: count, drop, keep the schedule
+                    done++;
+                    continue;
+                }
+                for (int m = done; m < done + n; m++) {
+                    int first = m * per_msg;
+                    for (int i = first; i < first + (int)msgs[m].msg_hdr.msg_iovlen; i++) {
+                        bytes += iovs[i].iov_len;
+                        LAT_Record(&lag, now - slot_due[i]);
+                    }
+                    sent += msgs[m].msg_hdr.msg_iovlen;
+                }
+                done += n;
+            }
+            pending = 0;
+        }
+        if (last) break;
+
+        if (rate > 0) LAT_WaitUntil(due);
+
+        // Build the packet for this slot
+        struct stream *st = &streams[stream_rr];
+        stream_rr = (stream_rr + 1 == num_streams) ? 0 : stream_rr + 1;
+
+        uint16 payload_len;
+        if (fixed)              payload_len = sizes[0];
+        else if (num_sizes > 1) payload_len = sizes[rng_next() % (uint64)num_sizes];
+        else                    payload_len = (uint16)(size_lo + rng_next() % (uint64)(size_hi - size_lo + 1));
+
+        uint8 *pkt = slots[pending];
+        uint16 len;
+        CCSDS_CmdTemplate_t tmpl;
+
+        if (fixed) {
+            len = st->tmpl.Length;
+            memcpy(pkt, st->tmpl_buf, len);
+            tmpl.PktPtr = (CCSDS_CommandPacket_t *)pkt;
+            tmpl.Length = len;
+            CCSDS_SetTemplateSeq(&tmpl, st->seq);
+        } else {
+            len = CCSDS_BuildTelecommand(pkt, (uint16)sizeof(slots[0]), st->apid, st->seq, 0x0A, pattern, payload_len);
+            tmpl.PktPtr = (CCSDS_CommandPacket_t *)pkt;
+            tmpl.Length = len;
+        }
+        st->seq = (st->seq + 1) & 0x3FFF;
+
+        if (stamp_mode) {
+            LAT_Stamp_t stamp = { LAT_STAMP_MAGIC, 0, due, LAT_NowNs() };
+            CCSDS_PatchTemplate(&tmpl, (uint16)(payload_len - sizeof(stamp)), (const uint8 *)&stamp, sizeof(stamp));
+        }
+
+        iovs[pending].iov_base = pkt;
+        iovs[pending].iov_len = len;
+        slot_due[pending] = (rate > 0) ? due : LAT_NowNs();
+        pending++;
+        scheduled++;
+
+        // Advance the schedule (absolute, independent of when we actually sent)
+        if (rate <= 0) {
+            due = LAT_NowNs();
+        } else if (profile == PROFILE_CONST) {
+            due = start + (uint64)((double)scheduled * 1e9 / rate);
+        } else if (profile == PROFILE_POISSON) {
+            due += (uint64)(-log(rng_unit()) * 1e9 / rate);
+        } else if (--burst_left == 0) {
+            burst_left = (uint64)burst;
+            due = start + (uint64)((double)scheduled * 1e9 / rate);
+        }
+    }
+
+    double secs = (double)(LAT_NowNs() - start) / 1e9;
+    if (rate > 0) printf("[LOADGEN] Target   %12.0f pkt/s\n", rate);
+    else          printf("[LOADGEN] Target      line rate\n");
+    printf("[LOADGEN] Achieved %12.0f pkt/s, %.1f Mbit/s (%llu packets, %llu bytes, %llu send errors in %.3f s)\n",
+           sent / secs, bytes * 8 / secs / 1e6, (unsigned long long)sent, (unsigned long long)bytes,
+           (unsigned long long)errors, secs);
+    if (rate > 0) {
+        printf("[LOADGEN] Send lag behind schedule:\n");
+        LAT_Report(stdout, "scheduled -> sent", &lag);
+    }
+
+    for (int i = 0; i < num_streams; i++) free(streams[i].tmpl_buf);
+    close(sockfd);
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*
+** File: monitor.c
+** Role: GROUND TOOL (Passive Link Monitor)
+** Description: Taps the CCSDS/UDP uplink on an interface without joining
+**              the data path: no socket is bound to the port, the packets
+**              are seen by an AF_PACKET socket with a TPACKET_V3 ring
+**              mapped into this process. The kernel fills whole blocks of
+**              frames and hands each block over at once; headers are
+**              decoded and checksums verified straight from the ring,
+**              then the block goes back to the kernel. Nothing is copied.
+**
+**              A classic BPF filter keeps only IPv4/UDP datagrams to the
+**              monitored port, so the ring carries no unrelated traffic.
+**              Outgoing copies are ignored, so on the loopback interface
+**              each datagram is seen once.
+**
+**              Needs CAP_NET_RAW. Prints one line per packet (unless -q)
+**              and per-APID totals and ring drops on Ctrl-C.
+**
+** Usage:       monitor [-i iface] [-p port] [-b block_kb] [-n blocks] [-q]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+#include "ccsds.h"
+
+#define MONITOR_PORT     8888
+#define DEFAULT_IFACE    "lo"
+#define BLOCK_KB         1024
+#define NUM_BLOCKS       64
+#define FRAME_SIZE       2048        // Only used to size the request, V3 packs frames tightly
+#define BLOCK_TIMEOUT_MS 10          // Partly filled blocks are retired after this
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+struct apid_stats {
+    uint64 packets;
+    uint64 bytes;
+    uint64 bad_checksum;
+    uint64 seq_gaps;
+    uint16 last_seq;
+};
+
+static struct apid_stats stats[CCSDS_MAX_APID];
+static uint64 truncated = 0, not_ccsds = 0, blocks_seen = 0;
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+// IPv4, UDP, unfragmented, destination port == port (Ethernet framing, as on lo)
+static bool attach_filter(int fd, uint16 port) {
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 12),                      // EtherType
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   ETH_P_IP, 0, 8),
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 23),                      // IP protocol
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   IPPROTO_UDP, 0, 6),
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 20),                      // Fragment offset
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,  0x1FFF, 4, 0),
+        BPF_STMT(BPF_LDX | BPF_B   | BPF_MSH, 14),                      // X = IP header length
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, 16),                      // UDP destination port
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   port, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K,             0xFFFFFFFF),
+        BPF_STMT(BPF_RET | BPF_K,             0),
+    };
+    struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == 0;
+}
+
+// One frame of a block: IP at tp_net, CCSDS packet after the UDP header
+static void decode_frame(const struct tpacket3_hdr *fh, bool quiet) {
+    const uint8 *ip = (const uint8 *)fh + fh->tp_net;
+    uint32 avail = fh->tp_snaplen - (fh->tp_net - fh->tp_mac);
+    uint32 ihl = (uint32)(ip[0] & 0x0F) * 4;
+
+    if (avail < ihl + 8 || (ip[0] >> 4) != 4) { not_ccsds++; return; }
+
+    const uint8 *udp = ip + ihl;
+    uint32 udp_len = ((uint32)udp[4] << 8) | udp[5];
+    if (udp_len < 8) { not_ccsds++; return; }
+
+    uint8 *pkt = (uint8 *)udp + 8;
+    uint32 len = udp_len - 8;
+    bool complete = (avail >= ihl + udp_len);
+    if (!complete) truncated++;
+
+    if (len < sizeof(CCSDS_PriHdr_t) || (!complete && avail < ihl + 8 + sizeof(CCSDS_CommandPacket_t))) {
+        not_ccsds++;
+        return;
+    }
+
+    const CCSDS_PriHdr_t *phdr = (const CCSDS_PriHdr_t *)pkt;
+    if (CCSDS_RD_VERS(*phdr) != 0) { not_ccsds++; return; }
+
+    CCSDS_CmdHdr_t hdr;
+    if (len >= sizeof(CCSDS_CommandPacket_t)) {
+        CCSDS_DecodeCmdHdr(pkt, &hdr);
+    } else {
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.Apid     = (uint16)CCSDS_RD_APID(*phdr);
+        hdr.SeqCount = (uint16)CCSDS_RD_SEQ(*phdr);
+        hdr.Type     = (uint8)CCSDS_RD_TYPE(*phdr);
+        hdr.Length   = (uint32)CCSDS_RD_LEN(*phdr);
+    }
+
+    // Checksum only over a complete command whose length field fits the datagram
+    const char *check = "-";
+    bool bad = false;
+    if (hdr.Type == CCSDS_CMD && hdr.SecHdr && complete && len >= sizeof(CCSDS_CommandPacket_t) && hdr.Length <= len) {
+        bad = !CCSDS_ValidCheckSum((CCSDS_CommandPacket_t *)pkt);
+        check = bad ? "BAD" : "ok";
+    }
+
+    struct apid_stats *s = &stats[hdr.Apid];
+    if (s->packets > 0 && hdr.SeqCount != ((s->last_seq + 1) & 0x3FFF)) s->seq_gaps++;
+    s->last_seq = hdr.SeqCount;
+    s->packets++;
+    s->bytes += len;
+    if (bad) s->bad_checksum++;
+
+    if (!quiet) {
+        printf("[MONITOR] %u.%09u %s:%u APID 0x%03X seq %5u %s len %5u fc 0x%02X checksum %s\n",
+               fh->tp_sec, fh->tp_nsec, inet_ntoa(*(const struct in_addr *)(ip + 12)),
+               ((uint32)udp[0] << 8) | udp[1], hdr.Apid, hdr.SeqCount, hdr.Type == CCSDS_CMD ? "TC" : "TM",
+               len, hdr.FuncCode, check);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *iface = DEFAULT_IFACE;
+    int port = MONITOR_PORT;
+    int block_kb = BLOCK_KB;
+    int num_blocks = NUM_BLOCKS;
+    bool quiet = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:p:b:n:q")) != -1) {
+        switch (opt) {
+            case 'i': iface = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'b': block_kb = atoi(optarg); break;
+            case 'n': num_blocks = atoi(optarg); break;
+            case 'q': quiet = true; break;
+            default:  port = -1; break;
+        }
+    }
+    // Blocks are page multiples and must hold the largest datagram
+    if (port < 1 || port > 65535 || block_kb < 128 || (block_kb & 3) != 0 || num_blocks < 2) {
+        fprintf(stderr, "Usage: %s [-i iface] [-p port] [-b block_kb>=128, multiple of 4] [-n blocks>=2] [-q]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd < 0) {
+        perror("AF_PACKET socket failed (needs CAP_NET_RAW)");
+        exit(EXIT_FAILURE);
+    }
+
+    // Filter before the ring exists, so it never sees other traffic
+    int one = 1;
+    if (!attach_filter(fd, (uint16)port)) {
+        perror("BPF filter failed");
+        exit(EXIT_FAILURE);
+    }
+    if (setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one)) < 0) {
+        perror("[MONITOR] PACKET_IGNORE_OUTGOING not set, loopback packets appear twice");
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        perror("TPACKET_V3 not supported");
+        exit(EXIT_FAILURE);
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = (unsigned)block_kb * 1024;
+    req.tp_block_nr = (unsigned)num_blocks;
+    req.tp_frame_size = FRAME_SIZE;
+    req.tp_frame_nr = req.tp_block_size / req.tp_frame_size * req.tp_block_nr;
+    req.tp_retire_blk_tov = BLOCK_TIMEOUT_MS;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        perror("PACKET_RX_RING failed");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t ring_len = (size_t)req.tp_block_size * req.tp_block_nr;
+    uint8 *ring = mmap(NULL, ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+    if (ring == MAP_FAILED) ring = mmap(NULL, ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        perror("Ring mmap failed");
+        exit(EXIT_FAILURE);
+    }
+
+    struct sockaddr_ll ll;
+    memset(&ll, 0, sizeof(ll));
+    ll.sll_family = AF_PACKET;
+    ll.sll_protocol = htons(ETH_P_ALL);
+    ll.sll_ifindex = (int)if_nametoindex(iface);
+    if (ll.sll_ifindex == 0 || bind(fd, (struct sockaddr *)&ll, sizeof(ll)) < 0) {
+        perror("Interface bind failed");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("[MONITOR] Tapping UDP port %d on %s, %d blocks of %d KiB\n", port, iface, num_blocks, block_kb);
+
+    struct pollfd pfd = { fd, POLLIN | POLLERR, 0 };
+    uint32 cur = 0;
+
+    while (running) {
+        struct tpacket_block_desc *bd = (struct tpacket_block_desc *)(ring + (size_t)cur * req.tp_block_size);
+
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            if (poll(&pfd, 1, 100) < 0 && errno != EINTR) {
+                perror("poll failed");
+                break;
+            }
+            continue;
+        }
+
+        const struct tpacket3_hdr *fh = (const struct tpacket3_hdr *)((uint8 *)bd + bd->hdr.bh1.offset_to_first_pkt);
+        for (uint32 i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+            decode_frame(fh, quiet);
+            fh = (const struct tpacket3_hdr *)((const uint8 *)fh + fh->tp_next_offset);
+        }
+        blocks_seen++;
+
+        // Hand the block back
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        cur = (cur + 1) % req.tp_block_nr;
+    }
+
+    struct tpacket_stats_v3 ks;
+    socklen_t ks_len = sizeof(ks);
+    memset(&ks, 0, sizeof(ks));
+    getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &ks, &ks_len);
+
+    printf("\n[MONITOR] APID   Packets         Bytes  BadChecksum  SeqGaps\n");
+    for (uint32 a = 0; a < CCSDS_MAX_APID; a++) {
+        const struct apid_stats *s = &stats[a];
+        if (s->packets == 0) continue;
+        printf("[MONITOR] 0x%03X %9llu %13llu %12llu %8llu\n", a, (unsigned long long)s->packets,
+               (unsigned long long)s->bytes, (unsigned long long)s->bad_checksum, (unsigned long long)s->seq_gaps);
+    }
+    printf("[MONITOR] %llu blocks, %llu truncated, %llu not CCSDS; kernel: %u packets, %u ring drops, %u queue freezes\n",
+           (unsigned long long)blocks_seen, (unsigned long long)truncated, (unsigned long long)not_ccsds,
+           ks.tp_packets, ks.tp_drops, ks.tp_freeze_q_cnt);
+
+    munmap(ring, ring_len);
+    close(fd);
+    return 0;
+}
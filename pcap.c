@@ -0,0 +1,470 @@
+/*
+**  pcap / pcapng Import and Export for CCSDS over UDP
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pcap.h"
+
+#define PCAP_MAGIC_US        0xA1B2C3D4u
+#define PCAP_MAGIC_NS        0xA1B23C4Du
+#define PCAPNG_SHB           0x0A0D0D0Au
+#define PCAPNG_BOM           0x1A2B3C4Du
+#define PCAPNG_IDB           1u
+#define PCAPNG_SPB           3u
+#define PCAPNG_EPB           6u
+#define PCAPNG_OPT_TSRESOL   9u
+
+#define PCAP_ETH_HDR_SIZE    14
+#define PCAP_IPV4_HDR_SIZE   20
+#define PCAP_IPV6_HDR_SIZE   40
+#define PCAP_UDP_HDR_SIZE    8
+#define PCAP_IPPROTO_UDP     17
+
+/* Network (Big Endian) field reads */
+#define PCAP_BE16(p)         ((uint16)(((p)[0] << 8) | (p)[1]))
+
+/******************************************************************************
+**  Function:  PCAP_Rd16() / PCAP_Rd32()
+**
+**  Reads a capture file field in the byte order of the writing host.
+*/
+static inline uint16 PCAP_Rd16 (const PCAP_Reader_t *Rd, const uint8 *p)
+{
+   uint16 v;
+   memcpy(&v, p, sizeof(v));
+   return Rd->Swapped ? __builtin_bswap16(v) : v;
+}
+
+static inline uint32 PCAP_Rd32 (const PCAP_Reader_t *Rd, const uint8 *p)
+{
+   uint32 v;
+   memcpy(&v, p, sizeof(v));
+   return Rd->Swapped ? __builtin_bswap32(v) : v;
+}
+
+/******************************************************************************
+**  Function:  PCAP_ToNs()
+*/
+static inline uint64 PCAP_ToNs (uint64 Ts, uint64 UnitsPerSec)
+{
+   if (UnitsPerSec == 1000000000ull) return Ts;
+   if (UnitsPerSec == 1000000ull)    return Ts * 1000ull;
+
+   return (Ts / UnitsPerSec) * 1000000000ull + ((Ts % UnitsPerSec) * 1000000000ull) / UnitsPerSec;
+}
+
+/******************************************************************************
+**  Function:  PCAP_FindUdp()
+**
+**  Fixed-offset decode from the link header to the UDP payload. Returns
+**  false for anything that is not an unfragmented UDP datagram.
+*/
+static bool PCAP_FindUdp (const PCAP_Reader_t *Rd, uint16 LinkType, const uint8 *Frame, uint32 CapLen, PCAP_Packet_t *Pkt)
+{
+   const uint8 *Ip;
+   const uint8 *Udp;
+   uint32       Remain;
+   uint32       IpHdrLen;
+   uint32       UdpLen;
+   uint16       EtherType = 0;
+   uint32       Family;
+
+   /* Link layer */
+   switch (LinkType)
+   {
+      case PCAP_LINK_ETHERNET:
+         if (CapLen < PCAP_ETH_HDR_SIZE) return false;
+         EtherType = PCAP_BE16(Frame + 12);
+         Ip        = Frame + PCAP_ETH_HDR_SIZE;
+         if (EtherType == 0x8100 || EtherType == 0x88A8)
+         {
+            if (CapLen < PCAP_ETH_HDR_SIZE + 4) return false;
+            EtherType = PCAP_BE16(Frame + 16);
+            Ip       += 4;
+         }
+         break;
+
+      case PCAP_LINK_SLL:
+         if (CapLen < 16) return false;
+         EtherType = PCAP_BE16(Frame + 14);
+         Ip        = Frame + 16;
+         break;
+
+      case PCAP_LINK_SLL2:
+         if (CapLen < 20) return false;
+         EtherType = PCAP_BE16(Frame);
+         Ip        = Frame + 20;
+         break;
+
+      case PCAP_LINK_NULL:
+         /* Address family in the capturing host's byte order */
+         if (CapLen < 4) return false;
+         memcpy(&Family, Frame, sizeof(Family));
+         if (Family > 0xFFFF) Family = __builtin_bswap32(Family);
+         EtherType = (Family == 2) ? 0x0800 : (Family == 24 || Family == 28 || Family == 30) ? 0x86DD : 0;
+         Ip        = Frame + 4;
+         break;
+
+      case PCAP_LINK_RAW:
+      case PCAP_LINK_IPV4:
+      case PCAP_LINK_IPV6:
+         if (CapLen < 1) return false;
+         EtherType = ((Frame[0] >> 4) == 4) ? 0x0800 : ((Frame[0] >> 4) == 6) ? 0x86DD : 0;
+         Ip        = Frame;
+         break;
+
+      default:
+         return false;
+   }
+
+   Remain = CapLen - (uint32)(Ip - Frame);
+
+   /* Network layer */
+   if (EtherType == 0x0800)
+   {
+      if (Remain < PCAP_IPV4_HDR_SIZE || (Ip[0] >> 4) != 4) return false;
+      IpHdrLen = (uint32)(Ip[0] & 0x0F) * 4;
+      if (IpHdrLen < PCAP_IPV4_HDR_SIZE || Ip[9] != PCAP_IPPROTO_UDP) return false;
+      if ((PCAP_BE16(Ip + 6) & 0x3FFF) != 0) return false;     /* MF flag or fragment offset */
+   }
+   else if (EtherType == 0x86DD)
+   {
+      if (Remain < PCAP_IPV6_HDR_SIZE || Ip[6] != PCAP_IPPROTO_UDP) return false;
+      IpHdrLen = PCAP_IPV6_HDR_SIZE;
+   }
+   else
+   {
+      return false;
+   }
+
+   /* Transport layer */
+   if (Remain < IpHdrLen + PCAP_UDP_HDR_SIZE) return false;
+   Udp    = Ip + IpHdrLen;
+   UdpLen = PCAP_BE16(Udp + 4);
+   if (UdpLen < PCAP_UDP_HDR_SIZE) return false;
+
+   Pkt->SrcPort = PCAP_BE16(Udp);
+   Pkt->DstPort = PCAP_BE16(Udp + 2);
+   if (Rd->PortFilter != 0 && Pkt->DstPort != Rd->PortFilter) return false;
+
+   Pkt->Data = Udp + PCAP_UDP_HDR_SIZE;
+   Pkt->Len  = UdpLen - PCAP_UDP_HDR_SIZE;
+   if (Pkt->Len > Remain - IpHdrLen - PCAP_UDP_HDR_SIZE) Pkt->Len = Remain - IpHdrLen - PCAP_UDP_HDR_SIZE;
+   Pkt->Pkt  = (Pkt->Len >= sizeof(CCSDS_CommandPacket_t)) ? (const CCSDS_CommandPacket_t *)Pkt->Data : NULL;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  PCAP_ReadIdb()
+**
+**  Registers a pcapng interface: link type and timestamp resolution.
+*/
+static void PCAP_ReadIdb (PCAP_Reader_t *Rd, const uint8 *Body, uint32 BodyLen)
+{
+   uint32 Iface = Rd->NumIfaces;
+   uint32 Off   = 8;
+   uint16 Code, Len;
+
+   if (Iface >= PCAP_MAX_IFACES || BodyLen < 8) return;
+
+   Rd->LinkType[Iface]      = PCAP_Rd16(Rd, Body);
+   Rd->TsUnitsPerSec[Iface] = 1000000ull;
+
+   while (Off + 4 <= BodyLen)
+   {
+      Code = PCAP_Rd16(Rd, Body + Off);
+      Len  = PCAP_Rd16(Rd, Body + Off + 2);
+      if (Code == 0 || Off + 4 + Len > BodyLen) break;
+
+      if (Code == PCAPNG_OPT_TSRESOL && Len >= 1)
+      {
+         uint8  Res   = Body[Off + 4];
+         uint64 Units = 1;
+         uint8  i;
+
+         for (i = 0; i < (Res & 0x7F) && Units < (1ull << 60); ++i) Units *= (Res & 0x80) ? 2 : 10;
+         Rd->TsUnitsPerSec[Iface] = Units;
+      }
+      Off += 4 + ((Len + 3u) & ~3u);
+   }
+
+   Rd->NumIfaces++;
+}
+
+/******************************************************************************
+**  Function:  PCAP_OpenReader()
+*/
+bool PCAP_OpenReader (PCAP_Reader_t *Rd, const char *Path, uint16 PortFilter)
+{
+   struct stat St;
+   uint32      Magic;
+   int         Fd;
+
+   memset(Rd, 0, sizeof(*Rd));
+   Rd->PortFilter = PortFilter;
+
+   Fd = open(Path, O_RDONLY);
+   if (Fd < 0) return false;
+   if (fstat(Fd, &St) != 0 || St.st_size < 24) { close(Fd); return false; }
+
+   Rd->MapLen = (uint64)St.st_size;
+   Rd->Map    = mmap(NULL, Rd->MapLen, PROT_READ, MAP_PRIVATE, Fd, 0);
+   close(Fd);
+   if (Rd->Map == MAP_FAILED) { Rd->Map = NULL; return false; }
+
+   madvise((void *)Rd->Map, Rd->MapLen, MADV_SEQUENTIAL);
+
+   memcpy(&Magic, Rd->Map, sizeof(Magic));
+
+   if (Magic == PCAPNG_SHB)
+   {
+      /* Blocks are parsed as they come, starting with this SHB */
+      Rd->IsNg = true;
+      return true;
+   }
+
+   if (Magic == PCAP_MAGIC_US || Magic == PCAP_MAGIC_NS)
+   {
+      Rd->Swapped = false;
+   }
+   else if (Magic == __builtin_bswap32(PCAP_MAGIC_US) || Magic == __builtin_bswap32(PCAP_MAGIC_NS))
+   {
+      Rd->Swapped = true;
+   }
+   else
+   {
+      PCAP_CloseReader(Rd);
+      return false;
+   }
+
+   Rd->NumIfaces        = 1;
+   Rd->LinkType[0]      = (uint16)PCAP_Rd32(Rd, Rd->Map + 20);
+   Rd->TsUnitsPerSec[0] = (PCAP_Rd32(Rd, Rd->Map) == PCAP_MAGIC_NS) ? 1000000000ull : 1000000ull;
+   Rd->Offset           = 24;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  PCAP_NextPacket()
+**
+**  Advances to the next UDP datagram (matching the port filter). Returns
+**  false at the end of the capture or on a truncated record.
+*/
+bool PCAP_NextPacket (PCAP_Reader_t *Rd, PCAP_Packet_t *Pkt)
+{
+   const uint8 *Rec;
+   uint32       CapLen;
+   uint32       BlockType, BlockLen;
+   uint32       Iface;
+   uint64       Ts;
+
+   if (Rd->Map == NULL) return false;
+
+   while (Rd->Offset < Rd->MapLen)
+   {
+      Rec = Rd->Map + Rd->Offset;
+
+      if (!Rd->IsNg)
+      {
+         /* Classic pcap: 16 byte record header, then the frame */
+         if (Rd->MapLen - Rd->Offset < 16) return false;
+         CapLen = PCAP_Rd32(Rd, Rec + 8);
+         if (Rd->MapLen - Rd->Offset - 16 < CapLen) return false;
+
+         Rd->Offset += 16 + (uint64)CapLen;
+         Rd->Frames++;
+
+         if (PCAP_FindUdp(Rd, Rd->LinkType[0], Rec + 16, CapLen, Pkt))
+         {
+            Pkt->TimeNs = PCAP_ToNs((uint64)PCAP_Rd32(Rd, Rec) * Rd->TsUnitsPerSec[0] + PCAP_Rd32(Rd, Rec + 4),
+                                    Rd->TsUnitsPerSec[0]);
+            return true;
+         }
+         Rd->Skipped++;
+         continue;
+      }
+
+      /* pcapng: generic block header, type + total length */
+      if (Rd->MapLen - Rd->Offset < 12) return false;
+
+      memcpy(&BlockType, Rec, sizeof(BlockType));
+      if (BlockType == PCAPNG_SHB)
+      {
+         uint32 Bom;
+         memcpy(&Bom, Rec + 8, sizeof(Bom));
+         if      (Bom == PCAPNG_BOM)                   Rd->Swapped = false;
+         else if (Bom == __builtin_bswap32(PCAPNG_BOM)) Rd->Swapped = true;
+         else                                          return false;
+         Rd->NumIfaces = 0;                            /* Interfaces are per section */
+      }
+      else
+      {
+         BlockType = PCAP_Rd32(Rd, Rec);
+      }
+
+      BlockLen = PCAP_Rd32(Rd, Rec + 4);
+      if (BlockLen < 12 || (BlockLen & 3) != 0 || Rd->MapLen - Rd->Offset < BlockLen) return false;
+      Rd->Offset += BlockLen;
+
+      switch (BlockType)
+      {
+         case PCAPNG_IDB:
+            PCAP_ReadIdb(Rd, Rec + 8, BlockLen - 12);
+            break;
+
+         case PCAPNG_EPB:
+            if (BlockLen < 32) break;
+            Iface  = PCAP_Rd32(Rd, Rec + 8);
+            CapLen = PCAP_Rd32(Rd, Rec + 20);
+            Rd->Frames++;
+            if (Iface < Rd->NumIfaces && CapLen <= BlockLen - 32 &&
+                PCAP_FindUdp(Rd, Rd->LinkType[Iface], Rec + 28, CapLen, Pkt))
+            {
+               Ts = ((uint64)PCAP_Rd32(Rd, Rec + 12) << 32) | PCAP_Rd32(Rd, Rec + 16);
+               Pkt->TimeNs = PCAP_ToNs(Ts, Rd->TsUnitsPerSec[Iface]);
+               return true;
+            }
+            Rd->Skipped++;
+            break;
+
+         case PCAPNG_SPB:
+            /* No timestamp, captured length is bounded by the block */
+            if (BlockLen < 16 || Rd->NumIfaces == 0) break;
+            CapLen = PCAP_Rd32(Rd, Rec + 8);
+            if (CapLen > BlockLen - 16) CapLen = BlockLen - 16;
+            Rd->Frames++;
+            if (PCAP_FindUdp(Rd, Rd->LinkType[0], Rec + 12, CapLen, Pkt))
+            {
+               Pkt->TimeNs = 0;
+               return true;
+            }
+            Rd->Skipped++;
+            break;
+
+         default:
+            break;
+      }
+   }
+
+   return false;
+}
+
+/******************************************************************************
+**  Function:  PCAP_CloseReader()
+*/
+void PCAP_CloseReader (PCAP_Reader_t *Rd)
+{
+   if (Rd->Map != NULL) munmap((void *)Rd->Map, Rd->MapLen);
+   Rd->Map = NULL;
+}
+
+/******************************************************************************
+**  Function:  PCAP_OpenWriter()
+*/
+bool PCAP_OpenWriter (PCAP_Writer_t *Wr, const char *Path)
+{
+   uint32 Hdr32[6];
+
+   Wr->IpId = 0;
+   Wr->Fp   = fopen(Path, "wb");
+   if (Wr->Fp == NULL) return false;
+
+   setvbuf(Wr->Fp, NULL, _IOFBF, 1 << 20);
+
+   /* Classic pcap, host byte order, nanosecond timestamps */
+   Hdr32[0] = PCAP_MAGIC_NS;
+   Hdr32[1] = 2 | (4u << 16);          /* Version 2.4 as two host order uint16 */
+   Hdr32[2] = 0;                       /* thiszone */
+   Hdr32[3] = 0;                       /* sigfigs */
+   Hdr32[4] = 65535;                   /* snaplen */
+   Hdr32[5] = PCAP_LINK_ETHERNET;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+   Hdr32[1] = (2u << 16) | 4;
+#endif
+
+   return fwrite(Hdr32, sizeof(Hdr32), 1, Wr->Fp) == 1;
+}
+
+/******************************************************************************
+**  Function:  PCAP_WriteUdp()
+**
+**  Writes one datagram framed as Ethernet/IPv4/UDP (UDP checksum 0).
+*/
+bool PCAP_WriteUdp (PCAP_Writer_t            *Wr,
+                    uint64                    TimeNs,
+                    const struct sockaddr_in *Src,
+                    const struct sockaddr_in *Dst,
+                    const uint8              *Data,
+                    uint16                    Len)
+{
+   uint8  Hdr[PCAP_ETH_HDR_SIZE + PCAP_IPV4_HDR_SIZE + PCAP_UDP_HDR_SIZE];
+   uint8 *Ip  = Hdr + PCAP_ETH_HDR_SIZE;
+   uint8 *Udp = Ip + PCAP_IPV4_HDR_SIZE;
+   uint32 Rec[4];
+   uint32 Sum = 0;
+   uint32 IpLen;
+   int    i;
+
+   if (Wr->Fp == NULL || Len > 65535 - PCAP_IPV4_HDR_SIZE - PCAP_UDP_HDR_SIZE) return false;
+
+   IpLen = PCAP_IPV4_HDR_SIZE + PCAP_UDP_HDR_SIZE + (uint32)Len;
+
+   /* Ethernet: zero MACs, IPv4 */
+   memset(Hdr, 0, PCAP_ETH_HDR_SIZE);
+   Hdr[12] = 0x08;
+
+   /* IPv4 (addresses and ports are already in network order) */
+   Ip[0]  = 0x45;
+   Ip[1]  = 0;
+   Ip[2]  = (uint8)(IpLen >> 8);
+   Ip[3]  = (uint8)(IpLen & 0xff);
+   Ip[4]  = (uint8)(Wr->IpId >> 8);
+   Ip[5]  = (uint8)(Wr->IpId & 0xff);
+   Ip[6]  = 0x40;                       /* Don't fragment */
+   Ip[7]  = 0;
+   Ip[8]  = 64;
+   Ip[9]  = PCAP_IPPROTO_UDP;
+   Ip[10] = 0;
+   Ip[11] = 0;
+   memcpy(Ip + 12, &Src->sin_addr.s_addr, 4);
+   memcpy(Ip + 16, &Dst->sin_addr.s_addr, 4);
+   for (i = 0; i < PCAP_IPV4_HDR_SIZE; i += 2) Sum += PCAP_BE16(Ip + i);
+   while (Sum >> 16) Sum = (Sum & 0xFFFF) + (Sum >> 16);
+   Ip[10] = (uint8)(~Sum >> 8);
+   Ip[11] = (uint8)(~Sum & 0xff);
+   Wr->IpId++;
+
+   /* UDP */
+   memcpy(Udp,     &Src->sin_port, 2);
+   memcpy(Udp + 2, &Dst->sin_port, 2);
+   Udp[4] = (uint8)((Len + PCAP_UDP_HDR_SIZE) >> 8);
+   Udp[5] = (uint8)((Len + PCAP_UDP_HDR_SIZE) & 0xff);
+   Udp[6] = 0;
+   Udp[7] = 0;
+
+   Rec[0] = (uint32)(TimeNs / 1000000000ull);
+   Rec[1] = (uint32)(TimeNs % 1000000000ull);
+   Rec[2] = (uint32)(sizeof(Hdr) + Len);
+   Rec[3] = Rec[2];
+
+   return fwrite(Rec, sizeof(Rec), 1, Wr->Fp) == 1 &&
+          fwrite(Hdr, sizeof(Hdr), 1, Wr->Fp) == 1 &&
+          (Len == 0 || fwrite(Data, Len, 1, Wr->Fp) == 1);
+}
+
+/******************************************************************************
+**  Function:  PCAP_CloseWriter()
+*/
+void PCAP_CloseWriter (PCAP_Writer_t *Wr)
+{
+   if (Wr->Fp != NULL) fclose(Wr->Fp);
+   Wr->Fp = NULL;
+}
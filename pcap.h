@@ -0,0 +1,100 @@
+/*
+**  pcap / pcapng Import and Export for CCSDS over UDP
+**
+**  The reader maps the whole capture and walks it in place. Link, IP and
+**  UDP headers are skipped with fixed-offset fast paths (Ethernet with or
+**  without one VLAN tag, Linux cooked capture, BSD loopback, raw IP;
+**  IPv4 without options, IPv6 without extension headers). Each UDP
+**  payload is handed out as a view into the mapping.
+**
+**  The writer produces classic pcap (nanosecond timestamps, Ethernet link
+**  type) with synthesized IPv4/UDP headers so standard tools decode it.
+*/
+
+#ifndef _pcap_
+#define _pcap_
+
+/*
+** Includes
+*/
+#include <stdio.h>
+#include <netinet/in.h>
+
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define PCAP_MAX_IFACES   16
+
+/*
+** Link types (tcpdump.org/linktypes.html)
+*/
+#define PCAP_LINK_NULL      0
+#define PCAP_LINK_ETHERNET  1
+#define PCAP_LINK_RAW       101
+#define PCAP_LINK_SLL       113
+#define PCAP_LINK_IPV4      228
+#define PCAP_LINK_IPV6      229
+#define PCAP_LINK_SLL2      276
+
+/*----- One UDP datagram found in the capture -----*/
+typedef struct {
+
+   const uint8                 *Data;      /* UDP payload, points into the mapping */
+   uint32                       Len;
+   const CCSDS_CommandPacket_t *Pkt;       /* Same bytes, NULL when Len is too short */
+   uint64                       TimeNs;    /* Capture time, ns since the epoch */
+   uint16                       SrcPort;
+   uint16                       DstPort;
+
+} PCAP_Packet_t;
+
+/*----- Reader state -----*/
+typedef struct {
+
+   const uint8  *Map;
+   uint64        MapLen;
+   uint64        Offset;
+
+   bool          IsNg;
+   bool          Swapped;                   /* File written on opposite endian host */
+
+   /* Classic pcap has one link type; pcapng has one per interface */
+   uint32        NumIfaces;
+   uint16        LinkType[PCAP_MAX_IFACES];
+   uint64        TsUnitsPerSec[PCAP_MAX_IFACES];
+
+   uint16        PortFilter;                /* 0 = any UDP destination port */
+
+   uint64        Frames;
+   uint64        Skipped;                   /* Frames that were not UDP or not parsable */
+
+} PCAP_Reader_t;
+
+/*----- Writer state -----*/
+typedef struct {
+
+   FILE    *Fp;
+   uint16   IpId;
+
+} PCAP_Writer_t;
+
+
+/*
+** Exported Functions
+*/
+bool PCAP_OpenReader  (PCAP_Reader_t *Rd, const char *Path, uint16 PortFilter);
+bool PCAP_NextPacket  (PCAP_Reader_t *Rd, PCAP_Packet_t *Pkt);
+void PCAP_CloseReader (PCAP_Reader_t *Rd);
+
+bool PCAP_OpenWriter  (PCAP_Writer_t *Wr, const char *Path);
+bool PCAP_WriteUdp    (PCAP_Writer_t *Wr,
+                       uint64                    TimeNs,
+                       const struct sockaddr_in *Src,
+                       const struct sockaddr_in *Dst,
+                       const uint8              *Data,
+                       uint16                    Len);
+void PCAP_CloseWriter (PCAP_Writer_t *Wr);
+
+#endif  /* _pcap_ */
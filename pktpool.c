@@ -0,0 +1,271 @@
+/*
+**  Packet Buffer Pool - Size classes, lock-free free lists, thread caches
+*/
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "pktpool.h"
+
+#define PKT_HUGE_SIZE   (2u * 1024u * 1024u)
+
+static const uint32 PKT_ClassSizes[PKT_NUM_CLASSES] = PKT_CLASS_SIZES;
+
+/******************************************************************************
+**  Function:  PKT_BufAt()
+*/
+static inline PKT_Buf_t *PKT_BufAt (PKT_Class_t *Cls, uint32 Index)
+{
+   return (PKT_Buf_t *)(Cls->Base + (size_t)Index * Cls->Stride);
+}
+
+/******************************************************************************
+**  Function:  PKT_PushChain()
+**
+**  Pushes First..Last (already linked through NextFree) in one CAS.
+*/
+static void PKT_PushChain (PKT_Class_t *Cls, uint32 First, uint32 Last)
+{
+   uint64 Old = __atomic_load_n(&Cls->FreeHead, __ATOMIC_RELAXED);
+   uint64 New;
+
+   do
+   {
+      __atomic_store_n(&PKT_BufAt(Cls, Last)->NextFree, (uint32)Old, __ATOMIC_RELAXED);
+      New = (((Old >> 32) + 1) << 32) | (uint64)(First + 1);
+   } while (!__atomic_compare_exchange_n(&Cls->FreeHead, &Old, New, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/******************************************************************************
+**  Function:  PKT_Pop()
+**
+**  Index of a free buffer, or ~0 when the class is empty. The link may be
+**  read from a buffer another thread just took; the tag makes that CAS
+**  fail.
+*/
+static uint32 PKT_Pop (PKT_Class_t *Cls)
+{
+   uint64 Old = __atomic_load_n(&Cls->FreeHead, __ATOMIC_ACQUIRE);
+   uint64 New;
+   uint32 Top;
+
+   do
+   {
+      Top = (uint32)Old;
+      if (Top == 0) return ~0u;
+      New = (((Old >> 32) + 1) << 32) |
+            (uint64)__atomic_load_n(&PKT_BufAt(Cls, Top - 1)->NextFree, __ATOMIC_RELAXED);
+   } while (!__atomic_compare_exchange_n(&Cls->FreeHead, &Old, New, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+   return Top - 1;
+}
+
+/******************************************************************************
+**  Function:  PKT_Init()
+**
+**  Counts[c] buffers of class c. With PKT_FLAG_HUGEPAGES the pool is put
+**  on explicit huge pages if the system has them reserved, otherwise
+**  transparent huge pages are requested.
+*/
+bool PKT_Init (PKT_Pool_t *Pool, const uint32 Counts[PKT_NUM_CLASSES], uint32 Flags)
+{
+   size_t  Offset[PKT_NUM_CLASSES];
+   size_t  Len = 0;
+   uint32  c, i;
+
+   memset(Pool, 0, sizeof(*Pool));
+
+   for (c = 0; c < PKT_NUM_CLASSES; ++c)
+   {
+      Pool->Classes[c].Size   = PKT_ClassSizes[c];
+      Pool->Classes[c].Stride = (uint32)sizeof(PKT_Buf_t) + PKT_ClassSizes[c];
+      Pool->Classes[c].Count  = Counts[c];
+      Offset[c] = Len;
+      Len += (size_t)Counts[c] * Pool->Classes[c].Stride;
+   }
+   if (Len == 0) return false;
+
+   if (Flags & PKT_FLAG_HUGEPAGES)
+   {
+      Pool->MapLen = (Len + PKT_HUGE_SIZE - 1) & ~(size_t)(PKT_HUGE_SIZE - 1);
+      Pool->Map = mmap(NULL, Pool->MapLen, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+      Pool->HugePages = (Pool->Map != MAP_FAILED);
+   }
+   if (!Pool->HugePages)
+   {
+      Pool->MapLen = Len;
+      Pool->Map = mmap(NULL, Len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (Pool->Map == MAP_FAILED) { Pool->Map = NULL; return false; }
+      if (Flags & PKT_FLAG_HUGEPAGES) madvise(Pool->Map, Len, MADV_HUGEPAGE);
+   }
+
+   for (c = 0; c < PKT_NUM_CLASSES; ++c)
+   {
+      PKT_Class_t *Cls = &Pool->Classes[c];
+
+      Cls->Base = (uint8 *)Pool->Map + Offset[c];
+      for (i = 0; i < Cls->Count; ++i)
+      {
+         PKT_Buf_t *Buf = PKT_BufAt(Cls, i);
+         Buf->Capacity = Cls->Size;
+         Buf->Index    = i;
+         Buf->Class    = (uint8)c;
+         Buf->Pool     = Pool;
+         Buf->NextFree = (i + 1 < Cls->Count) ? i + 2 : 0;
+      }
+      Cls->FreeHead = Cls->Count > 0 ? 1 : 0;
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  PKT_Destroy()
+**
+**  Every cache must have been flushed and every buffer released.
+*/
+void PKT_Destroy (PKT_Pool_t *Pool)
+{
+   if (Pool->Map != NULL) munmap(Pool->Map, Pool->MapLen);
+   memset(Pool, 0, sizeof(*Pool));
+}
+
+/******************************************************************************
+**  Function:  PKT_InitCache()
+*/
+void PKT_InitCache (PKT_Pool_t *Pool, PKT_Cache_t *Cache)
+{
+   memset(Cache, 0, sizeof(*Cache));
+   Cache->Pool = Pool;
+}
+
+/******************************************************************************
+**  Function:  PKT_Spill()
+**
+**  Returns the oldest Count cached buffers of Class to the global list.
+*/
+static void PKT_Spill (PKT_Cache_t *Cache, uint32 Class, uint32 Count)
+{
+   PKT_Class_t *Cls = &Cache->Pool->Classes[Class];
+   uint32      *Idx = Cache->Idx[Class];
+   uint32       i;
+
+   if (Count == 0) return;
+
+   for (i = 0; i + 1 < Count; ++i) PKT_BufAt(Cls, Idx[i])->NextFree = Idx[i + 1] + 1;
+   PKT_PushChain(Cls, Idx[0], Idx[Count - 1]);
+
+   Cache->Count[Class] -= Count;
+   memmove(Idx, Idx + Count, Cache->Count[Class] * sizeof(uint32));
+}
+
+/******************************************************************************
+**  Function:  PKT_FlushCache()
+*/
+void PKT_FlushCache (PKT_Cache_t *Cache)
+{
+   uint32 c;
+
+   for (c = 0; c < PKT_NUM_CLASSES; ++c) PKT_Spill(Cache, c, Cache->Count[c]);
+}
+
+/******************************************************************************
+**  Function:  PKT_Alloc()
+*/
+PKT_Buf_t *PKT_Alloc (PKT_Pool_t *Pool, PKT_Cache_t *Cache, uint32 Size)
+{
+   PKT_Class_t *Cls;
+   PKT_Buf_t   *Buf;
+   uint32       c, Index;
+
+   for (c = 0; c < PKT_NUM_CLASSES && PKT_ClassSizes[c] < Size; ++c) { }
+   if (c == PKT_NUM_CLASSES) return NULL;
+   Cls = &Pool->Classes[c];
+
+   if (Cache != NULL)
+   {
+      /* Refill a batch so the next PKT_CACHE_BATCH allocations stay local */
+      if (Cache->Count[c] == 0)
+      {
+         while (Cache->Count[c] < PKT_CACHE_BATCH && (Index = PKT_Pop(Cls)) != ~0u)
+         {
+            Cache->Idx[c][Cache->Count[c]++] = Index;
+         }
+      }
+      Index = (Cache->Count[c] > 0) ? Cache->Idx[c][--Cache->Count[c]] : ~0u;
+   }
+   else
+   {
+      Index = PKT_Pop(Cls);
+   }
+
+   if (Index == ~0u)
+   {
+      __atomic_fetch_add(&Cls->Failures, 1, __ATOMIC_RELAXED);
+      return NULL;
+   }
+
+   Buf = PKT_BufAt(Cls, Index);
+   Buf->RefCount = 1;
+   Buf->Length   = 0;
+
+   return Buf;
+}
+
+/******************************************************************************
+**  Function:  PKT_Ref()
+*/
+void PKT_Ref (PKT_Buf_t *Buf)
+{
+   __atomic_fetch_add(&Buf->RefCount, 1, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+**  Function:  PKT_Release()
+**
+**  Cache, if given, must belong to the calling thread and to Buf's pool.
+*/
+void PKT_Release (PKT_Cache_t *Cache, PKT_Buf_t *Buf)
+{
+   PKT_Class_t *Cls;
+   uint32       c = Buf->Class;
+
+   /* Sole owner: no other thread can change the count, skip the atomic */
+   if (__atomic_load_n(&Buf->RefCount, __ATOMIC_ACQUIRE) != 1 &&
+       __atomic_sub_fetch(&Buf->RefCount, 1, __ATOMIC_ACQ_REL) != 0)
+   {
+      return;
+   }
+
+   Cls = &Buf->Pool->Classes[c];
+   if (Cache == NULL)
+   {
+      PKT_PushChain(Cls, Buf->Index, Buf->Index);
+      return;
+   }
+
+   if (Cache->Count[c] == PKT_CACHE_SIZE) PKT_Spill(Cache, c, PKT_CACHE_BATCH);
+   Cache->Idx[c][Cache->Count[c]++] = Buf->Index;
+}
+
+/******************************************************************************
+**  Function:  PKT_FreeCount()
+**
+**  Buffers on the global list of Class (a walk, for diagnostics only;
+**  exact only while no other thread uses the pool).
+*/
+uint32 PKT_FreeCount (PKT_Pool_t *Pool, uint32 Class)
+{
+   PKT_Class_t *Cls = &Pool->Classes[Class];
+   uint32       Next = (uint32)__atomic_load_n(&Cls->FreeHead, __ATOMIC_ACQUIRE);
+   uint32       Count = 0;
+
+   while (Next != 0 && Count <= Cls->Count)
+   {
+      Next = PKT_BufAt(Cls, Next - 1)->NextFree;
+      Count++;
+   }
+
+   return Count;
+}
@@ -0,0 +1,109 @@
+/*
+**  Packet Buffer Pool - Size classes, lock-free free lists, thread caches
+**
+**  All packet memory is carved out of one mapping at start-up (huge pages
+**  when asked for and available), so nothing is allocated while packets
+**  flow. Every buffer starts with a cache-line header and its data starts
+**  on the next cache line. Buffers come in PKT_NUM_CLASSES sizes; an
+**  allocation takes the smallest class that fits.
+**
+**  Each class has a global free list, a Treiber stack of buffer indices
+**  whose head carries an ABA tag, so a push or pop is a single 64-bit CAS.
+**  Threads normally go through a PKT_Cache_t of their own. Alloc and free
+**  then touch only the cache's arrays, and the global stack is only hit
+**  once per PKT_CACHE_BATCH buffers.
+**
+**  Buffers are reference counted. A packet handed to several consumers
+**  gets one PKT_Ref per extra consumer, and each consumer calls
+**  PKT_Release; the last release returns the buffer. A buffer may be
+**  released from a different thread (and cache) than the one that
+**  allocated it.
+*/
+
+#ifndef _pktpool_
+#define _pktpool_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define PKT_NUM_CLASSES   4
+#define PKT_CLASS_SIZES   { 256, 2048, 16384, 65536 }   /* Data bytes per buffer */
+#define PKT_CACHE_SIZE    64                            /* Per class, per thread cache */
+#define PKT_CACHE_BATCH   (PKT_CACHE_SIZE / 2)          /* Moved to/from the global list at once */
+
+#define PKT_FLAG_HUGEPAGES  0x1
+
+/*----- Buffer header, one cache line; data follows -----*/
+typedef struct {
+
+   uint32            RefCount;
+   uint32            Length;        /* Bytes in use, set by the owner */
+   uint32            Capacity;      /* Class size */
+   uint32            Index;         /* Within its class */
+   uint32            NextFree;      /* Free list link (index + 1, 0 = end) */
+   uint8             Class;
+   uint8             Spare[3];
+   struct PKT_Pool  *Pool;
+   uint64            User[4];       /* For the owner: timestamps, queue links */
+
+} __attribute__((aligned(64))) PKT_Buf_t;
+
+/*----- Size class -----*/
+typedef struct {
+
+   uint64   FreeHead  __attribute__((aligned(64)));   /* Tag << 32 | (index + 1) */
+   uint64   Failures;                                 /* Allocations that found it empty */
+   uint8   *Base     __attribute__((aligned(64)));
+   uint32   Stride;
+   uint32   Count;
+   uint32   Size;
+
+} PKT_Class_t;
+
+/*----- Pool -----*/
+typedef struct PKT_Pool {
+
+   PKT_Class_t  Classes[PKT_NUM_CLASSES];
+   void        *Map;
+   size_t       MapLen;
+   bool         HugePages;          /* Backed by MAP_HUGETLB */
+
+} PKT_Pool_t;
+
+/*----- Per-thread cache -----*/
+typedef struct {
+
+   PKT_Pool_t  *Pool;
+   uint32       Count[PKT_NUM_CLASSES];
+   uint32       Idx[PKT_NUM_CLASSES][PKT_CACHE_SIZE];
+
+} PKT_Cache_t;
+
+
+/*
+** Exported Functions
+*/
+bool       PKT_Init       (PKT_Pool_t *Pool, const uint32 Counts[PKT_NUM_CLASSES], uint32 Flags);
+void       PKT_Destroy    (PKT_Pool_t *Pool);
+
+void       PKT_InitCache  (PKT_Pool_t *Pool, PKT_Cache_t *Cache);
+void       PKT_FlushCache (PKT_Cache_t *Cache);
+
+/* Cache may be NULL (global list only). NULL when the class is exhausted. */
+PKT_Buf_t *PKT_Alloc      (PKT_Pool_t *Pool, PKT_Cache_t *Cache, uint32 Size);
+void       PKT_Ref        (PKT_Buf_t *Buf);
+void       PKT_Release    (PKT_Cache_t *Cache, PKT_Buf_t *Buf);
+
+uint32     PKT_FreeCount  (PKT_Pool_t *Pool, uint32 Class);
+
+static inline uint8 *PKT_Data (PKT_Buf_t *Buf)
+{
+   return (uint8 *)(Buf + 1);
+}
+
+#endif  /* _pktpool_ */
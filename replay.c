@@ -0,0 +1,160 @@
+/*
+** File: replay.c
+** Role: SENDER (Archive Replay)
+** Description: Streams packets recorded by the flight software (-r) back to
+**              its port. Packets go from the mapped archive straight into
+**              sendmmsg iovecs, with no copy.
+**
+** Usage:       replay -a <archive_dir> [-t ip] [-p port] [-x factor] [-b batch]
+**              -x 1.0  original inter-arrival times (default)
+**              -x 4.0  four times faster
+**              -x 0    as fast as possible
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "ccsds.h"
+#include "archive.h"
+#include "latency.h"
+
+#define TARGET_IP    "127.0.0.1"
+#define TARGET_PORT  8888
+#define MAX_BATCH    256
+
+static int flush_batch(int sockfd, struct mmsghdr *msgs, int count, uint64 *sent, uint64 *bytes) {
+    int done = 0;
+
+    while (done < count) {
+        int n = sendmmsg(sockfd, msgs + done, (unsigned)(count - done), 0);
+        if (n < 0) {
+            perror("sendmmsg failed");
+            return -1;
+        }
+        for (int i = done; i < done + n; i++) *bytes += msgs[i].msg_hdr.msg_iov->iov_len;
+        done += n;
+    }
+
+    *sent += (uint64)count;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *archive_dir = NULL;
+    const char *target_ip = TARGET_IP;
+    int target_port = TARGET_PORT;
+    double factor = 1.0;
+    int batch = 32;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "a:t:p:x:b:")) != -1) {
+        switch (opt) {
+            case 'a': archive_dir = optarg; break;
+            case 't': target_ip = optarg; break;
+            case 'p': target_port = atoi(optarg); break;
+            case 'x': factor = atof(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            default:  archive_dir = NULL; optind = argc; break;
+        }
+    }
+    if (archive_dir == NULL || factor < 0 || batch < 1 || batch > MAX_BATCH) {
+        fprintf(stderr, "Usage: %s -a archive_dir [-t ip] [-p port] [-x factor] [-b batch<=%d]\n", argv[0], MAX_BATCH);
+        exit(EXIT_FAILURE);
+    }
+
+    int sockfd;
+    struct sockaddr_in servaddr;
+
+    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        perror("Socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_port = htons(target_port);
+    servaddr.sin_addr.s_addr = inet_addr(target_ip);
+
+    // Connected socket: sendmmsg needs no per-message address
+    if (connect(sockfd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
+        perror("Connect failed");
+        exit(EXIT_FAILURE);
+    }
+
+    static ARC_Reader_t reader;
+    if (!ARC_OpenReader(&reader, archive_dir)) {
+        fprintf(stderr, "[REPLAY] No archive segments in %s\n", archive_dir);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("[REPLAY] %u segments from %s -> %s:%d, factor %.2f%s\n", reader.NumSegs, archive_dir,
+           target_ip, target_port, factor, factor == 0 ? " (as fast as possible)" : "");
+
+    static struct mmsghdr msgs[MAX_BATCH];
+    static struct iovec iovs[MAX_BATCH];
+    ARC_Record_t rec;
+    int pending = 0;
+    uint64 first_rx = 0, last_rx = 0, start = 0, sent = 0, bytes = 0;
+    uint64 pending_due = 0, prev_due = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+
+    while (ARC_NextRecord(&reader, &rec)) {
+        uint64 due = 0;
+
+        if (start == 0) {
+            first_rx = rec.RxTimeNs;
+            start = LAT_NowNs();
+        }
+        last_rx = rec.RxTimeNs;
+        if (factor > 0) {
+            // RxTimeNs is CLOCK_REALTIME and may step back: a signed offset,
+            // and never earlier than the previous record so time only moves on
+            int64 offset = (int64)(rec.RxTimeNs - first_rx);
+            due = start + (offset > 0 ? (uint64)((double)offset / factor) : 0);
+            if (due < prev_due) due = prev_due;
+            prev_due = due;
+        }
+
+        // A packet due later than the batch head is sent with the next batch
+        if (pending > 0 && due > pending_due + 1000) {
+            LAT_WaitUntil(pending_due);
+            if (flush_batch(sockfd, msgs, pending, &sent, &bytes) < 0) break;
+            pending = 0;
+        }
+
+        if (pending == 0) pending_due = due;
+
+        iovs[pending].iov_base = (void *)rec.Data;
+        iovs[pending].iov_len  = rec.Length;
+        msgs[pending].msg_hdr.msg_iov    = &iovs[pending];
+        msgs[pending].msg_hdr.msg_iovlen = 1;
+        pending++;
+
+        // Iovecs point into the segment mapping: flush before it is unmapped
+        if (pending == batch || ARC_SegmentDone(&reader)) {
+            LAT_WaitUntil(pending_due);
+            if (flush_batch(sockfd, msgs, pending, &sent, &bytes) < 0) break;
+            pending = 0;
+        }
+    }
+
+    if (pending > 0) {
+        LAT_WaitUntil(pending_due);
+        flush_batch(sockfd, msgs, pending, &sent, &bytes);
+    }
+
+    double secs = (start != 0) ? (double)(LAT_NowNs() - start) / 1e9 : 0;
+    double span = (start != 0) ? (double)(int64)(last_rx - first_rx) / 1e9 : 0;
+    printf("[REPLAY] Sent %llu packets, %llu bytes in %.3f s (recorded span %.3f s, %.0f pkt/s)\n",
+           (unsigned long long)sent, (unsigned long long)bytes, secs, span, secs > 0 ? sent / secs : 0);
+
+    ARC_CloseReader(&reader);
+    close(sockfd);
+    return 0;
+}
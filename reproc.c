@@ -0,0 +1,503 @@
+/*
+** File: reproc.c
+** Role: GROUND TOOL (Offline Reprocessing)
+** Description: Runs recorded traffic through checksum validation and header
+**              decode on all cores, then merges per-APID statistics (and
+**              the optional per-packet CSV) in file order.
+**
+**              Inputs, detected by content:
+**              - archive segments (seg_NNNNNN.arc) written by the receiver -r
+**              - pcap / pcapng captures
+**              - raw streams of concatenated CCSDS packets
+**
+**              Archive segments and raw streams are cut into byte chunks.
+**              Each chunk but the first resynchronizes on the first offset
+**              where RESYNC_CHAIN plausible packets follow back to back. The
+**              merge checks that every chunk started where its predecessor
+**              stopped and reprocesses it serially if not, so the result is
+**              always identical to a single-threaded pass. Captures are
+**              walked once by the main thread and cut by packet count.
+**
+**              Chunks are processed in windows. Each window is a single
+**              task that splits itself in halves onto the worker's deque,
+**              and idle workers steal the halves.
+**
+** Usage:       reproc [-j threads] [-s chunk_mb] [-o packets.csv] file...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ccsds.h"
+#include "archive.h"
+#include "pcap.h"
+#include "workq.h"
+
+#define RESYNC_CHAIN     8
+#define PCAP_CHUNK_PKTS  65536
+#define MAX_INPUTS       4096
+
+enum { INPUT_RAW, INPUT_ARC, INPUT_PCAP };
+
+struct input {
+    const char     *path;
+    int             path_len;    // CSV rows start with the path
+    int             kind;
+    const uint8    *map;
+    uint64          map_len;
+    uint64          base;        // First record offset
+    uint64          limit;       // End of valid data
+    uint32          align;       // Record alignment, resync step
+    uint64          first_ns;    // Archive segment time span, for plausibility
+    uint64          last_ns;
+    PCAP_Reader_t   pcap;
+    uint64          expected;    // Merge cursor: where the next chunk must start
+};
+
+struct apid_stats {
+    uint64 packets;
+    uint64 bytes;
+    uint64 bad_checksum;
+    uint64 seq_gaps;
+    uint16 first_seq;
+    uint16 last_seq;
+};
+
+struct chunk {
+    WQ_Task_t          task;     // First member: Run recovers the chunk from it
+    struct chunk      *window;   // Chunk array of the window, for splitting
+    uint32             index;
+    uint32             split_hi; // This task covers window[index .. split_hi)
+
+    struct input      *in;
+    uint64             start;    // Requested byte range
+    uint64             end;
+    uint64             first;    // Resynchronized start
+    uint64             stop;     // Offset where the walk stopped
+
+    PCAP_Packet_t     *pkts;     // Capture chunks only
+    uint32             num_pkts;
+
+    struct apid_stats *stats;
+    uint64             resync_bytes;
+    char              *out;
+    size_t             out_len;
+    size_t             out_cap;
+};
+
+static WQ_Pool_t pool;
+static bool      want_csv = false;
+
+static uint64 mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ull + (uint64)ts.tv_nsec;
+}
+
+// --- RECORD FRAMING ---
+
+// Size of the plausible record at off (0 if none), with its packet
+static uint32 record_at(const struct input *in, uint64 off, const uint8 **pkt, uint32 *pkt_len, uint64 *time_ns) {
+    const CCSDS_PriHdr_t *hdr;
+
+    if (in->kind == INPUT_RAW) {
+        if (off + sizeof(CCSDS_PriHdr_t) > in->limit) return 0;
+        hdr = (const CCSDS_PriHdr_t *)(in->map + off);
+        uint32 total = CCSDS_RD_LEN(*hdr);
+        if (CCSDS_RD_VERS(*hdr) != 0 || off + total > in->limit) return 0;
+        *pkt = in->map + off;
+        *pkt_len = total;
+        *time_ns = 0;
+        return total;
+    }
+
+    // Archive record: header, then a packet whose own length matches
+    ARC_RecHdr_t rec;
+    if (off + sizeof(rec) + sizeof(CCSDS_PriHdr_t) > in->limit) return 0;
+    memcpy(&rec, in->map + off, sizeof(rec));
+    if (rec.Spare != 0 || rec.RxTimeNs < in->first_ns || rec.RxTimeNs > in->last_ns) return 0;
+    if (off + sizeof(rec) + rec.Length > in->limit) return 0;
+    hdr = (const CCSDS_PriHdr_t *)(in->map + off + sizeof(rec));
+    if (CCSDS_RD_VERS(*hdr) != 0 || CCSDS_RD_LEN(*hdr) != rec.Length) return 0;
+    *pkt = (const uint8 *)hdr;
+    *pkt_len = rec.Length;
+    *time_ns = rec.RxTimeNs;
+    return ((uint32)sizeof(rec) + rec.Length + (ARC_REC_ALIGN - 1)) & ~(uint32)(ARC_REC_ALIGN - 1);
+}
+
+// First aligned offset >= off where RESYNC_CHAIN records (or all records
+// up to the end of the data) follow back to back
+static uint64 resync(const struct input *in, uint64 off) {
+    const uint8 *pkt;
+    uint32 len;
+    uint64 t;
+
+    off = (off + in->align - 1) / in->align * in->align;
+    for (; off < in->limit; off += in->align) {
+        uint64 next = off;
+        int n = 0;
+        uint32 size;
+        while (n < RESYNC_CHAIN && next < in->limit && (size = record_at(in, next, &pkt, &len, &t)) != 0) {
+            next += size;
+            n++;
+        }
+        if (n == RESYNC_CHAIN || (n > 0 && next == in->limit)) return off;
+    }
+    return in->limit;
+}
+
+// Record the walk accepts at off. A raw header is weak evidence (3 version
+// bits and a length that fits), so in raw streams the record must also be
+// followed by another plausible one, or be a command with a good checksum.
+// That keeps random bytes after a corruption from being taken as one long
+// packet that swallows the good ones behind it.
+static uint32 accept_at(const struct input *in, uint64 off, const uint8 **pkt, uint32 *pkt_len, uint64 *time_ns) {
+    const uint8 *next_pkt;
+    uint32 next_len;
+    uint64 next_t;
+    uint32 size = record_at(in, off, pkt, pkt_len, time_ns);
+
+    if (size == 0 || in->kind != INPUT_RAW || off + size == in->limit) return size;
+    if (record_at(in, off + size, &next_pkt, &next_len, &next_t) != 0) return size;
+
+    const CCSDS_PriHdr_t *hdr = (const CCSDS_PriHdr_t *)*pkt;
+    if (CCSDS_RD_TYPE(*hdr) == CCSDS_CMD && CCSDS_RD_SHDR(*hdr) && size >= sizeof(CCSDS_CommandPacket_t) &&
+        CCSDS_ValidCheckSum((CCSDS_CommandPacket_t *)*pkt)) {
+        return size;
+    }
+    return 0;
+}
+
+// --- PER-PACKET WORK ---
+
+static void out_append(struct chunk *c, const char *line, int len) {
+    if (c->out_len + (size_t)len > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap * 2 : 1 << 20;
+        while (cap < c->out_len + (size_t)len) cap *= 2;
+        c->out = realloc(c->out, cap);
+        if (c->out == NULL) { perror("Output buffer"); exit(EXIT_FAILURE); }
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, line, (size_t)len);
+    c->out_len += (size_t)len;
+}
+
+static void process_packet(struct chunk *c, const uint8 *pkt, uint32 len, uint64 off, uint64 time_ns) {
+    const CCSDS_PriHdr_t *phdr = (const CCSDS_PriHdr_t *)pkt;
+    CCSDS_CmdHdr_t hdr;
+    bool valid = true;
+
+    if (len < sizeof(CCSDS_PriHdr_t)) return;
+
+    if (len >= sizeof(CCSDS_CommandPacket_t)) {
+        CCSDS_DecodeCmdHdr(pkt, &hdr);
+    } else {
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.Apid     = (uint16)CCSDS_RD_APID(*phdr);
+        hdr.SeqCount = (uint16)CCSDS_RD_SEQ(*phdr);
+        hdr.Type     = (uint8)CCSDS_RD_TYPE(*phdr);
+        hdr.SecHdr   = (uint8)CCSDS_RD_SHDR(*phdr);
+    }
+
+    // Only commands with a secondary header carry a checksum
+    if (hdr.Type == CCSDS_CMD && hdr.SecHdr) {
+        valid = (len >= sizeof(CCSDS_CommandPacket_t) && (uint32)CCSDS_RD_LEN(*phdr) <= len &&
+                 CCSDS_ValidCheckSum((CCSDS_CommandPacket_t *)pkt));
+    }
+
+    struct apid_stats *s = &c->stats[hdr.Apid];
+    if (s->packets == 0) {
+        s->first_seq = hdr.SeqCount;
+    } else if (hdr.SeqCount != ((s->last_seq + 1) & 0x3FFF)) {
+        s->seq_gaps++;
+    }
+    s->last_seq = hdr.SeqCount;
+    s->packets++;
+    s->bytes += len;
+    if (!valid) s->bad_checksum++;
+
+    if (want_csv) {
+        // The path can be any length, the numbers after it fit in 96 bytes
+        char line[96];
+        int n = snprintf(line, sizeof(line), ",%llu,%llu,%u,%u,%u,%u,%d\n",
+                         (unsigned long long)off, (unsigned long long)time_ns, hdr.Apid, hdr.SeqCount,
+                         len, hdr.FuncCode, valid);
+        out_append(c, c->in->path, c->in->path_len);
+        out_append(c, line, n);
+    }
+}
+
+static void reset_chunk(struct chunk *c) {
+    memset(c->stats, 0, CCSDS_MAX_APID * sizeof(struct apid_stats));
+    c->resync_bytes = 0;
+    c->out_len = 0;
+}
+
+// Processes the records that start in [from, end), resyncing over garbage
+static void walk(struct chunk *c, uint64 from) {
+    const struct input *in = c->in;
+    const uint8 *pkt;
+    uint32 len;
+    uint64 t;
+    uint64 off = from;
+
+    while (off < c->end) {
+        uint32 size = accept_at(in, off, &pkt, &len, &t);
+        if (size == 0) {
+            uint64 next = resync(in, off + in->align);
+            c->resync_bytes += next - off;
+            off = next;
+            continue;
+        }
+        process_packet(c, pkt, len, off, t);
+        off += size;
+    }
+    c->first = from;
+    c->stop = off;
+}
+
+static void run_chunk(WQ_Task_t *task) {
+    struct chunk *c = (struct chunk *)task;
+
+    // Fork: hand the upper half of the range to the deque, keep the lower
+    while (c->split_hi - c->index > 1) {
+        uint32 mid = c->index + (c->split_hi - c->index) / 2;
+        c->window[mid].split_hi = c->split_hi;
+        WQ_Submit(&pool, &c->window[mid].task);
+        c->split_hi = mid;
+    }
+
+    if (c->in->kind == INPUT_PCAP) {
+        for (uint32 i = 0; i < c->num_pkts; i++) {
+            const PCAP_Packet_t *p = &c->pkts[i];
+            process_packet(c, p->Data, p->Len, (uint64)(p->Data - c->in->pcap.Map), p->TimeNs);
+        }
+        return;
+    }
+
+    uint64 from = (c->start == c->in->base) ? c->start : resync(c->in, c->start);
+    c->resync_bytes += from - c->start;
+    walk(c, from);
+}
+
+// --- INPUTS ---
+
+static bool open_input(struct input *in, const char *path) {
+    struct stat st;
+    int fd;
+
+    memset(in, 0, sizeof(*in));
+    in->path = path;
+    in->path_len = (int)strlen(path);
+
+    if (PCAP_OpenReader(&in->pcap, path, 0)) {
+        in->kind = INPUT_PCAP;
+        return true;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+    in->map_len = (uint64)st.st_size;
+    in->map = mmap(NULL, in->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (in->map == MAP_FAILED) { in->map = NULL; return false; }
+
+    const ARC_SegHdr_t *seg = (const ARC_SegHdr_t *)in->map;
+    if (in->map_len >= sizeof(*seg) && seg->Magic == ARC_SEG_MAGIC) {
+        in->kind     = INPUT_ARC;
+        in->align    = ARC_REC_ALIGN;
+        in->base     = (sizeof(*seg) + ARC_REC_ALIGN - 1) & ~(uint64)(ARC_REC_ALIGN - 1);
+        in->limit    = seg->Used < in->map_len ? seg->Used : in->map_len;
+        in->first_ns = seg->FirstTimeNs;
+        in->last_ns  = seg->LastTimeNs;
+    } else {
+        in->kind  = INPUT_RAW;
+        in->align = 1;
+        in->base  = 0;
+        in->limit = in->map_len;
+    }
+    in->expected = in->base;
+    return true;
+}
+
+static void close_input(struct input *in) {
+    if (in->kind == INPUT_PCAP) PCAP_CloseReader(&in->pcap);
+    else if (in->map != NULL) munmap((void *)in->map, in->map_len);
+}
+
+// --- MERGE ---
+
+static struct apid_stats totals[CCSDS_MAX_APID];
+static uint64 total_resync = 0, total_fixups = 0;
+
+static void merge_chunk(struct chunk *c, FILE *csv) {
+    struct input *in = c->in;
+
+    // A chunk that resynced somewhere else than its predecessor stopped
+    // is redone from the right offset, serially
+    if (in->kind != INPUT_PCAP) {
+        if (c->first != in->expected) {
+            reset_chunk(c);
+            walk(c, in->expected);
+            total_fixups++;
+        }
+        in->expected = c->stop;
+    }
+
+    for (uint32 a = 0; a < CCSDS_MAX_APID; a++) {
+        struct apid_stats *s = &c->stats[a], *t = &totals[a];
+        if (s->packets == 0) continue;
+        if (t->packets == 0) t->first_seq = s->first_seq;
+        else if (s->first_seq != ((t->last_seq + 1) & 0x3FFF)) t->seq_gaps++;
+        t->last_seq      = s->last_seq;
+        t->packets      += s->packets;
+        t->bytes        += s->bytes;
+        t->bad_checksum += s->bad_checksum;
+        t->seq_gaps     += s->seq_gaps;
+    }
+    total_resync += c->resync_bytes;
+
+    if (csv != NULL && c->out_len > 0) fwrite(c->out, 1, c->out_len, csv);
+}
+
+static void run_window(struct chunk *window, uint32 count, FILE *csv) {
+    if (count == 0) return;
+
+    window[0].split_hi = count;
+    WQ_Submit(&pool, &window[0].task);
+    WQ_Wait(&pool);
+
+    for (uint32 i = 0; i < count; i++) {
+        merge_chunk(&window[i], csv);
+        free(window[i].pkts);
+        window[i].pkts = NULL;
+    }
+}
+
+int main(int argc, char **argv) {
+    long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (int)(nproc > 0 ? nproc : 1);
+    uint64 chunk_bytes = 16ull << 20;
+    const char *csv_path = NULL;
+    FILE *csv = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:s:o:")) != -1) {
+        switch (opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 's': chunk_bytes = (uint64)atof(optarg) * (1ull << 20); break;
+            case 'o': csv_path = optarg; break;
+            default:  optind = argc + 1; break;
+        }
+    }
+    if (optind >= argc || threads < 1 || threads > WQ_MAX_WORKERS || chunk_bytes < 4096 ||
+        argc - optind > MAX_INPUTS) {
+        fprintf(stderr, "Usage: %s [-j threads<=%d] [-s chunk_mb] [-o packets.csv] file...\n", argv[0], WQ_MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (csv_path != NULL) {
+        csv = fopen(csv_path, "w");
+        if (csv == NULL) { perror("CSV open failed"); exit(EXIT_FAILURE); }
+        fprintf(csv, "file,offset,time_ns,apid,seq,length,func_code,valid\n");
+        want_csv = true;
+    }
+
+    if (!WQ_Init(&pool, (uint32)threads)) {
+        fprintf(stderr, "[REPROC] Could not start %d workers\n", threads);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32 num_inputs = (uint32)(argc - optind);
+    struct input *inputs = calloc(num_inputs, sizeof(struct input));
+    uint32 window_max = (uint32)threads * 8;
+    struct chunk *window = calloc(window_max, sizeof(struct chunk));
+    uint32 count = 0;
+    uint64 in_bytes = 0;
+    uint64 start = mono_ns();
+
+    if (inputs == NULL || window == NULL) { perror("Allocation failed"); exit(EXIT_FAILURE); }
+    for (uint32 i = 0; i < window_max; i++) {
+        window[i].stats = malloc(CCSDS_MAX_APID * sizeof(struct apid_stats));
+        if (window[i].stats == NULL) { perror("Allocation failed"); exit(EXIT_FAILURE); }
+    }
+
+    for (uint32 f = 0; f < num_inputs; f++) {
+        struct input *in = &inputs[f];
+        if (!open_input(in, argv[optind + f])) {
+            fprintf(stderr, "[REPROC] Skipping %s: cannot open\n", argv[optind + f]);
+            continue;
+        }
+
+        uint64 off = in->base;
+        PCAP_Packet_t p;
+        bool more = true;
+
+        while (more) {
+            struct chunk *c = &window[count];
+            reset_chunk(c);
+            c->task.Run = run_chunk;
+            c->window   = window;
+            c->index    = count;
+            c->split_hi = count + 1;
+            c->in       = in;
+
+            if (in->kind == INPUT_PCAP) {
+                c->pkts = malloc(PCAP_CHUNK_PKTS * sizeof(PCAP_Packet_t));
+                if (c->pkts == NULL) { perror("Allocation failed"); exit(EXIT_FAILURE); }
+                c->num_pkts = 0;
+                while (c->num_pkts < PCAP_CHUNK_PKTS && (more = PCAP_NextPacket(&in->pcap, &p))) {
+                    c->pkts[c->num_pkts++] = p;
+                    in_bytes += p.Len;
+                }
+                if (c->num_pkts == 0) { free(c->pkts); c->pkts = NULL; break; }
+            } else {
+                c->start = off;
+                c->end   = (in->limit - off > chunk_bytes) ? off + chunk_bytes : in->limit;
+                off      = c->end;
+                more     = off < in->limit;
+                in_bytes += c->end - c->start;
+            }
+
+            if (++count == window_max) {
+                run_window(window, count, csv);
+                count = 0;
+            }
+        }
+    }
+    run_window(window, count, csv);
+
+    double secs = (double)(mono_ns() - start) / 1e9;
+
+    printf("[REPROC] APID   Packets         Bytes  BadChecksum  SeqGaps\n");
+    uint64 pkts = 0, bad = 0;
+    for (uint32 a = 0; a < CCSDS_MAX_APID; a++) {
+        const struct apid_stats *t = &totals[a];
+        if (t->packets == 0) continue;
+        printf("[REPROC] 0x%03X %9llu %13llu %12llu %8llu\n", a, (unsigned long long)t->packets,
+               (unsigned long long)t->bytes, (unsigned long long)t->bad_checksum, (unsigned long long)t->seq_gaps);
+        pkts += t->packets;
+        bad += t->bad_checksum;
+    }
+    printf("[REPROC] %llu packets (%llu bad), %.1f MB in %.3f s: %.0f MB/s on %d workers\n",
+           (unsigned long long)pkts, (unsigned long long)bad, in_bytes / 1e6, secs,
+           secs > 0 ? in_bytes / 1e6 / secs : 0, threads);
+    printf("[REPROC] Resynced over %llu bytes, %llu chunk boundaries redone serially\n",
+           (unsigned long long)total_resync, (unsigned long long)total_fixups);
+    for (uint32 w = 0; w < pool.NumWorkers; w++) {
+        printf("[REPROC] Worker %u: %llu chunks, %llu stolen\n", w,
+               (unsigned long long)pool.Workers[w].Executed, (unsigned long long)pool.Workers[w].Stolen);
+    }
+
+    WQ_Destroy(&pool);
+    for (uint32 f = 0; f < num_inputs; f++) close_input(&inputs[f]);
+    if (csv != NULL) fclose(csv);
+    return 0;
+}
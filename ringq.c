@@ -0,0 +1,260 @@
+/*
+**  Bounded Lock-Free Queues - Packet handles between pipeline stages
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ringq.h"
+
+/******************************************************************************
+**  Function:  RQ_SpscInit()
+**
+**  Size must be a power of two.
+*/
+bool RQ_SpscInit (RQ_Spsc_t *Q, uint32 Size)
+{
+   memset(Q, 0, sizeof(*Q));
+   if (Size == 0 || (Size & (Size - 1)) != 0) return false;
+
+   if (posix_memalign((void **)&Q->Slots, 64, Size * sizeof(void *)) != 0) return false;
+   Q->Mask = Size - 1;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  RQ_SpscFree()
+*/
+void RQ_SpscFree (RQ_Spsc_t *Q)
+{
+   free(Q->Slots);
+   memset(Q, 0, sizeof(*Q));
+}
+
+/******************************************************************************
+**  Function:  RQ_SpscPush()
+**
+**  Producer side. Takes as many of Items as fit and publishes them with a
+**  single store; the rest are the caller's to retry or drop.
+*/
+uint32 RQ_SpscPush (RQ_Spsc_t *Q, void *const *Items, uint32 Count)
+{
+   uint64 Head = Q->Head;
+   uint64 Size = Q->Mask + 1;
+   uint64 Free = Size - (Head - Q->TailCache);
+   uint32 i;
+
+   if (Free < Count)
+   {
+      Q->TailCache = __atomic_load_n(&Q->Tail, __ATOMIC_ACQUIRE);
+      Free = Size - (Head - Q->TailCache);
+   }
+   if (Free < Count)
+   {
+      Q->Full++;
+      Count = (uint32)Free;
+   }
+   if (Count == 0) return 0;
+
+   for (i = 0; i < Count; ++i) Q->Slots[(Head + i) & Q->Mask] = Items[i];
+   __atomic_store_n(&Q->Head, Head + Count, __ATOMIC_RELEASE);
+
+   Q->Pushed += Count;
+
+   return Count;
+}
+
+/******************************************************************************
+**  Function:  RQ_SpscPop()
+**
+**  Consumer side. Up to Max items, oldest first.
+*/
+uint32 RQ_SpscPop (RQ_Spsc_t *Q, void **Items, uint32 Max)
+{
+   uint64 Tail  = Q->Tail;
+   uint64 Avail = Q->HeadCache - Tail;
+   uint32 i;
+
+   if (Avail < Max)
+   {
+      Q->HeadCache = __atomic_load_n(&Q->Head, __ATOMIC_ACQUIRE);
+      Avail = Q->HeadCache - Tail;
+   }
+   /* The producer's cached tail can be far behind; the depth seen here is exact up to HeadCache */
+   if (Avail > Q->MaxDepth) Q->MaxDepth = Avail;
+   if (Avail < Max) Max = (uint32)Avail;
+   if (Max == 0) return 0;
+
+   for (i = 0; i < Max; ++i) Items[i] = Q->Slots[(Tail + i) & Q->Mask];
+   __atomic_store_n(&Q->Tail, Tail + Max, __ATOMIC_RELEASE);
+
+   Q->Popped += Max;
+
+   return Max;
+}
+
+/******************************************************************************
+**  Function:  RQ_SpscDepth()
+**
+**  From any thread, a snapshot.
+*/
+uint32 RQ_SpscDepth (const RQ_Spsc_t *Q)
+{
+   uint64 Tail = __atomic_load_n(&Q->Tail, __ATOMIC_ACQUIRE);
+   uint64 Head = __atomic_load_n(&Q->Head, __ATOMIC_ACQUIRE);
+
+   return Head > Tail ? (uint32)(Head - Tail) : 0;
+}
+
+/******************************************************************************
+**  Function:  RQ_SpscStats()
+**
+**  From any thread; the counters are each written by one side and may be
+**  a few items stale.
+*/
+void RQ_SpscStats (const RQ_Spsc_t *Q, RQ_Stats_t *Stats)
+{
+   Stats->Pushed   = __atomic_load_n(&Q->Pushed, __ATOMIC_RELAXED);
+   Stats->Popped   = __atomic_load_n(&Q->Popped, __ATOMIC_RELAXED);
+   Stats->Full     = __atomic_load_n(&Q->Full, __ATOMIC_RELAXED);
+   Stats->MaxDepth = __atomic_load_n(&Q->MaxDepth, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+**  Function:  RQ_MpmcInit()
+**
+**  Size must be a power of two.
+*/
+bool RQ_MpmcInit (RQ_Mpmc_t *Q, uint32 Size)
+{
+   uint32 i;
+
+   memset(Q, 0, sizeof(*Q));
+   if (Size == 0 || (Size & (Size - 1)) != 0) return false;
+
+   if (posix_memalign((void **)&Q->Cells, 64, Size * sizeof(RQ_Cell_t)) != 0) return false;
+   for (i = 0; i < Size; ++i)
+   {
+      Q->Cells[i].Seq  = i;
+      Q->Cells[i].Item = NULL;
+   }
+   Q->Mask = Size - 1;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  RQ_MpmcFree()
+*/
+void RQ_MpmcFree (RQ_Mpmc_t *Q)
+{
+   free(Q->Cells);
+   memset(Q, 0, sizeof(*Q));
+}
+
+/******************************************************************************
+**  Function:  RQ_MpmcPush()
+**
+**  A cell is free for position Pos when its sequence equals Pos; the
+**  producer that wins the CAS on Enqueue owns it, fills it and hands it
+**  to consumers by setting the sequence to Pos + 1.
+*/
+bool RQ_MpmcPush (RQ_Mpmc_t *Q, void *Item)
+{
+   uint64     Pos = __atomic_load_n(&Q->Enqueue, __ATOMIC_RELAXED);
+   uint64     Depth;
+   RQ_Cell_t *Cell;
+   int64      Diff;
+
+   for (;;)
+   {
+      Cell = &Q->Cells[Pos & Q->Mask];
+      Diff = (int64)(__atomic_load_n(&Cell->Seq, __ATOMIC_ACQUIRE) - Pos);
+
+      if (Diff == 0)
+      {
+         if (__atomic_compare_exchange_n(&Q->Enqueue, &Pos, Pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+      }
+      else if (Diff < 0)
+      {
+         /* The cell still holds an item from one lap ago: full */
+         __atomic_fetch_add(&Q->Full, 1, __ATOMIC_RELAXED);
+         return false;
+      }
+      else
+      {
+         Pos = __atomic_load_n(&Q->Enqueue, __ATOMIC_RELAXED);
+      }
+   }
+
+   Cell->Item = Item;
+   __atomic_store_n(&Cell->Seq, Pos + 1, __ATOMIC_RELEASE);
+
+   Depth = Pos + 1 - __atomic_load_n(&Q->Dequeue, __ATOMIC_RELAXED);
+   if (Depth <= Q->Mask + 1 && Depth > __atomic_load_n(&Q->MaxDepth, __ATOMIC_RELAXED))
+   {
+      __atomic_store_n(&Q->MaxDepth, Depth, __ATOMIC_RELAXED);   /* Racy max, good enough for a report */
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  RQ_MpmcPop()
+*/
+bool RQ_MpmcPop (RQ_Mpmc_t *Q, void **Item)
+{
+   uint64     Pos = __atomic_load_n(&Q->Dequeue, __ATOMIC_RELAXED);
+   RQ_Cell_t *Cell;
+   int64      Diff;
+
+   for (;;)
+   {
+      Cell = &Q->Cells[Pos & Q->Mask];
+      Diff = (int64)(__atomic_load_n(&Cell->Seq, __ATOMIC_ACQUIRE) - (Pos + 1));
+
+      if (Diff == 0)
+      {
+         if (__atomic_compare_exchange_n(&Q->Dequeue, &Pos, Pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+      }
+      else if (Diff < 0)
+      {
+         return false;   /* Empty */
+      }
+      else
+      {
+         Pos = __atomic_load_n(&Q->Dequeue, __ATOMIC_RELAXED);
+      }
+   }
+
+   *Item = Cell->Item;
+   __atomic_store_n(&Cell->Seq, Pos + Q->Mask + 1, __ATOMIC_RELEASE);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  RQ_MpmcDepth()
+*/
+uint32 RQ_MpmcDepth (const RQ_Mpmc_t *Q)
+{
+   uint64 Deq = __atomic_load_n(&Q->Dequeue, __ATOMIC_ACQUIRE);
+   uint64 Enq = __atomic_load_n(&Q->Enqueue, __ATOMIC_ACQUIRE);
+
+   return Enq > Deq ? (uint32)(Enq - Deq) : 0;
+}
+
+/******************************************************************************
+**  Function:  RQ_MpmcStats()
+**
+**  Pushed and Popped count claimed positions, so an item being written or
+**  read at that moment is already included.
+*/
+void RQ_MpmcStats (const RQ_Mpmc_t *Q, RQ_Stats_t *Stats)
+{
+   Stats->Pushed   = __atomic_load_n(&Q->Enqueue, __ATOMIC_RELAXED);
+   Stats->Popped   = __atomic_load_n(&Q->Dequeue, __ATOMIC_RELAXED);
+   Stats->Full     = __atomic_load_n(&Q->Full, __ATOMIC_RELAXED);
+   Stats->MaxDepth = __atomic_load_n(&Q->MaxDepth, __ATOMIC_RELAXED);
+}
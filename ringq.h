@@ -0,0 +1,97 @@
+/*
+**  Bounded Lock-Free Queues - Packet handles between pipeline stages
+**
+**  Both queues carry pointers (normally PKT_Buf_t handles), never packet
+**  bytes, and have a fixed power-of-two capacity set at init. A full queue
+**  is reported to the producer, never grown, so the caller decides between
+**  waiting (backpressure) and shedding.
+**
+**  RQ_Spsc_t links one producer thread to one consumer thread. The head
+**  and tail sit on their own cache lines and each side keeps a private
+**  copy of the other side's index, refreshed only when the queue looks
+**  full (or empty). Push and pop move whole batches with one release
+**  store.
+**
+**  RQ_Mpmc_t is a Vyukov bounded queue: every cell carries a sequence
+**  number, producers and consumers claim cells with a CAS on their index.
+**  Use it where several stages feed one (or several) consumers.
+**
+**  Both keep counters for monitoring: items through, failed pushes (the
+**  queue was full) and the deepest the queue has been.
+*/
+
+#ifndef _ringq_
+#define _ringq_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*----- Counters, for reports -----*/
+typedef struct {
+
+   uint64  Pushed;
+   uint64  Popped;
+   uint64  Full;          /* Pushes (or batch remainders) refused */
+   uint64  MaxDepth;      /* Deepest seen (SPSC: by the consumer, MPMC: after a push) */
+
+} RQ_Stats_t;
+
+/*----- Single producer, single consumer -----*/
+typedef struct {
+
+   uint64      Head      __attribute__((aligned(64)));   /* Producer writes */
+   uint64      TailCache;                                 /* Producer's view of Tail */
+   uint64      Pushed;
+   uint64      Full;
+
+   uint64      Tail      __attribute__((aligned(64)));   /* Consumer writes */
+   uint64      HeadCache;                                 /* Consumer's view of Head */
+   uint64      Popped;
+   uint64      MaxDepth;
+
+   void      **Slots     __attribute__((aligned(64)));
+   uint64      Mask;
+
+} RQ_Spsc_t;
+
+/*----- Multiple producers, multiple consumers -----*/
+typedef struct {
+
+   uint64      Seq;
+   void       *Item;
+
+} RQ_Cell_t;
+
+typedef struct {
+
+   uint64      Enqueue   __attribute__((aligned(64)));
+   uint64      Dequeue   __attribute__((aligned(64)));
+
+   RQ_Cell_t  *Cells     __attribute__((aligned(64)));
+   uint64      Mask;
+   uint64      Full;
+   uint64      MaxDepth;
+
+} RQ_Mpmc_t;
+
+
+/*
+** Exported Functions
+*/
+bool    RQ_SpscInit   (RQ_Spsc_t *Q, uint32 Size);
+void    RQ_SpscFree   (RQ_Spsc_t *Q);
+uint32  RQ_SpscPush   (RQ_Spsc_t *Q, void *const *Items, uint32 Count);   /* Number taken */
+uint32  RQ_SpscPop    (RQ_Spsc_t *Q, void **Items, uint32 Max);
+uint32  RQ_SpscDepth  (const RQ_Spsc_t *Q);
+void    RQ_SpscStats  (const RQ_Spsc_t *Q, RQ_Stats_t *Stats);
+
+bool    RQ_MpmcInit   (RQ_Mpmc_t *Q, uint32 Size);
+void    RQ_MpmcFree   (RQ_Mpmc_t *Q);
+bool    RQ_MpmcPush   (RQ_Mpmc_t *Q, void *Item);
+bool    RQ_MpmcPop    (RQ_Mpmc_t *Q, void **Item);
+uint32  RQ_MpmcDepth  (const RQ_Mpmc_t *Q);
+void    RQ_MpmcStats  (const RQ_Mpmc_t *Q, RQ_Stats_t *Stats);
+
+#endif  /* _ringq_ */
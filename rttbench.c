@@ -0,0 +1,230 @@
+/*
+** File: rttbench.c
+** Role: SENDER (Round-Trip Benchmark)
+** Description: Measures command round-trip time against a receiver started
+**              in echo mode (-e), which answers every valid telecommand
+**              with an acknowledgement telemetry packet that carries the
+**              command's headers. One command is outstanding at a time;
+**              the RTT runs from just before the send to the moment the
+**              matching acknowledgement is read back.
+**
+**              Wait modes:
+**              - block  recv() sleeps in the kernel until the ack arrives
+**              - busy   recv(MSG_DONTWAIT) in a spin loop, no wakeup cost
+**              -P additionally sets SO_BUSY_POLL so the kernel polls the
+**              device queue on the blocking path (needs CAP_NET_ADMIN
+**              above net.core.busy_read).
+**
+**              Acks for earlier, timed-out commands are discarded by
+**              sequence count. The full distribution goes to the console
+**              and, with -o, to a JSON report.
+**
+** Usage:       rttbench [-t ip] [-p port] [-n count] [-W warmup]
+**                       [-m block|busy] [-s payload] [-i interval_us]
+**                       [-T timeout_ms] [-P busy_poll_us] [-o report.json]
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "ccsds.h"
+#include "latency.h"
+
+#define TARGET_IP     "127.0.0.1"
+#define TARGET_PORT   8888
+#define BENCH_APID    0x1F0
+#define MAX_PAYLOAD   1024
+#define ACK_BUF_SIZE  2048
+
+enum { WAIT_BLOCK, WAIT_BUSY };
+
+// Reads one datagram; 0 on timeout
+static int recv_ack(int sockfd, int mode, uint8 *buf, uint64 deadline_ns) {
+    for (;;) {
+        int n = (int)recv(sockfd, buf, ACK_BUF_SIZE, mode == WAIT_BUSY ? MSG_DONTWAIT : 0);
+        if (n > 0) return n;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            perror("Receive failed");
+            exit(EXIT_FAILURE);
+        }
+        if (LAT_NowNs() >= deadline_ns) return 0;
+    }
+}
+
+// True if buf is the ack for the command with this APID and sequence count
+static bool is_ack_for(const uint8 *buf, int n, uint16 apid, uint16 seq) {
+    const CCSDS_PriHdr_t *tlm = (const CCSDS_PriHdr_t *)buf;
+    const CCSDS_PriHdr_t *cmd = (const CCSDS_PriHdr_t *)(buf + sizeof(CCSDS_TelemetryPacket_t));
+
+    if (n < (int)(sizeof(CCSDS_TelemetryPacket_t) + sizeof(CCSDS_CommandPacket_t))) return false;
+    if (CCSDS_RD_TYPE(*tlm) != CCSDS_TLM || CCSDS_RD_APID(*tlm) != apid) return false;
+    return CCSDS_RD_APID(*cmd) == apid && CCSDS_RD_SEQ(*cmd) == seq;
+}
+
+static void write_report(const char *path, const char *target_ip, int target_port, const char *mode_name,
+                         int busy_poll_us, int payload, int interval_us, uint64 count, uint64 warmup,
+                         uint64 timeouts, uint64 stale, double secs, const LAT_Hist_t *rtt) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("Report open failed");
+        return;
+    }
+    fprintf(fp, "{\n  \"tool\": \"rttbench\",\n");
+    fprintf(fp, "  \"config\": {\"target\": \"%s:%d\", \"mode\": \"%s\", \"busy_poll_us\": %d, "
+                "\"payload_bytes\": %d, \"interval_us\": %d, \"count\": %llu, \"warmup\": %llu},\n",
+            target_ip, target_port, mode_name, busy_poll_us, payload, interval_us,
+            (unsigned long long)count, (unsigned long long)warmup);
+    fprintf(fp, "  \"result\": {\"completed\": %llu, \"timeouts\": %llu, \"stale_acks\": %llu, \"seconds\": %.3f},\n",
+            (unsigned long long)rtt->Total, (unsigned long long)timeouts, (unsigned long long)stale, secs);
+    fprintf(fp, "  \"rtt\": ");
+    LAT_WriteJson(fp, rtt);
+    fprintf(fp, "\n}\n");
+    fclose(fp);
+}
+
+int main(int argc, char **argv) {
+    const char *target_ip = TARGET_IP;
+    int target_port = TARGET_PORT;
+    long count = 100000;
+    long warmup = 1000;
+    int mode = WAIT_BLOCK;
+    int payload = 32;
+    int interval_us = 0;
+    int timeout_ms = 100;
+    int busy_poll_us = 0;
+    const char *report_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:p:n:W:m:s:i:T:P:o:")) != -1) {
+        switch (opt) {
+            case 't': target_ip = optarg; break;
+            case 'p': target_port = atoi(optarg); break;
+            case 'n': count = atol(optarg); break;
+            case 'W': warmup = atol(optarg); break;
+            case 'm':
+                if      (strcmp(optarg, "block") == 0) mode = WAIT_BLOCK;
+                else if (strcmp(optarg, "busy") == 0)  mode = WAIT_BUSY;
+                else count = -1;
+                break;
+            case 's': payload = atoi(optarg); break;
+            case 'i': interval_us = atoi(optarg); break;
+            case 'T': timeout_ms = atoi(optarg); break;
+            case 'P': busy_poll_us = atoi(optarg); break;
+            case 'o': report_path = optarg; break;
+            default:  count = -1; break;
+        }
+    }
+    if (count < 1 || warmup < 0 || payload < 0 || payload > MAX_PAYLOAD || interval_us < 0 ||
+        timeout_ms < 1 || busy_poll_us < 0) {
+        fprintf(stderr, "Usage: %s [-t ip] [-p port] [-n count] [-W warmup] [-m block|busy] [-s payload<=%d]\n"
+                        "       [-i interval_us] [-T timeout_ms] [-P busy_poll_us] [-o report.json]\n",
+                argv[0], MAX_PAYLOAD);
+        exit(EXIT_FAILURE);
+    }
+
+    int sockfd;
+    struct sockaddr_in servaddr;
+
+    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        perror("Socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_port = htons(target_port);
+    servaddr.sin_addr.s_addr = inet_addr(target_ip);
+
+    // Connected: acks from anywhere else are filtered by the kernel
+    if (connect(sockfd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
+        perror("Connect failed");
+        exit(EXIT_FAILURE);
+    }
+
+    // The blocking wait wakes up at the latest after the timeout
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (busy_poll_us > 0 && setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) < 0) {
+        perror("[RTTBENCH] SO_BUSY_POLL not set");
+    }
+
+    static uint8 pattern[MAX_PAYLOAD];
+    for (size_t i = 0; i < sizeof(pattern); i++) pattern[i] = (uint8)('A' + i % 26);
+
+    static uint8 cmd_buf[sizeof(CCSDS_CommandPacket_t) + MAX_PAYLOAD];
+    static uint8 ack_buf[ACK_BUF_SIZE];
+    CCSDS_CmdTemplate_t tmpl;
+    if (CCSDS_InitCmdTemplate(&tmpl, cmd_buf, (uint16)sizeof(cmd_buf), BENCH_APID, 0x0B, pattern, (uint16)payload) == 0) {
+        fprintf(stderr, "[RTTBENCH] Template build failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    static LAT_Hist_t rtt;
+    LAT_InitHist(&rtt);
+
+    const char *mode_name = (mode == WAIT_BUSY) ? "busy" : "block";
+    printf("[RTTBENCH] %s:%d, %ld commands (+%ld warmup), %d byte payload, %s wait%s\n",
+           target_ip, target_port, count, warmup, payload, mode_name, busy_poll_us > 0 ? " + SO_BUSY_POLL" : "");
+
+    uint64 timeouts = 0, stale = 0;
+    uint64 total = (uint64)count + (uint64)warmup;
+    uint16 seq = 0;
+    uint64 start = 0;
+    uint64 next = LAT_NowNs();
+
+    for (uint64 i = 0; i < total; i++) {
+        if (i == (uint64)warmup) start = LAT_NowNs();
+        if (interval_us > 0) {
+            LAT_WaitUntil(next);
+            next += (uint64)interval_us * 1000;
+        }
+
+        CCSDS_SetTemplateSeq(&tmpl, seq);
+
+        uint64 t0 = LAT_NowNs();
+        if (send(sockfd, cmd_buf, tmpl.Length, 0) < 0) {
+            perror("Send failed");
+            exit(EXIT_FAILURE);
+        }
+
+        uint64 deadline = t0 + (uint64)timeout_ms * 1000000;
+        for (;;) {
+            int n = recv_ack(sockfd, mode, ack_buf, deadline);
+            if (n == 0) {
+                timeouts++;
+                break;
+            }
+            if (is_ack_for(ack_buf, n, BENCH_APID, seq)) {
+                uint64 t1 = LAT_NowNs();
+                if (i >= (uint64)warmup) LAT_Record(&rtt, t1 - t0);
+                break;
+            }
+            stale++;
+        }
+        seq = (seq + 1) & 0x3FFF;
+    }
+
+    double secs = (double)(LAT_NowNs() - start) / 1e9;
+    printf("[RTTBENCH] %llu round trips in %.3f s (%.0f/s), %llu timeouts, %llu stale acks\n",
+           (unsigned long long)rtt.Total, secs, secs > 0 ? rtt.Total / secs : 0,
+           (unsigned long long)timeouts, (unsigned long long)stale);
+    LAT_Report(stdout, "command -> ack", &rtt);
+    printf("[RTTBENCH] p99.99 %.1f us, min %.1f us\n", LAT_Percentile(&rtt, 99.99) / 1e3,
+           rtt.Total ? rtt.MinNs / 1e3 : 0.0);
+
+    if (report_path != NULL) {
+        write_report(report_path, target_ip, target_port, mode_name, busy_poll_us, payload, interval_us,
+                     (uint64)count, (uint64)warmup, timeouts, stale, secs, &rtt);
+        printf("[RTTBENCH] Report written to %s\n", report_path);
+    }
+
+    close(sockfd);
+    return 0;
+}
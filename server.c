@@ -2,6 +2,21 @@
 ** File: ground_station.c
 ** Role: SENDER (Ground Station)
 ** Description: Encodes telecommands into CCSDS packets and transmits them via UDP.
+**
+**              With -m the sender instead uplinks a file as a run of MemLoad
+**              commands (APID 0x1B0, function code 0x10, big-endian u32
+**              address then data, as in commands.csv) and exits. -z sends
+**              them through io_uring with IORING_OP_SEND_ZC: packets are
+**              built in place in slots of one registered buffer, the
+**              kernel transmits from those pages without copying, and a
+**              slot is reused only after its notification completion.
+**
+**              With -s the commands go into the receiver's shared-memory
+**              ring (client -s) instead of a socket, built in place in the
+**              ring slot.
+**
+** Usage:       server [-l] [-i interval_ms] [-s shm_name [-P]]
+**              server -m file [-A address] [-c chunk] [-z]
 */
 
 #include <stdio.h>
@@ -11,13 +26,32 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ccsds.h"
+#include "latency.h"
+#include "uring.h"
+#include "shmring.h"
+#include "pktpool.h"
 
 #define TARGET_IP   "127.0.0.1" // Loopback for local simulation
 #define TARGET_PORT 8888
 #define BUF_SIZE    1024
 
+#define MEMLOAD_APID     0x1B0
+#define MEMLOAD_FC       0x10
+#define MEMLOAD_HDR      4            // Address field before the data
+#define MEMLOAD_CHUNK    (BUF_SIZE - sizeof(CCSDS_CommandPacket_t) - MEMLOAD_HDR)
+#define ZC_SLOTS         64           // Packets in flight in registered memory
+#define ZC_SUBMIT_BATCH  16
+#define SHM_RESERVE_NS   1000000000ull   // Give up on a full ring after a second
+#define POOL_COUNTS      { 0, 8, 0, 0 }  // Command buffers (2 KiB class)
+
 // --- VISUALIZATION HELPER ---
 void print_byte_as_bits(uint8 byte) {
     for (int i = 7; i >= 0; i--) {
@@ -57,15 +91,240 @@ void visualize_packet(uint8* buffer, int len) {
     printf("=================================================================\n\n");
 }
 
-int main() {
+// --- BULK MEMORY LOAD ---
+struct upload_stats {
+    uint64 packets;
+    uint64 bytes;
+    uint64 errors;
+    uint64 copied;          // Zero-copy sends the kernel fell back to copying
+};
+
+// MemLoad for data[0 .. len) at address, built directly in pkt: header
+// without a checksum, then the payload, then the checksum once over both
+static uint16 build_memload(uint8 *pkt, uint16 pkt_size, uint16 seq, uint32 address, const uint8 *data, uint16 len) {
+    uint32 total = (uint32)sizeof(CCSDS_CommandPacket_t) + MEMLOAD_HDR + len;
+    if (total > pkt_size || total > 0xFFFF) return 0;
+
+    CCSDS_CmdHdr_t hdr = {
+        .Version = 0, .Type = CCSDS_CMD, .SecHdr = CCSDS_HAS_SEC_HDR, .Apid = MEMLOAD_APID,
+        .SeqFlags = CCSDS_INIT_SEQFLG, .SeqCount = seq, .Length = (uint16)total,
+        .FuncCode = MEMLOAD_FC, .CheckSum = CCSDS_INIT_CHECKSUM,
+    };
+    CCSDS_EncodeCmdHdr(pkt, &hdr);
+
+    uint8 *p = pkt + sizeof(CCSDS_CommandPacket_t);
+    p[0] = (uint8)(address >> 24);
+    p[1] = (uint8)(address >> 16);
+    p[2] = (uint8)(address >> 8);
+    p[3] = (uint8)address;
+    memcpy(p + MEMLOAD_HDR, data, len);
+    CCSDS_LoadCheckSum((CCSDS_CommandPacket_t *)pkt);
+    return (uint16)total;
+}
+
+// Baseline: one packet buffer, one copying send per packet
+static void upload_copy(int sockfd, const uint8 *data, uint64 size, uint32 address, uint16 chunk,
+                        struct upload_stats *st) {
+    static uint8 pkt[65535];
+    uint16 seq = 0;
+
+    for (uint64 off = 0; off < size; off += chunk) {
+        uint16 n = (uint16)(size - off < chunk ? size - off : chunk);
+        uint16 len = build_memload(pkt, (uint16)sizeof(pkt), seq, address + (uint32)off, data + off, n);
+        ssize_t rc;
+        seq = (seq + 1) & 0x3FFF;
+        while ((rc = send(sockfd, pkt, len, 0)) < 0 && errno == EINTR) { }
+        if (rc < 0) {
+            st->errors++;
+            continue;
+        }
+        st->packets++;
+        st->bytes += len;
+    }
+}
+
+struct zc_sender {
+    URING_Ring_t ring;
+    uint8 *slots;           // ZC_SLOTS * slot_size, registered as fixed buffer 0
+    uint32 slot_size;
+    uint16 free_slots[ZC_SLOTS];
+    uint32 num_free;
+};
+
+// Reaps completions, waiting for at least wait_nr. A slot comes back with
+// its notification, or with the send result when no notification follows.
+static void zc_reap(struct zc_sender *zc, uint32 wait_nr, struct upload_stats *st) {
+    if (URING_Submit(&zc->ring, wait_nr) < 0 && errno != EINTR) {
+        perror("io_uring submit failed");
+        exit(EXIT_FAILURE);
+    }
+
+    uint32 n = URING_CqReady(&zc->ring);
+    for (uint32 i = 0; i < n; i++) {
+        struct io_uring_cqe *cqe = URING_Cqe(&zc->ring, i);
+        bool release;
+
+        if (cqe->flags & IORING_CQE_F_NOTIF) {
+            if ((uint32)cqe->res & IORING_NOTIF_USAGE_ZC_COPIED) st->copied++;
+            release = true;
+        } else {
+            if (cqe->res < 0) {
+                st->errors++;
+            } else {
+                st->packets++;
+                st->bytes += (uint64)cqe->res;
+            }
+            release = !(cqe->flags & IORING_CQE_F_MORE);
+        }
+        if (release) zc->free_slots[zc->num_free++] = (uint16)cqe->user_data;
+    }
+    URING_CqAdvance(&zc->ring, n);
+}
+
+static void upload_zc(int sockfd, const uint8 *data, uint64 size, uint32 address, uint16 chunk,
+                      struct upload_stats *st) {
+    static struct zc_sender zc;
+    uint32 queued = 0;
+    uint16 seq = 0;
+
+    // CQ holds two completions per slot in flight, with room to spare
+    if (!URING_Init(&zc.ring, ZC_SLOTS * 2, IORING_SETUP_SINGLE_ISSUER)) {
+        perror("io_uring setup failed");
+        exit(EXIT_FAILURE);
+    }
+
+    zc.slot_size = ((uint32)sizeof(CCSDS_CommandPacket_t) + MEMLOAD_HDR + chunk + 63) & ~63u;
+    zc.slots = mmap(NULL, (size_t)ZC_SLOTS * zc.slot_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (zc.slots == MAP_FAILED) {
+        perror("Slot allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    struct iovec iov = { zc.slots, (size_t)ZC_SLOTS * zc.slot_size };
+    if (!URING_RegisterBuffers(&zc.ring, &iov, 1)) {
+        perror("Buffer registration failed");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32 i = 0; i < ZC_SLOTS; i++) zc.free_slots[i] = (uint16)(ZC_SLOTS - 1 - i);
+    zc.num_free = ZC_SLOTS;
+
+    for (uint64 off = 0; off < size; off += chunk) {
+        while (zc.num_free == 0) {
+            zc_reap(&zc, 1, st);
+            queued = 0;
+        }
+
+        uint16 slot = zc.free_slots[--zc.num_free];
+        uint8 *pkt = zc.slots + (size_t)slot * zc.slot_size;
+        uint16 n = (uint16)(size - off < chunk ? size - off : chunk);
+        uint16 len = build_memload(pkt, (uint16)zc.slot_size, seq, address + (uint32)off, data + off, n);
+        seq = (seq + 1) & 0x3FFF;
+
+        struct io_uring_sqe *sqe = URING_GetSqe(&zc.ring);
+        if (sqe == NULL) {
+            zc_reap(&zc, 0, st);
+            queued = 0;
+            sqe = URING_GetSqe(&zc.ring);
+        }
+        sqe->opcode    = IORING_OP_SEND_ZC;
+        sqe->fd        = sockfd;
+        sqe->addr      = (uint64)(uintptr_t)pkt;
+        sqe->len       = len;
+        sqe->ioprio    = IORING_RECVSEND_FIXED_BUF | IORING_SEND_ZC_REPORT_USAGE;
+        sqe->buf_index = 0;
+        sqe->user_data = slot;
+
+        if (++queued == ZC_SUBMIT_BATCH) {
+            zc_reap(&zc, 0, st);
+            queued = 0;
+        }
+    }
+
+    while (zc.num_free < ZC_SLOTS) zc_reap(&zc, 1, st);
+
+    munmap(zc.slots, (size_t)ZC_SLOTS * zc.slot_size);
+    URING_Close(&zc.ring);
+}
+
+static void upload_file(int sockfd, const char *path, uint32 address, uint16 chunk, bool zero_copy) {
+    struct stat sb;
+    struct upload_stats st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &sb) < 0 || sb.st_size == 0) {
+        perror("Upload file open failed");
+        exit(EXIT_FAILURE);
+    }
+    const uint8 *data = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Upload file map failed");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("[GROUND STATION] Uplinking %s (%lld bytes) to 0x%08X, %u bytes per MemLoad, %s\n", path,
+           (long long)sb.st_size, address, chunk, zero_copy ? "io_uring zero-copy send" : "copying send");
+
+    memset(&st, 0, sizeof(st));
+    uint64 start = LAT_NowNs();
+    if (zero_copy) upload_zc(sockfd, data, (uint64)sb.st_size, address, chunk, &st);
+    else           upload_copy(sockfd, data, (uint64)sb.st_size, address, chunk, &st);
+    double secs = (double)(LAT_NowNs() - start) / 1e9;
+
+    printf("[GROUND STATION] %llu packets, %llu bytes in %.3f s: %.0f pkt/s, %.1f MB/s, %llu send errors\n",
+           (unsigned long long)st.packets, (unsigned long long)st.bytes, secs,
+           secs > 0 ? st.packets / secs : 0.0, secs > 0 ? st.bytes / secs / 1e6 : 0.0,
+           (unsigned long long)st.errors);
+    if (zero_copy) {
+        printf("[GROUND STATION] %llu of %llu sends fell back to a kernel copy\n",
+               (unsigned long long)st.copied, (unsigned long long)st.packets);
+    }
+
+    munmap((void *)data, (size_t)sb.st_size);
+}
+
+int main(int argc, char **argv) {
     int sockfd;
     struct sockaddr_in servaddr;
-    uint8 buffer[BUF_SIZE];
+    static PKT_Pool_t pool;
+    static const uint32 pool_counts[PKT_NUM_CLASSES] = POOL_COUNTS;
+    PKT_Cache_t cache;
+    bool latency_mode = false;
+    const char *upload_path = NULL;
+    uint32 upload_address = 0;
+    long upload_chunk = MEMLOAD_CHUNK;
+    bool zero_copy = false;
+    const char *shm_name = NULL;
+    bool busy_poll = false;
+    long interval_ms = 3000;
+    static SHM_Ring_t ring;
+    int opt;
     
     // Configuration for the target spacecraft
     uint16 apid = 0x1A5; // Example APID: 421
     uint16 seq = 0;
 
+    while ((opt = getopt(argc, argv, "lm:A:c:zs:Pi:")) != -1) {
+        switch (opt) {
+            case 'l': latency_mode = true; break;
+            case 'm': upload_path = optarg; break;
+            case 'A': upload_address = (uint32)strtoul(optarg, NULL, 0); break;
+            case 'c': upload_chunk = atol(optarg); break;
+            case 'z': zero_copy = true; break;
+            case 's': shm_name = optarg; break;
+            case 'P': busy_poll = true; break;
+            case 'i': interval_ms = atol(optarg); break;
+            default:  upload_chunk = 0; break;
+        }
+    }
+    if (upload_chunk < 1 || upload_chunk > 65535 - (long)(sizeof(CCSDS_CommandPacket_t) + MEMLOAD_HDR) ||
+        interval_ms < 0 || (shm_name != NULL && upload_path != NULL) || (busy_poll && shm_name == NULL)) {
+        fprintf(stderr, "Usage: %s [-l] [-i interval_ms] [-s shm_name [-P]]\n"
+                        "       %s -m file [-A address] [-c chunk] [-z]\n", argv[0], argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
     // 1. Create UDP Socket
     if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
         perror("Socket creation failed");
@@ -77,32 +336,102 @@ int main() {
     servaddr.sin_port = htons(TARGET_PORT);
     servaddr.sin_addr.s_addr = inet_addr(TARGET_IP);
 
-    printf("[GROUND STATION] System Online. Target: %s:%d\n", TARGET_IP, TARGET_PORT);
+    if (shm_name != NULL) {
+        if (!SHM_Attach(&ring, shm_name, busy_poll)) {
+            perror("Shared-memory ring attach failed (start the receiver with -s first)");
+            exit(EXIT_FAILURE);
+        }
+        printf("[GROUND STATION] System Online. Target: shared memory %s (%s)\n", shm_name,
+               busy_poll ? "busy-polling" : "futex wakeups");
+    } else {
+        printf("[GROUND STATION] System Online. Target: %s:%d\n", TARGET_IP, TARGET_PORT);
+    }
+
+    if (upload_path != NULL) {
+        // Connected, so every send (and SEND_ZC) goes without an address
+        if (connect(sockfd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
+            perror("Connect failed");
+            exit(EXIT_FAILURE);
+        }
+        upload_file(sockfd, upload_path, upload_address, (uint16)upload_chunk, zero_copy);
+        close(sockfd);
+        return 0;
+    }
+
+    if (!PKT_Init(&pool, pool_counts, 0)) {
+        perror("Packet pool setup failed");
+        exit(EXIT_FAILURE);
+    }
+    PKT_InitCache(&pool, &cache);
 
     while (1) {
         // 2. Prepare User Data (Payload)
-        char payload[32];
-        snprintf(payload, 32, "CMD_SEQ_%d", seq);
+        uint8 payload[32 + sizeof(LAT_Stamp_t)];
+        LAT_Stamp_t stamp;
+        uint16 payload_len;
+        snprintf((char *)payload, 32, "CMD_SEQ_%d", seq);
+        payload_len = (uint16)(strlen((char *)payload) + 1);
         uint8 func_code = 0x0A; // Example OpCode
 
         printf("[GROUND STATION] Preparing Command #%d...\n", seq);
 
+        // Latency mode: the stamp rides after the string, send time is patched in later
+        if (latency_mode) {
+            memset(&stamp, 0, sizeof(stamp));
+            stamp.Magic = LAT_STAMP_MAGIC;
+            stamp.BuildNs = LAT_NowNs();
+            memcpy(payload + payload_len, &stamp, sizeof(stamp));
+            payload_len += sizeof(stamp);
+        }
+
+        // Shared memory: encode straight into the next ring slot, else into a pool buffer
+        PKT_Buf_t *buf = NULL;
+        uint8 *pkt;
+        uint32 pkt_size = BUF_SIZE;
+        if (shm_name != NULL) {
+            if ((pkt = SHM_Reserve(&ring, &pkt_size, SHM_RESERVE_NS)) == NULL) {
+                printf("[GROUND STATION] Receiver ring full, command #%d dropped.\n", seq);
+                seq++;
+                continue;
+            }
+        } else {
+            if ((buf = PKT_Alloc(&pool, &cache, BUF_SIZE)) == NULL) {
+                printf("[GROUND STATION] Packet pool exhausted, command #%d dropped.\n", seq);
+                seq++;
+                continue;
+            }
+            pkt = PKT_Data(buf);
+            pkt_size = buf->Capacity;
+        }
+        if (pkt_size > 0xFFFF) pkt_size = 0xFFFF;
+
         // 3. Encode CCSDS Packet
-        uint16 len = CCSDS_BuildTelecommand(buffer, BUF_SIZE, apid, seq, func_code, (uint8*)payload, strlen(payload)+1);
+        uint16 len = CCSDS_BuildTelecommand(pkt, (uint16)pkt_size, apid, seq, func_code, payload, payload_len);
 
         if (len > 0) {
             // 4. Visualize the Raw Binary
-            visualize_packet(buffer, len);
+            visualize_packet(pkt, len);
+
+            // Stamp the send time, the incremental patch keeps the checksum valid
+            if (latency_mode) {
+                CCSDS_CmdTemplate_t tmpl = { (CCSDS_CommandPacket_t *)pkt, len };
+                uint64 send_ns = LAT_NowNs();
+                CCSDS_PatchTemplate(&tmpl, (uint16)(payload_len - sizeof(stamp) + offsetof(LAT_Stamp_t, SendNs)),
+                                    (const uint8 *)&send_ns, sizeof(send_ns));
+            }
 
-            // 5. Transmit over Uplink (UDP)
-            sendto(sockfd, buffer, len, 0, (const struct sockaddr *)&servaddr, sizeof(servaddr));
+            // 5. Transmit over Uplink (UDP, or publish the ring slot)
+            if (shm_name != NULL) SHM_Commit(&ring, len);
+            else                  sendto(sockfd, pkt, len, 0, (const struct sockaddr *)&servaddr, sizeof(servaddr));
             printf("[GROUND STATION] Packet transmitted.\n");
         } else {
             printf("[GROUND STATION] Error building packet.\n");
         }
+        if (buf != NULL) PKT_Release(&cache, buf);
 
         seq++;
-        sleep(3); // Wait 3 seconds before sending next command
+        struct timespec pause = { interval_ms / 1000, (interval_ms % 1000) * 1000000 };
+        nanosleep(&pause, NULL); // Wait before sending next command (3 s by default)
     }
 
     close(sockfd);
@@ -0,0 +1,271 @@
+/*
+**  Shared-Memory Packet Ring - Single producer, single consumer
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shmring.h"
+
+#define SHM_SLOT(r, i)  ((r)->Slots + (size_t)((i) & ((r)->Hdr->NumSlots - 1)) * (r)->Hdr->Stride)
+
+/******************************************************************************
+**  Function:  SHM_NowNs()
+*/
+static uint64 SHM_NowNs (void)
+{
+   struct timespec Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return (uint64)Ts.tv_sec * 1000000000ull + (uint64)Ts.tv_nsec;
+}
+
+/******************************************************************************
+**  Function:  SHM_Map()
+*/
+static bool SHM_Map (SHM_Ring_t *Ring, int Fd, size_t Len)
+{
+   void *Map = mmap(NULL, Len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, 0);
+
+   close(Fd);
+   if (Map == MAP_FAILED) return false;
+
+   Ring->Hdr    = (SHM_Hdr_t *)Map;
+   Ring->Slots  = (uint8 *)Map + sizeof(SHM_Hdr_t);
+   Ring->MapLen = Len;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  SHM_Create()
+**
+**  Creates (or replaces) the named segment with an empty ring.
+*/
+bool SHM_Create (SHM_Ring_t *Ring, const char *Name, uint32 NumSlots, uint32 SlotSize, bool BusyPoll)
+{
+   uint32 Stride = ((uint32)sizeof(SHM_SlotHdr_t) + SlotSize + 63) & ~63u;
+   size_t Len    = sizeof(SHM_Hdr_t) + (size_t)NumSlots * Stride;
+   int    Fd;
+
+   memset(Ring, 0, sizeof(*Ring));
+   if (NumSlots == 0 || (NumSlots & (NumSlots - 1)) != 0 || SlotSize == 0 || strlen(Name) >= SHM_NAME_MAX)
+   {
+      errno = EINVAL;
+      return false;
+   }
+
+   shm_unlink(Name);
+   Fd = shm_open(Name, O_RDWR | O_CREAT | O_EXCL, 0600);
+   if (Fd < 0) return false;
+   if (ftruncate(Fd, (off_t)Len) != 0)
+   {
+      close(Fd);
+      shm_unlink(Name);
+      return false;
+   }
+   if (!SHM_Map(Ring, Fd, Len))
+   {
+      shm_unlink(Name);
+      return false;
+   }
+
+   Ring->Hdr->NumSlots = NumSlots;
+   Ring->Hdr->SlotSize = SlotSize;
+   Ring->Hdr->Stride   = Stride;
+
+   /* Magic last: an attacher that sees it sees a complete header */
+   __atomic_store_n(&Ring->Hdr->Magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+   Ring->BusyPoll = BusyPoll;
+   Ring->Owner    = true;
+   snprintf(Ring->Name, sizeof(Ring->Name), "%s", Name);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  SHM_Attach()
+*/
+bool SHM_Attach (SHM_Ring_t *Ring, const char *Name, bool BusyPoll)
+{
+   struct stat St;
+   int Fd;
+
+   memset(Ring, 0, sizeof(*Ring));
+
+   Fd = shm_open(Name, O_RDWR, 0);
+   if (Fd < 0) return false;
+   if (fstat(Fd, &St) != 0 || (size_t)St.st_size < sizeof(SHM_Hdr_t))
+   {
+      close(Fd);
+      errno = EINVAL;
+      return false;
+   }
+   if (!SHM_Map(Ring, Fd, (size_t)St.st_size)) return false;
+
+   /* SHM_SLOT masks with NumSlots - 1, which needs a power of two */
+   if (__atomic_load_n(&Ring->Hdr->Magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+       Ring->Hdr->NumSlots == 0 || (Ring->Hdr->NumSlots & (Ring->Hdr->NumSlots - 1)) != 0 ||
+       (uint64)Ring->Hdr->Stride < sizeof(SHM_SlotHdr_t) + (uint64)Ring->Hdr->SlotSize ||
+       sizeof(SHM_Hdr_t) + (size_t)Ring->Hdr->NumSlots * Ring->Hdr->Stride > Ring->MapLen)
+   {
+      munmap(Ring->Hdr, Ring->MapLen);
+      memset(Ring, 0, sizeof(*Ring));
+      errno = EINVAL;
+      return false;
+   }
+
+   Ring->BusyPoll = BusyPoll;
+   snprintf(Ring->Name, sizeof(Ring->Name), "%s", Name);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  SHM_Detach()
+*/
+void SHM_Detach (SHM_Ring_t *Ring)
+{
+   if (Ring->Hdr != NULL) munmap(Ring->Hdr, Ring->MapLen);
+   if (Ring->Owner) shm_unlink(Ring->Name);
+
+   memset(Ring, 0, sizeof(*Ring));
+}
+
+/******************************************************************************
+**  Function:  SHM_WaitChange()
+**
+**  Waits until *Word differs from Seen. Spins first; in blocking mode it then
+**  raises *Waiting and sleeps on the futex. The store to *Waiting and the
+**  re-check of *Word pair with the fence in SHM_Wake, so either this side
+**  sees the new value or the other side sees the flag.
+*/
+static bool SHM_WaitChange (SHM_Ring_t *Ring, uint32 *Word, uint32 Seen, uint32 *Waiting, uint64 TimeoutNs)
+{
+   uint64 Deadline = SHM_NowNs() + TimeoutNs;
+   uint64 Now;
+   uint32 Spins    = 0;
+   struct timespec Ts;
+   long   Ret;
+
+   for (;;)
+   {
+      if (__atomic_load_n(Word, __ATOMIC_ACQUIRE) != Seen) return true;
+
+      ++Spins;
+      if (Ring->BusyPoll || Spins < SHM_SPIN_BEFORE_WAIT)
+      {
+         CCSDS_CpuRelax();
+         if ((Spins & 255) == 0 && SHM_NowNs() >= Deadline) return false;
+         continue;
+      }
+
+      Now = SHM_NowNs();
+      if (Now >= Deadline) return false;
+
+      __atomic_store_n(Waiting, 1, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (__atomic_load_n(Word, __ATOMIC_ACQUIRE) != Seen)
+      {
+         __atomic_store_n(Waiting, 0, __ATOMIC_RELAXED);
+         return true;
+      }
+
+      Ts.tv_sec  = (time_t)((Deadline - Now) / 1000000000ull);
+      Ts.tv_nsec = (long)((Deadline - Now) % 1000000000ull);
+      Ring->FutexWaits++;
+      Ret = syscall(SYS_futex, Word, FUTEX_WAIT, Seen, &Ts, NULL, 0);
+      __atomic_store_n(Waiting, 0, __ATOMIC_RELAXED);
+      if (Ret < 0 && errno == EINTR) return false;
+   }
+}
+
+/******************************************************************************
+**  Function:  SHM_Wake()
+*/
+static void SHM_Wake (uint32 *Word, uint32 *Waiting)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if (__atomic_load_n(Waiting, __ATOMIC_RELAXED))
+   {
+      __atomic_store_n(Waiting, 0, __ATOMIC_RELAXED);
+      syscall(SYS_futex, Word, FUTEX_WAKE, 1, NULL, NULL, 0);
+   }
+}
+
+/******************************************************************************
+**  Function:  SHM_Reserve()
+*/
+uint8 *SHM_Reserve (SHM_Ring_t *Ring, uint32 *Capacity, uint64 TimeoutNs)
+{
+   SHM_Hdr_t *Hdr  = Ring->Hdr;
+   uint32     Head = Hdr->Head;
+   uint32     Tail = __atomic_load_n(&Hdr->Tail, __ATOMIC_ACQUIRE);
+
+   if (Head - Tail == Hdr->NumSlots &&
+       !SHM_WaitChange(Ring, &Hdr->Tail, Tail, &Hdr->ProdWaiting, TimeoutNs))
+   {
+      return NULL;
+   }
+
+   *Capacity = Hdr->SlotSize;
+   return SHM_SLOT(Ring, Head) + sizeof(SHM_SlotHdr_t);
+}
+
+/******************************************************************************
+**  Function:  SHM_Commit()
+*/
+void SHM_Commit (SHM_Ring_t *Ring, uint32 Length)
+{
+   SHM_Hdr_t *Hdr  = Ring->Hdr;
+   uint32     Head = Hdr->Head;
+
+   ((SHM_SlotHdr_t *)SHM_SLOT(Ring, Head))->Length = Length;
+   __atomic_store_n(&Hdr->Head, Head + 1, __ATOMIC_RELEASE);
+
+   /* Unconditional: the consumer may block even if this side polls */
+   SHM_Wake(&Hdr->Head, &Hdr->ConsWaiting);
+}
+
+/******************************************************************************
+**  Function:  SHM_Peek()
+*/
+uint8 *SHM_Peek (SHM_Ring_t *Ring, uint32 *Length, uint64 TimeoutNs)
+{
+   SHM_Hdr_t *Hdr  = Ring->Hdr;
+   uint32     Tail = Hdr->Tail;
+   uint8     *Slot;
+
+   if (__atomic_load_n(&Hdr->Head, __ATOMIC_ACQUIRE) == Tail &&
+       !SHM_WaitChange(Ring, &Hdr->Head, Tail, &Hdr->ConsWaiting, TimeoutNs))
+   {
+      return NULL;
+   }
+
+   Slot = SHM_SLOT(Ring, Tail);
+   *Length = ((SHM_SlotHdr_t *)Slot)->Length;
+   if (*Length > Hdr->SlotSize) *Length = Hdr->SlotSize;
+
+   return Slot + sizeof(SHM_SlotHdr_t);
+}
+
+/******************************************************************************
+**  Function:  SHM_Release()
+*/
+void SHM_Release (SHM_Ring_t *Ring)
+{
+   SHM_Hdr_t *Hdr = Ring->Hdr;
+
+   __atomic_store_n(&Hdr->Tail, Hdr->Tail + 1, __ATOMIC_RELEASE);
+
+   SHM_Wake(&Hdr->Tail, &Hdr->ProdWaiting);
+}
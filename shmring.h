@@ -0,0 +1,90 @@
+/*
+**  Shared-Memory Packet Ring - Single producer, single consumer
+**
+**  For a ground process and a flight process on the same host. The ring
+**  lives in a POSIX shared memory object (/dev/shm/<name>) that one side
+**  creates and the other attaches to by name. It is a power-of-two array
+**  of fixed-size slots with a free-running head (producer) and tail
+**  (consumer) on separate cache lines.
+**
+**  Packets are built in place: the producer reserves the next slot, writes
+**  the packet into it and commits the length; the consumer peeks at the
+**  slot, decodes it where it lies and releases it. Nothing is copied.
+**
+**  A side that finds the ring empty (or full) either spins (busy-poll, no
+**  wakeup latency, burns a core) or sleeps on a futex on the head (or
+**  tail) word. The futex is shared, not private, so it works across
+**  processes. The other side only makes the wake syscall when the
+**  waiting flag is set.
+*/
+
+#ifndef _shmring_
+#define _shmring_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define SHM_MAGIC          0x43435344534852ull      /* "CCSDSHR" */
+#define SHM_NAME_MAX       64
+#define SHM_SPIN_BEFORE_WAIT  200                   /* Polls before sleeping on the futex */
+
+/*----- Segment header, followed by the slots -----*/
+typedef struct {
+
+   uint64  Magic;
+   uint32  NumSlots;      /* Power of two */
+   uint32  SlotSize;      /* Usable bytes per slot */
+   uint32  Stride;        /* Slot header + SlotSize, cache line multiple */
+   uint32  Spare;
+
+   uint32  Head           __attribute__((aligned(64)));  /* Slots committed, producer writes */
+   uint32  ConsWaiting;
+
+   uint32  Tail           __attribute__((aligned(64)));  /* Slots released, consumer writes */
+   uint32  ProdWaiting;
+
+} __attribute__((aligned(64))) SHM_Hdr_t;
+
+/*----- Slot header, the packet bytes follow -----*/
+typedef struct {
+
+   uint32  Length;
+   uint32  Spare;
+
+} SHM_SlotHdr_t;
+
+/*----- Process-local view of a ring -----*/
+typedef struct {
+
+   SHM_Hdr_t  *Hdr;
+   uint8      *Slots;
+   size_t      MapLen;
+   bool        BusyPoll;
+   bool        Owner;                  /* Created it, unlinks it on detach */
+   uint64      FutexWaits;             /* Sleeps taken by this side */
+   char        Name[SHM_NAME_MAX];
+
+} SHM_Ring_t;
+
+
+/*
+** Exported Functions
+*/
+bool   SHM_Create   (SHM_Ring_t *Ring, const char *Name, uint32 NumSlots, uint32 SlotSize, bool BusyPoll);
+bool   SHM_Attach   (SHM_Ring_t *Ring, const char *Name, bool BusyPoll);
+void   SHM_Detach   (SHM_Ring_t *Ring);
+
+/* Producer: next free slot (Capacity bytes), NULL on timeout or signal */
+uint8 *SHM_Reserve  (SHM_Ring_t *Ring, uint32 *Capacity, uint64 TimeoutNs);
+void   SHM_Commit   (SHM_Ring_t *Ring, uint32 Length);
+
+/* Consumer: oldest committed slot, NULL on timeout or signal (errno EINTR) */
+uint8 *SHM_Peek     (SHM_Ring_t *Ring, uint32 *Length, uint64 TimeoutNs);
+void   SHM_Release  (SHM_Ring_t *Ring);
+
+#endif  /* _shmring_ */
@@ -0,0 +1,173 @@
+/*
+**  APID Steering - Order-preserving placement of packets on workers
+*/
+
+#include <string.h>
+
+#include "steer.h"
+
+/******************************************************************************
+**  Function:  STEER_Init()
+**
+**  Spreads the APIDs with a multiplicative hash, so neighbouring APIDs
+**  (which missions tend to allocate) land on different workers.
+*/
+bool STEER_Init (STEER_Table_t *Table, uint32 NumWorkers)
+{
+   uint32 Apid;
+
+   memset(Table, 0, sizeof(*Table));
+   if (NumWorkers == 0 || NumWorkers > STEER_MAX_WORKERS) return false;
+
+   Table->NumWorkers = NumWorkers;
+   Table->MoveApid   = -1;
+   for (Apid = 0; Apid < STEER_NUM_APIDS; ++Apid)
+   {
+      Table->Owner[Apid] = (uint8)((((Apid + 1) * 0x9E3779B1u) >> 16) % NumWorkers);
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  STEER_Route()
+*/
+int32 STEER_Route (STEER_Table_t *Table, uint16 Apid)
+{
+   Apid &= STEER_NUM_APIDS - 1;
+   if ((int32)Apid == Table->MoveApid) return STEER_HOLD;
+
+   return Table->Owner[Apid];
+}
+
+/******************************************************************************
+**  Function:  STEER_Sent()
+**
+**  Records a packet of Apid as queued to Worker. Only call it once the
+**  packet is really in the worker's queue.
+*/
+void STEER_Sent (STEER_Table_t *Table, uint16 Apid, uint32 Worker)
+{
+   Apid &= STEER_NUM_APIDS - 1;
+
+   Table->LastTicket[Apid] = ++Table->Tickets[Worker];
+   Table->Window[Apid]++;
+}
+
+/******************************************************************************
+**  Function:  STEER_Hold()
+**
+**  Keeps a packet of the APID being moved until STEER_Poll releases it.
+**  False when the hold list is full; the caller drops the packet.
+*/
+bool STEER_Hold (STEER_Table_t *Table, void *Item)
+{
+   if (Table->NumHeld == STEER_HOLD_MAX)
+   {
+      Table->HoldOverflows++;
+      return false;
+   }
+
+   Table->Held[Table->NumHeld++] = Item;
+   return true;
+}
+
+/******************************************************************************
+**  Function:  STEER_Poll()
+**
+**  Completes a pending move once the old owner has finished its last
+**  packet of the APID. Returns the number of held packets, oldest first,
+**  in *Items; the caller must queue all of them to *Worker (and call
+**  STEER_Sent for each) before routing anything else.
+*/
+uint32 STEER_Poll (STEER_Table_t *Table, const uint64 *const *Done, void ***Items, uint32 *Worker)
+{
+   uint32 NumHeld;
+
+   if (Table->MoveApid < 0 ||
+       __atomic_load_n(Done[Table->MoveFrom], __ATOMIC_ACQUIRE) < Table->MoveFence)
+   {
+      return 0;
+   }
+
+   *Worker = Table->Owner[Table->MoveApid];
+   *Items  = Table->Held;
+   NumHeld = Table->NumHeld;
+
+   Table->MoveApid = -1;
+   Table->NumHeld  = 0;
+   Table->Moves++;
+
+   return NumHeld;
+}
+
+/******************************************************************************
+**  Function:  STEER_Move()
+**
+**  Gives Apid to worker To. Immediate if the current owner has nothing of
+**  it outstanding, otherwise pending until STEER_Poll completes it. One
+**  move at a time.
+*/
+bool STEER_Move (STEER_Table_t *Table, uint16 Apid, uint32 To, const uint64 *const *Done)
+{
+   uint32 From;
+
+   Apid &= STEER_NUM_APIDS - 1;
+   From = Table->Owner[Apid];
+   if (Table->MoveApid >= 0 || To >= Table->NumWorkers || To == From) return false;
+
+   Table->Owner[Apid] = (uint8)To;
+   if (__atomic_load_n(Done[From], __ATOMIC_ACQUIRE) >= Table->LastTicket[Apid])
+   {
+      Table->Moves++;
+      return true;
+   }
+
+   Table->MoveApid  = Apid;
+   Table->MoveFrom  = From;
+   Table->MoveFence = Table->LastTicket[Apid];
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  STEER_Plan()
+**
+**  Suggests one move from the traffic seen since the last call: the
+**  busiest APID on the busiest worker that still fits in the gap to the
+**  idlest worker, so the move narrows the spread rather than swapping it.
+**  False if no APID qualifies. Starts a new observation window either way.
+*/
+bool STEER_Plan (STEER_Table_t *Table, uint16 *Apid, uint32 *From, uint32 *To)
+{
+   uint64 Load[STEER_MAX_WORKERS];
+   uint64 Gap, Best = 0;
+   uint32 a, w, Max = 0, Min = 0;
+   bool   Found = false;
+
+   memset(Load, 0, sizeof(Load));
+   for (a = 0; a < STEER_NUM_APIDS; ++a) Load[Table->Owner[a]] += Table->Window[a];
+
+   for (w = 1; w < Table->NumWorkers; ++w)
+   {
+      if (Load[w] > Load[Max]) Max = w;
+      if (Load[w] < Load[Min]) Min = w;
+   }
+
+   Gap = Load[Max] - Load[Min];
+   for (a = 0; a < STEER_NUM_APIDS; ++a)
+   {
+      if (Table->Owner[a] == Max && Table->Window[a] > Best && Table->Window[a] < Gap)
+      {
+         Best  = Table->Window[a];
+         *Apid = (uint16)a;
+         Found = true;
+      }
+   }
+   *From = Max;
+   *To   = Min;
+
+   memset(Table->Window, 0, sizeof(Table->Window));
+
+   return Found;
+}
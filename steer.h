@@ -0,0 +1,76 @@
+/*
+**  APID Steering - Order-preserving placement of packets on workers
+**
+**  Every APID is owned by exactly one worker at a time, so all packets of
+**  an APID are handled by one thread in arrival order, whatever host or
+**  port they came from. The initial owner is a hash of the APID; owners
+**  change only through STEER_Move, normally to take a hot APID off an
+**  overloaded worker (STEER_Plan suggests one).
+**
+**  A move must not let the new owner overtake packets of the APID still
+**  queued at the old one. The table therefore counts packets handed to
+**  each worker (tickets) and remembers the ticket of each APID's latest
+**  packet. Workers publish how many packets they have finished. Until the
+**  old owner has finished the APID's latest ticket, new packets of that
+**  APID are held back here; STEER_Poll then hands them, oldest first, to
+**  the new owner and the move is complete.
+**
+**  The table itself is single-threaded: only the steering thread calls
+**  into it. Workers only write their own Done counter.
+*/
+
+#ifndef _steer_
+#define _steer_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define STEER_NUM_APIDS     2048         /* 11-bit APID */
+#define STEER_MAX_WORKERS   64
+#define STEER_HOLD_MAX      1024         /* Packets held back during one move */
+#define STEER_HOLD          (-1)         /* STEER_Route: hold this packet */
+
+/*----- Steering table -----*/
+typedef struct {
+
+   uint32   NumWorkers;
+   uint8    Owner[STEER_NUM_APIDS];
+   uint64   LastTicket[STEER_NUM_APIDS];      /* Of the latest packet given to the owner */
+   uint64   Window[STEER_NUM_APIDS];          /* Packets since the last STEER_Plan */
+   uint64   Tickets[STEER_MAX_WORKERS];       /* Packets given to each worker */
+
+   /* Move in progress, MoveApid < 0 when none */
+   int32    MoveApid;
+   uint32   MoveFrom;
+   uint64   MoveFence;                        /* Old owner's ticket to wait for */
+   uint32   NumHeld;
+   void    *Held[STEER_HOLD_MAX];
+
+   uint64   Moves;
+   uint64   HoldOverflows;                    /* Packets refused by STEER_Hold */
+
+} STEER_Table_t;
+
+
+/*
+** Exported Functions
+*/
+bool    STEER_Init    (STEER_Table_t *Table, uint32 NumWorkers);
+
+/* Owner of Apid, or STEER_HOLD while a move of Apid is waiting */
+int32   STEER_Route   (STEER_Table_t *Table, uint16 Apid);
+void    STEER_Sent    (STEER_Table_t *Table, uint16 Apid, uint32 Worker);
+bool    STEER_Hold    (STEER_Table_t *Table, void *Item);
+
+/* *Done[w]: packets worker w has finished. Returns the held packets for *Worker once a move completes */
+uint32  STEER_Poll    (STEER_Table_t *Table, const uint64 *const *Done, void ***Items, uint32 *Worker);
+
+bool    STEER_Move    (STEER_Table_t *Table, uint16 Apid, uint32 To, const uint64 *const *Done);
+bool    STEER_Plan    (STEER_Table_t *Table, uint16 *Apid, uint32 *From, uint32 *To);
+
+#endif  /* _steer_ */
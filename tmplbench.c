@@ -0,0 +1,134 @@
+/*
+** File: tmplbench.c
+** Role: BENCHMARK (command templates)
+** Description: Builds a 1 KiB command with CCSDS_InitCmdTemplate and applies
+**              a series of random patches to it, each a new sequence count
+**              (CCSDS_SetTemplateSeq) and a few random payload bytes at a
+**              random offset (CCSDS_PatchTemplate). After every patch the
+**              template must equal, byte for byte, a fresh
+**              CCSDS_BuildTelecommand of the same sequence count and
+**              payload. Patches past the payload and templates that were
+**              never built must be refused. Any mismatch exits non-zero.
+**              Then patching is timed against rebuilding the packet.
+**
+** Usage:       tmplbench [-n patches] [-r rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ccsds.h"
+#include "latency.h"
+
+#define BENCH_APID     0x1A5
+#define BENCH_FC       0x0B
+#define TMPL_SIZE      1024
+#define TMPL_PAYLOAD   (TMPL_SIZE - sizeof(CCSDS_CommandPacket_t))
+#define MAX_PATCH      32
+
+struct patch {
+    uint16 seq;
+    uint16 offset;
+    uint16 len;
+    uint8  data[MAX_PATCH];
+};
+
+static void fail(const char *what, uint32 i) {
+    fprintf(stderr, "[TMPL] %s at patch %u\n", what, i);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    long count = 4096, rounds = 200;
+    volatile uint32 sink = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': count = atol(optarg); break;
+            case 'r': rounds = atol(optarg); break;
+            default:  count = 0; break;
+        }
+    }
+    if (count < 1 || rounds < 1) {
+        fprintf(stderr, "Usage: %s [-n patches] [-r rounds]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    static uint8 tmpl_buf[TMPL_SIZE], fresh[TMPL_SIZE], payload[TMPL_PAYLOAD];
+    CCSDS_CmdTemplate_t tmpl;
+
+    srand(1);
+    for (size_t i = 0; i < TMPL_PAYLOAD; i++) payload[i] = (uint8)rand();
+
+    // Guards first: never built, failed build, out of range patches
+    memset(&tmpl, 0, sizeof(tmpl));
+    if (CCSDS_SetTemplateSeq(NULL, 1)) fail("NULL template accepted by SetTemplateSeq", 0);
+    if (CCSDS_SetTemplateSeq(&tmpl, 1)) fail("Unbuilt template accepted by SetTemplateSeq", 0);
+    if (CCSDS_PatchTemplate(&tmpl, 0, payload, 1)) fail("Unbuilt template accepted by PatchTemplate", 0);
+    if (CCSDS_InitCmdTemplate(&tmpl, tmpl_buf, TMPL_SIZE - 1, BENCH_APID, BENCH_FC, payload, TMPL_PAYLOAD) != 0 ||
+        CCSDS_SetTemplateSeq(&tmpl, 1)) {
+        fail("Template that did not fit accepted", 0);
+    }
+
+    if (CCSDS_InitCmdTemplate(&tmpl, tmpl_buf, TMPL_SIZE, BENCH_APID, BENCH_FC, payload, TMPL_PAYLOAD) != TMPL_SIZE) {
+        fail("Template build", 0);
+    }
+    if (CCSDS_PatchTemplate(&tmpl, TMPL_PAYLOAD - 1, payload, 2)) fail("Patch past the payload accepted", 0);
+
+    struct patch *patches = malloc((size_t)count * sizeof(*patches));
+    for (long i = 0; i < count; i++) {
+        struct patch *p = &patches[i];
+        p->seq = (uint16)(rand() & 0x3FFF);
+        p->len = (uint16)(1 + rand() % MAX_PATCH);
+        p->offset = (uint16)(rand() % (TMPL_PAYLOAD - p->len + 1));
+        for (uint16 k = 0; k < p->len; k++) p->data[k] = (uint8)rand();
+    }
+
+    for (uint32 i = 0; i < (uint32)count; i++) {
+        const struct patch *p = &patches[i];
+
+        if (!CCSDS_SetTemplateSeq(&tmpl, p->seq)) fail("SetTemplateSeq refused", i);
+        if (!CCSDS_PatchTemplate(&tmpl, p->offset, p->data, p->len)) fail("PatchTemplate refused", i);
+        memcpy(payload + p->offset, p->data, p->len);
+
+        memset(fresh, 0x5A, sizeof(fresh));
+        if (CCSDS_BuildTelecommand(fresh, TMPL_SIZE, BENCH_APID, p->seq, BENCH_FC, payload, TMPL_PAYLOAD) != TMPL_SIZE) {
+            fail("Rebuild", i);
+        }
+        if (memcmp(tmpl_buf, fresh, TMPL_SIZE) != 0) fail("Template differs from a fresh build", i);
+    }
+
+    uint64 start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (long i = 0; i < count; i++) {
+            const struct patch *p = &patches[i];
+            CCSDS_SetTemplateSeq(&tmpl, p->seq);
+            CCSDS_PatchTemplate(&tmpl, p->offset, p->data, p->len);
+            sink = sink + tmpl_buf[7];
+        }
+    }
+    uint64 ns_patch = LAT_NowNs() - start;
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (long i = 0; i < count; i++) {
+            const struct patch *p = &patches[i];
+            memcpy(payload + p->offset, p->data, p->len);
+            CCSDS_BuildTelecommand(fresh, TMPL_SIZE, BENCH_APID, p->seq, BENCH_FC, payload, TMPL_PAYLOAD);
+            sink = sink + fresh[7];
+        }
+    }
+    uint64 ns_build = LAT_NowNs() - start;
+
+    double n = (double)count * rounds;
+    printf("[TMPL] %ld patches x %ld rounds on a %d byte command, template equals a fresh build after each\n",
+           count, rounds, TMPL_SIZE);
+    printf("[TMPL] patch  %7.2f ns/packet   rebuild  %7.2f ns/packet  (1-%d byte patches)\n",
+           ns_patch / n, ns_build / n, MAX_PATCH);
+
+    free(patches);
+    return sink == 0xFFFFFFFFu;
+}
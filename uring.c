@@ -0,0 +1,259 @@
+/*
+**  io_uring Access - Raw system calls, no liburing
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+/******************************************************************************
+**  Function:  URING_Init()
+**
+**  Flags are IORING_SETUP_* flags. The CQ gets the kernel default of
+**  twice the SQ entries.
+*/
+bool URING_Init (URING_Ring_t *Ring, uint32 Entries, uint32 Flags)
+{
+   struct io_uring_params P;
+   uint8 *Sq, *Cq;
+
+   memset(Ring, 0, sizeof(*Ring));
+   memset(&P, 0, sizeof(P));
+   P.flags = Flags;
+
+   Ring->Fd = (int)syscall(__NR_io_uring_setup, Entries, &P);
+   if (Ring->Fd < 0) return false;
+   Ring->Features = P.features;
+
+   Ring->SqMapLen = P.sq_off.array + P.sq_entries * sizeof(uint32);
+   Ring->CqMapLen = P.cq_off.cqes + P.cq_entries * sizeof(struct io_uring_cqe);
+   if (P.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (Ring->CqMapLen > Ring->SqMapLen) Ring->SqMapLen = Ring->CqMapLen;
+      Ring->CqMapLen = Ring->SqMapLen;
+   }
+
+   Ring->SqMap = mmap(NULL, Ring->SqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      Ring->Fd, IORING_OFF_SQ_RING);
+   if (Ring->SqMap == MAP_FAILED) { Ring->SqMap = NULL; URING_Close(Ring); return false; }
+
+   if (P.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      Ring->CqMap = Ring->SqMap;
+   }
+   else
+   {
+      Ring->CqMap = mmap(NULL, Ring->CqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         Ring->Fd, IORING_OFF_CQ_RING);
+      if (Ring->CqMap == MAP_FAILED) { Ring->CqMap = NULL; URING_Close(Ring); return false; }
+   }
+
+   Ring->SqesLen = P.sq_entries * sizeof(struct io_uring_sqe);
+   Ring->Sqes = mmap(NULL, Ring->SqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     Ring->Fd, IORING_OFF_SQES);
+   if (Ring->Sqes == MAP_FAILED) { Ring->Sqes = NULL; URING_Close(Ring); return false; }
+
+   Sq = (uint8 *)Ring->SqMap;
+   Cq = (uint8 *)Ring->CqMap;
+
+   Ring->SqHead    = (uint32 *)(Sq + P.sq_off.head);
+   Ring->SqTail    = (uint32 *)(Sq + P.sq_off.tail);
+   Ring->SqMask    = *(uint32 *)(Sq + P.sq_off.ring_mask);
+   Ring->SqEntries = P.sq_entries;
+   Ring->SqArray   = (uint32 *)(Sq + P.sq_off.array);
+   Ring->SqLocalTail = *Ring->SqTail;
+
+   Ring->CqHead = (uint32 *)(Cq + P.cq_off.head);
+   Ring->CqTail = (uint32 *)(Cq + P.cq_off.tail);
+   Ring->CqMask = *(uint32 *)(Cq + P.cq_off.ring_mask);
+   Ring->Cqes   = (struct io_uring_cqe *)(Cq + P.cq_off.cqes);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  URING_Close()
+*/
+void URING_Close (URING_Ring_t *Ring)
+{
+   if (Ring->Sqes != NULL) munmap(Ring->Sqes, Ring->SqesLen);
+   if (Ring->CqMap != NULL && Ring->CqMap != Ring->SqMap) munmap(Ring->CqMap, Ring->CqMapLen);
+   if (Ring->SqMap != NULL) munmap(Ring->SqMap, Ring->SqMapLen);
+   if (Ring->Fd >= 0) close(Ring->Fd);
+
+   memset(Ring, 0, sizeof(*Ring));
+   Ring->Fd = -1;
+}
+
+/******************************************************************************
+**  Function:  URING_GetSqe()
+*/
+struct io_uring_sqe *URING_GetSqe (URING_Ring_t *Ring)
+{
+   uint32 Head = __atomic_load_n(Ring->SqHead, __ATOMIC_ACQUIRE);
+   struct io_uring_sqe *Sqe;
+
+   if (Ring->SqLocalTail - Head >= Ring->SqEntries) return NULL;
+
+   Sqe = &Ring->Sqes[Ring->SqLocalTail & Ring->SqMask];
+   Ring->SqArray[Ring->SqLocalTail & Ring->SqMask] = Ring->SqLocalTail & Ring->SqMask;
+   Ring->SqLocalTail++;
+
+   memset(Sqe, 0, sizeof(*Sqe));
+   return Sqe;
+}
+
+/******************************************************************************
+**  Function:  URING_Submit()
+*/
+int URING_Submit (URING_Ring_t *Ring, uint32 WaitNr)
+{
+   uint32 ToSubmit = Ring->SqLocalTail - *Ring->SqTail;
+   long   Ret;
+
+   if (ToSubmit > 0) __atomic_store_n(Ring->SqTail, Ring->SqLocalTail, __ATOMIC_RELEASE);
+   if (ToSubmit == 0 && WaitNr == 0) return 0;
+
+   Ret = syscall(__NR_io_uring_enter, Ring->Fd, ToSubmit, WaitNr,
+                 WaitNr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+   return (int)Ret;
+}
+
+/******************************************************************************
+**  Function:  URING_CqReady()
+*/
+uint32 URING_CqReady (const URING_Ring_t *Ring)
+{
+   return __atomic_load_n(Ring->CqTail, __ATOMIC_ACQUIRE) - *Ring->CqHead;
+}
+
+/******************************************************************************
+**  Function:  URING_Cqe()
+*/
+struct io_uring_cqe *URING_Cqe (const URING_Ring_t *Ring, uint32 Index)
+{
+   return &Ring->Cqes[(*Ring->CqHead + Index) & Ring->CqMask];
+}
+
+/******************************************************************************
+**  Function:  URING_CqAdvance()
+**
+**  Retires Count completions; their CQ slots may be reused by the kernel.
+*/
+void URING_CqAdvance (URING_Ring_t *Ring, uint32 Count)
+{
+   if (Count > 0) __atomic_store_n(Ring->CqHead, *Ring->CqHead + Count, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+**  Function:  URING_SetupBufRing()
+**
+**  Count (a power of two, at most 32768) slots of BufSize bytes in one
+**  anonymous mapping, all handed to the kernel as buffer group Bgid.
+*/
+bool URING_SetupBufRing (URING_Ring_t *Ring, URING_BufRing_t *Bufs, uint16 Bgid, uint32 Count, uint32 BufSize)
+{
+   struct io_uring_buf_reg Reg;
+   uint32 i;
+
+   memset(Bufs, 0, sizeof(*Bufs));
+   if (Count == 0 || Count > 32768 || (Count & (Count - 1)) != 0) { errno = EINVAL; return false; }
+
+   Bufs->BrLen = Count * sizeof(struct io_uring_buf);
+   Bufs->Br = mmap(NULL, Bufs->BrLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (Bufs->Br == MAP_FAILED) { Bufs->Br = NULL; return false; }
+
+   Bufs->Base = mmap(NULL, (size_t)Count * BufSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+   if (Bufs->Base == MAP_FAILED)
+   {
+      Bufs->Base = NULL;
+      munmap(Bufs->Br, Bufs->BrLen);
+      Bufs->Br = NULL;
+      return false;
+   }
+
+   Bufs->BufSize = BufSize;
+   Bufs->Count   = Count;
+   Bufs->Bgid    = Bgid;
+
+   memset(&Reg, 0, sizeof(Reg));
+   Reg.ring_addr    = (uint64)(uintptr_t)Bufs->Br;
+   Reg.ring_entries = Count;
+   Reg.bgid         = Bgid;
+   if (syscall(__NR_io_uring_register, Ring->Fd, IORING_REGISTER_PBUF_RING, &Reg, 1) < 0)
+   {
+      munmap(Bufs->Base, (size_t)Count * BufSize);
+      munmap(Bufs->Br, Bufs->BrLen);
+      memset(Bufs, 0, sizeof(*Bufs));
+      return false;
+   }
+
+   for (i = 0; i < Count; ++i) URING_RecycleBuf(Bufs, (uint16)i);
+   URING_PublishBufs(Bufs);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  URING_FreeBufRing()
+*/
+void URING_FreeBufRing (URING_Ring_t *Ring, URING_BufRing_t *Bufs)
+{
+   struct io_uring_buf_reg Reg;
+
+   if (Bufs->Br == NULL) return;
+
+   memset(&Reg, 0, sizeof(Reg));
+   Reg.bgid = Bufs->Bgid;
+   syscall(__NR_io_uring_register, Ring->Fd, IORING_UNREGISTER_PBUF_RING, &Reg, 1);
+
+   munmap(Bufs->Base, (size_t)Bufs->Count * Bufs->BufSize);
+   munmap(Bufs->Br, Bufs->BrLen);
+   memset(Bufs, 0, sizeof(*Bufs));
+}
+
+/******************************************************************************
+**  Function:  URING_BufAddr()
+*/
+uint8 *URING_BufAddr (const URING_BufRing_t *Bufs, uint16 Bid)
+{
+   return Bufs->Base + (size_t)Bid * Bufs->BufSize;
+}
+
+/******************************************************************************
+**  Function:  URING_RecycleBuf()
+**
+**  Queues slot Bid for the kernel. It becomes visible with URING_PublishBufs.
+*/
+void URING_RecycleBuf (URING_BufRing_t *Bufs, uint16 Bid)
+{
+   struct io_uring_buf *Buf = &Bufs->Br->bufs[Bufs->Tail & (Bufs->Count - 1)];
+
+   Buf->addr = (uint64)(uintptr_t)URING_BufAddr(Bufs, Bid);
+   Buf->len  = Bufs->BufSize;
+   Buf->bid  = Bid;
+   Bufs->Tail++;
+}
+
+/******************************************************************************
+**  Function:  URING_PublishBufs()
+*/
+void URING_PublishBufs (URING_BufRing_t *Bufs)
+{
+   __atomic_store_n(&Bufs->Br->tail, Bufs->Tail, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+**  Function:  URING_RegisterBuffers()
+*/
+bool URING_RegisterBuffers (URING_Ring_t *Ring, const struct iovec *Iov, uint32 Count)
+{
+   return syscall(__NR_io_uring_register, Ring->Fd, IORING_REGISTER_BUFFERS, Iov, Count) == 0;
+}
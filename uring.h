@@ -0,0 +1,97 @@
+/*
+**  io_uring Access - Raw system calls, no liburing
+**
+**  A ring is set up with io_uring_setup and its submission and completion
+**  queues are mapped into the process. Submissions are written straight
+**  into the mapped SQE array, and completions are read out of the mapped
+**  CQ and retired in batches by moving the CQ head. A single thread owns a
+**  ring.
+**
+**  Provided buffer rings (kernel 5.19+) hand the kernel a pool of equal
+**  slots. Multishot receives pick a slot per datagram, and the application
+**  recycles the slot after use. Registered buffers (IORING_REGISTER_BUFFERS)
+**  are pinned once so fixed and zero-copy sends skip the per-call page
+**  lookup.
+*/
+
+#ifndef _uring_
+#define _uring_
+
+/*
+** Includes
+*/
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "ccsds.h"
+
+/*----- Ring -----*/
+typedef struct {
+
+   int                   Fd;
+   uint32                Features;
+
+   /* Submission queue */
+   uint32               *SqHead;
+   uint32               *SqTail;
+   uint32                SqMask;
+   uint32                SqEntries;
+   uint32               *SqArray;
+   struct io_uring_sqe  *Sqes;
+   uint32                SqLocalTail;    /* SQEs handed out, not yet published */
+
+   /* Completion queue */
+   uint32               *CqHead;
+   uint32               *CqTail;
+   uint32                CqMask;
+   struct io_uring_cqe  *Cqes;
+
+   void                 *SqMap;
+   size_t                SqMapLen;
+   void                 *CqMap;          /* Same as SqMap with IORING_FEAT_SINGLE_MMAP */
+   size_t                CqMapLen;
+   size_t                SqesLen;
+
+} URING_Ring_t;
+
+/*----- Provided buffer ring -----*/
+typedef struct {
+
+   struct io_uring_buf_ring *Br;
+   size_t                    BrLen;
+   uint8                    *Base;       /* Count slots of BufSize bytes */
+   uint32                    BufSize;
+   uint32                    Count;      /* Power of two */
+   uint16                    Bgid;
+   uint16                    Tail;       /* Local tail, published by URING_PublishBufs */
+
+} URING_BufRing_t;
+
+
+/*
+** Exported Functions
+*/
+bool   URING_Init           (URING_Ring_t *Ring, uint32 Entries, uint32 Flags);
+void   URING_Close          (URING_Ring_t *Ring);
+
+/* NULL when the SQ is full; fill the SQE in, it goes out on the next submit */
+struct io_uring_sqe *URING_GetSqe (URING_Ring_t *Ring);
+
+/* Publishes pending SQEs and waits for at least WaitNr completions.
+** Returns SQEs consumed or -1 with errno set (EINTR on a signal). */
+int    URING_Submit         (URING_Ring_t *Ring, uint32 WaitNr);
+
+/* Completions ready to read at URING_Cqe(Ring, 0 .. n-1) */
+uint32 URING_CqReady        (const URING_Ring_t *Ring);
+struct io_uring_cqe *URING_Cqe (const URING_Ring_t *Ring, uint32 Index);
+void   URING_CqAdvance      (URING_Ring_t *Ring, uint32 Count);
+
+bool   URING_SetupBufRing   (URING_Ring_t *Ring, URING_BufRing_t *Bufs, uint16 Bgid, uint32 Count, uint32 BufSize);
+void   URING_FreeBufRing    (URING_Ring_t *Ring, URING_BufRing_t *Bufs);
+uint8 *URING_BufAddr        (const URING_BufRing_t *Bufs, uint16 Bid);
+void   URING_RecycleBuf     (URING_BufRing_t *Bufs, uint16 Bid);
+void   URING_PublishBufs    (URING_BufRing_t *Bufs);
+
+bool   URING_RegisterBuffers (URING_Ring_t *Ring, const struct iovec *Iov, uint32 Count);
+
+#endif  /* _uring_ */
@@ -0,0 +1,275 @@
+/*
+**  USLP Transfer Frame Implementation (CCSDS 732.1-B)
+*/
+
+#include <string.h>
+
+#include "uslp.h"
+
+/* CRC-16-CCITT (poly 0x1021, init 0xFFFF) lookup, constant so any thread may use it */
+static const uint16 USLP_CrcTable[256] = {
+   0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+   0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+   0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+   0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+   0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+   0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+   0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+   0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+   0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+   0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+   0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+   0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+   0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+   0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+   0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+   0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+   0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+   0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+   0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+   0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+   0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+   0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+   0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+   0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+   0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+   0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+   0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+   0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+   0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+   0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+   0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+   0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+/******************************************************************************
+**  Function:  USLP_Crc16()
+*/
+uint16 USLP_Crc16 (const uint8 *Data, uint32 Len)
+{
+   uint16 Crc = 0xFFFF;
+
+   while (Len--)  Crc = (uint16)((Crc << 8) ^ USLP_CrcTable[(Crc >> 8) ^ *(Data++)]);
+
+   return Crc;
+}
+
+/******************************************************************************
+**  Function:  USLP_InitEngine()
+*/
+void USLP_InitEngine (USLP_Engine_t *Eng, uint16 Scid, bool FecfEnabled)
+{
+   uint8 Vc;
+
+   memset(Eng, 0, sizeof(*Eng));
+   Eng->Scid        = Scid;
+   Eng->FecfEnabled = FecfEnabled;
+
+   /* Default to a 4 octet VC Frame Count on every VC */
+   for (Vc = 0; Vc < USLP_MAX_VC; ++Vc) Eng->VcCountLen[Vc] = 4;
+}
+
+/******************************************************************************
+**  Function:  USLP_SetVcCountLen()
+*/
+void USLP_SetVcCountLen (USLP_Engine_t *Eng, uint8 Vcid, uint8 CountLen)
+{
+   if (Vcid >= USLP_MAX_VC || CountLen > USLP_MAX_VCF_LEN) return;
+
+   Eng->VcCountLen[Vcid]   = CountLen;
+   Eng->VcTxCount[Vcid]    = 0;
+   Eng->VcRxSynced        &= ~((uint64)1 << Vcid);
+}
+
+/******************************************************************************
+**  Function:  USLP_HeaderSize()
+**
+**  Octets of Primary Header plus TFDF Header for frames on this VC.
+*/
+uint16 USLP_HeaderSize (const USLP_Engine_t *Eng, uint8 Vcid)
+{
+   return (uint16)(USLP_PRI_HDR_MIN_SIZE + Eng->VcCountLen[Vcid & 0x3F] + USLP_TFDF_HDR_SIZE);
+}
+
+/******************************************************************************
+**  Function:  USLP_BuildFrame()
+**
+**  Packs as many of the given Space Packets as fit into one variable-length
+**  frame (construction rule '111'). Returns the frame length, 0 on error.
+*/
+uint16 USLP_BuildFrame (USLP_Engine_t *Eng,
+                        uint8         *FrameBuf,
+                        uint16         FrameBufSize,
+                        uint8          Vcid,
+                        uint8          MapId,
+                        const uint8  *const *Pkts,
+                        uint16         NumPkts,
+                        uint16        *PktsUsed)
+{
+   uint8   CountLen;
+   uint16  HeaderSize;
+   uint16  TrailerSize;
+   uint32  FrameLen;
+   uint32  PktLen;      /* Length field + 7 exceeds 16 bits */
+   uint16  Used = 0;
+   uint64  Count;
+   uint8  *DataPtr;
+   int     i;
+
+   if (PktsUsed != NULL) *PktsUsed = 0;
+   if (FrameBuf == NULL || Pkts == NULL || Vcid >= USLP_MAX_VC || MapId >= USLP_MAX_MAP) return 0;
+
+   CountLen    = Eng->VcCountLen[Vcid];
+   HeaderSize  = USLP_HeaderSize(Eng, Vcid);
+   TrailerSize = Eng->FecfEnabled ? USLP_FECF_SIZE : 0;
+   FrameLen    = HeaderSize;
+   DataPtr     = FrameBuf + HeaderSize;
+
+   /* Copy whole packets while they fit */
+   while (Used < NumPkts)
+   {
+      PktLen = CCSDS_RD_LEN(*(const CCSDS_PriHdr_t *)Pkts[Used]);
+      if (FrameLen + PktLen + TrailerSize > FrameBufSize) break;
+
+      memcpy(DataPtr, Pkts[Used], PktLen);
+      DataPtr  += PktLen;
+      FrameLen += PktLen;
+      ++Used;
+   }
+
+   if (Used == 0) return 0;
+   FrameLen += TrailerSize;
+
+   /* Primary Header */
+   FrameBuf[0] = (uint8)((USLP_TFVN << 4) | ((Eng->Scid >> 12) & 0x0F));
+   FrameBuf[1] = (uint8)(Eng->Scid >> 4);
+   FrameBuf[2] = (uint8)(((Eng->Scid & 0x0F) << 4) | ((Vcid >> 3) & 0x07));
+   FrameBuf[3] = (uint8)(((Vcid & 0x07) << 5) | ((MapId & 0x0F) << 1));
+   FrameBuf[4] = (uint8)((FrameLen - 1) >> 8);
+   FrameBuf[5] = (uint8)((FrameLen - 1) & 0xff);
+   FrameBuf[6] = CountLen;
+
+   Count = Eng->VcTxCount[Vcid];
+   for (i = CountLen - 1; i >= 0; --i)
+   {
+      FrameBuf[USLP_PRI_HDR_MIN_SIZE + i] = (uint8)(Count & 0xff);
+      Count >>= 8;
+   }
+
+   /* TFDF Header */
+   FrameBuf[HeaderSize - 1] = (uint8)((USLP_RULE_NO_SEG << 5) | USLP_UPID_SPACE_PKT);
+
+   /* Frame Error Control Field */
+   if (Eng->FecfEnabled)
+   {
+      uint16 Crc = USLP_Crc16(FrameBuf, FrameLen - USLP_FECF_SIZE);
+      FrameBuf[FrameLen - 2] = (uint8)(Crc >> 8);
+      FrameBuf[FrameLen - 1] = (uint8)(Crc & 0xff);
+   }
+
+   /* Count wraps at the configured field width */
+   Eng->VcTxCount[Vcid] = (CountLen == 0) ? 0 :
+                          (Eng->VcTxCount[Vcid] + 1) & (~(uint64)0 >> (64 - 8 * CountLen));
+   Eng->MapTxPkts[USLP_MAP_IDX(Vcid, MapId)] += Used;
+
+   if (PktsUsed != NULL) *PktsUsed = Used;
+   return (uint16)FrameLen;
+}
+
+/******************************************************************************
+**  Function:  USLP_ParseFrame()
+**
+**  Validates the frame and fills Info with pointers into Frame. VC frame
+**  count gaps are accumulated per VC.
+*/
+bool USLP_ParseFrame (USLP_Engine_t *Eng,
+                      const uint8   *Frame,
+                      uint16         FrameLen,
+                      USLP_Frame_t  *Info)
+{
+   uint8   CountLen;
+   uint16  HeaderSize;
+   uint16  TrailerSize;
+   uint64  Count = 0;
+   uint64  Mask;
+   uint64  VcBit;
+   int     i;
+
+   if (Frame == NULL || FrameLen < USLP_PRI_HDR_MIN_SIZE + USLP_TFDF_HDR_SIZE) return false;
+
+   /* Version, truncated-frame flag and length must agree */
+   if ((Frame[0] >> 4) != USLP_TFVN)                         return false;
+   if (Frame[3] & 0x01)                                      return false;
+   if ((uint16)(((Frame[4] << 8) | Frame[5]) + 1) != FrameLen) return false;
+
+   CountLen    = Frame[6] & 0x07;
+   HeaderSize  = (uint16)(USLP_PRI_HDR_MIN_SIZE + CountLen + USLP_TFDF_HDR_SIZE);
+   TrailerSize = (uint16)((Eng->FecfEnabled ? USLP_FECF_SIZE : 0) + ((Frame[6] & 0x08) ? USLP_OCF_SIZE : 0));
+
+   if (FrameLen < HeaderSize + TrailerSize) return false;
+
+   if (Eng->FecfEnabled)
+   {
+      uint16 Crc = (uint16)((Frame[FrameLen - 2] << 8) | Frame[FrameLen - 1]);
+      if (USLP_Crc16(Frame, FrameLen - USLP_FECF_SIZE) != Crc) return false;
+   }
+
+   for (i = 0; i < CountLen; ++i) Count = (Count << 8) | Frame[USLP_PRI_HDR_MIN_SIZE + i];
+
+   Info->Scid     = (uint16)((Frame[0] << 12) | (Frame[1] << 4) | (Frame[2] >> 4));
+   Info->Vcid     = (uint8)(((Frame[2] & 0x07) << 3) | (Frame[3] >> 5));
+   Info->MapId    = (uint8)((Frame[3] >> 1) & 0x0F);
+   Info->Rule     = (uint8)(Frame[HeaderSize - 1] >> 5);
+   Info->Upid     = (uint8)(Frame[HeaderSize - 1] & 0x1F);
+   Info->FrameLen = FrameLen;
+   Info->VcCount  = Count;
+   Info->Data     = Frame + HeaderSize;
+   Info->DataLen  = (uint16)(FrameLen - HeaderSize - TrailerSize);
+   Info->Cursor   = 0;
+
+   if (Info->Scid != Eng->Scid) return false;
+
+   /* VC sequence accounting */
+   VcBit = (uint64)1 << Info->Vcid;
+   if (CountLen > 0)
+   {
+      Mask = ~(uint64)0 >> (64 - 8 * CountLen);
+      if ((Eng->VcRxSynced & VcBit) && Count != Eng->VcRxExpected[Info->Vcid])
+      {
+         Eng->VcRxGaps[Info->Vcid] += (uint32)((Count - Eng->VcRxExpected[Info->Vcid]) & Mask);
+      }
+      Eng->VcRxExpected[Info->Vcid] = (Count + 1) & Mask;
+   }
+   Eng->VcRxSynced |= VcBit;
+   Eng->VcRxFrames[Info->Vcid]++;
+   Eng->MapRxFrames[USLP_MAP_IDX(Info->Vcid, Info->MapId)]++;
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  USLP_NextPacket()
+**
+**  Walks the Space Packets in a rule '111' TFDZ using their own length
+**  field. Returns NULL when the zone is exhausted or malformed.
+*/
+const uint8 *USLP_NextPacket (USLP_Frame_t *Info, uint16 *PktLen)
+{
+   const uint8 *PktPtr;
+   uint16       Remain;
+   uint32       Len;      /* Length field + 7 exceeds 16 bits */
+
+   if (Info->Rule != USLP_RULE_NO_SEG || Info->Upid != USLP_UPID_SPACE_PKT) return NULL;
+
+   Remain = (uint16)(Info->DataLen - Info->Cursor);
+   if (Remain < sizeof(CCSDS_PriHdr_t)) return NULL;
+
+   PktPtr = Info->Data + Info->Cursor;
+   Len    = CCSDS_RD_LEN(*(const CCSDS_PriHdr_t *)PktPtr);
+   if (Len > Remain) return NULL;
+
+   Info->Cursor = (uint16)(Info->Cursor + Len);
+   if (PktLen != NULL) *PktLen = (uint16)Len;
+
+   return PktPtr;
+}
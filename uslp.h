@@ -0,0 +1,117 @@
+/*
+**  USLP Transfer Frame Definitions (CCSDS 732.1-B)
+**  Variable-length Unified Space Data Link Protocol frames carrying
+**  CCSDS Space Packets. Byte layout is built by hand so the code is
+**  endian independent, same as ccsds.h.
+*/
+
+#ifndef _uslp_
+#define _uslp_
+
+/*
+** Includes
+*/
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define USLP_MAX_VC           64    /* VCID is 6 bits  */
+#define USLP_MAX_MAP          16    /* MAP ID is 4 bits */
+#define USLP_MAX_VCF_LEN       7    /* VC Frame Count up to 7 octets (56 bits) */
+
+/*
+** -------------------------------------------------------------------------
+** FRAME LAYOUT
+**
+** Transfer Frame Primary Header (7..14 Bytes)
+**   Byte 0:    TFVN(4)|SCID_Hi(4)
+**   Byte 1:    SCID_Mid(8)
+**   Byte 2:    SCID_Lo(4)|SrcDst(1)|VCID_Hi(3)
+**   Byte 3:    VCID_Lo(3)|MAPID(4)|EndOfHdr(1)
+**   Byte 4-5:  Frame Length (total octets - 1)
+**   Byte 6:    Bypass(1)|PCC(1)|Spare(2)|OCF(1)|VCF_Count_Len(3)
+**   Byte 7-n:  VC Frame Count (0..7 octets, Big Endian)
+**
+** Transfer Frame Data Field Header (1 Byte for construction rule 111)
+**   Byte 0:    ConstrRule(3)|UPID(5)
+**
+** Optional trailer: OCF (4 Bytes), FECF (2 Bytes, CRC-16-CCITT)
+** -------------------------------------------------------------------------
+*/
+#define USLP_TFVN              0x0C
+#define USLP_PRI_HDR_MIN_SIZE  7
+#define USLP_TFDF_HDR_SIZE     1
+#define USLP_OCF_SIZE          4
+#define USLP_FECF_SIZE         2
+
+#define USLP_RULE_NO_SEG       7    /* '111' Packets wholly contained, variable TFDZ */
+#define USLP_UPID_SPACE_PKT    0    /* Space Packets / Encapsulation Packets */
+
+/*
+** -------------------------------------------------------------------------
+** ENGINE STATE
+** All per-VC and per-MAP state lives in flat arrays. MAP state is indexed
+** as [Vcid * USLP_MAX_MAP + MapId] so a frame touches one contiguous slot.
+** -------------------------------------------------------------------------
+*/
+#define USLP_MAP_IDX(vc,map)   (((vc) * USLP_MAX_MAP) + (map))
+
+typedef struct {
+
+   uint16  Scid;
+   bool    FecfEnabled;
+
+   /* Per Virtual Channel */
+   uint8   VcCountLen[USLP_MAX_VC];     /* VC Frame Count length in octets */
+   uint64  VcTxCount[USLP_MAX_VC];      /* Next count to send */
+   uint64  VcRxExpected[USLP_MAX_VC];   /* Next count expected */
+   uint32  VcRxFrames[USLP_MAX_VC];
+   uint32  VcRxGaps[USLP_MAX_VC];       /* Frames missing according to VC count */
+   uint64  VcRxSynced;                  /* Bit per VC: first frame seen */
+
+   /* Per MAP Channel */
+   uint32  MapTxPkts[USLP_MAX_VC * USLP_MAX_MAP];
+   uint32  MapRxFrames[USLP_MAX_VC * USLP_MAX_MAP];
+
+} USLP_Engine_t;
+
+/*----- Parsed frame (points into the receive buffer) -----*/
+typedef struct {
+
+   uint16        Scid;
+   uint8         Vcid;
+   uint8         MapId;
+   uint8         Rule;
+   uint8         Upid;
+   uint16        FrameLen;
+   uint64        VcCount;
+   const uint8  *Data;      /* Start of TFDZ */
+   uint16        DataLen;   /* Octets of TFDZ */
+   uint16        Cursor;    /* Packet iterator offset into TFDZ */
+
+} USLP_Frame_t;
+
+
+/*
+** Exported Functions
+*/
+void   USLP_InitEngine   (USLP_Engine_t *Eng, uint16 Scid, bool FecfEnabled);
+void   USLP_SetVcCountLen(USLP_Engine_t *Eng, uint8 Vcid, uint8 CountLen);
+uint16 USLP_HeaderSize   (const USLP_Engine_t *Eng, uint8 Vcid);
+uint16 USLP_BuildFrame   (USLP_Engine_t *Eng,
+                          uint8         *FrameBuf,
+                          uint16         FrameBufSize,
+                          uint8          Vcid,
+                          uint8          MapId,
+                          const uint8  *const *Pkts,
+                          uint16         NumPkts,
+                          uint16        *PktsUsed);
+bool   USLP_ParseFrame   (USLP_Engine_t *Eng,
+                          const uint8   *Frame,
+                          uint16         FrameLen,
+                          USLP_Frame_t  *Info);
+const uint8 *USLP_NextPacket(USLP_Frame_t *Info, uint16 *PktLen);
+uint16 USLP_Crc16        (const uint8 *Data, uint32 Len);
+
+#endif  /* _uslp_ */
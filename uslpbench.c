@@ -0,0 +1,235 @@
+/*
+** File: uslpbench.c
+** Role: BENCHMARK (USLP frame layer)
+** Description: Round-trips a stream of telecommands through USLP frames and
+**              checks that every packet comes back byte for byte, in order,
+**              with no VC frame count gaps. Then times build + parse for
+**              two framings of the same stream:
+**              - variable  frames carry whole packets and end with the last
+**                          one (construction rule '111', as uslp.c builds)
+**              - fixed     every frame is padded to the same length with an
+**                          idle packet (APID 0x7FF), which the parser skips,
+**                          the way fixed-length TM/TC frames are filled
+**              Exits non-zero if a round trip fails, so it doubles as the
+**              frame layer's regression test.
+**
+** Usage:       uslpbench [-n packets] [-s min-max] [-f frame_len] [-r rounds] [-c]
+**              -c  enable the FECF (CRC-16) on both framings
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ccsds.h"
+#include "latency.h"
+#include "uslp.h"
+
+#define BENCH_SCID      0x2A5
+#define BENCH_VCID      3
+#define BENCH_MAPID     1
+#define BENCH_APID      0x1A5
+#define IDLE_APID       0x7FF
+#define IDLE_MIN        (sizeof(CCSDS_PriHdr_t) + 1)
+#define MAX_FRAME       65535
+
+struct stream {
+    uint8 *bytes;              // Packets back to back
+    const uint8 **pkts;
+    uint32 count;
+    uint64 total;
+};
+
+static void make_stream(struct stream *s, uint32 count, uint32 min_payload, uint32 max_payload) {
+    uint8 payload[MAX_FRAME];
+    uint64 off = 0;
+
+    s->bytes = malloc((size_t)count * (sizeof(CCSDS_CommandPacket_t) + max_payload));
+    s->pkts = malloc(count * sizeof(*s->pkts));
+    s->count = count;
+    srand(1);
+    for (uint32 i = 0; i < count; i++) {
+        uint16 len = (uint16)(min_payload + (uint32)rand() % (max_payload - min_payload + 1));
+        for (uint16 k = 0; k < len; k++) payload[k] = (uint8)rand();
+        s->pkts[i] = s->bytes + off;
+        off += CCSDS_BuildTelecommand(s->bytes + off, (uint16)(sizeof(CCSDS_CommandPacket_t) + len),
+                                      BENCH_APID, (uint16)(i & 0x3FFF), 0x10, payload, len);
+    }
+    s->total = off;
+}
+
+// Idle packet of exactly len bytes (len >= IDLE_MIN)
+static void make_idle(uint8 *buf, uint32 len) {
+    CCSDS_PriHdr_t *hdr = (CCSDS_PriHdr_t *)buf;
+
+    memset(buf, 0, len);
+    CCSDS_WR_APID(*hdr, IDLE_APID);
+    CCSDS_WR_SEQFLG(*hdr, CCSDS_INIT_SEQFLG);
+    CCSDS_WR_LEN(*hdr, len);
+}
+
+// Builds and parses the whole stream once. With fixed > 0 every frame is
+// padded to fixed bytes. If check, compares each packet with the original.
+// Returns packets delivered, frames and frame bytes through *frames/*bytes.
+static uint32 round_trip(const struct stream *s, uint32 frame_len, uint32 fixed, bool fecf, bool check,
+                         uint64 *frames, uint64 *bytes) {
+    static uint8 frame[MAX_FRAME];
+    static uint8 idle[MAX_FRAME];
+    static const uint8 *batch[4096];
+    USLP_Engine_t tx, rx;
+    uint32 trailer = fecf ? USLP_FECF_SIZE : 0;
+    uint32 next = 0, delivered = 0;
+
+    USLP_InitEngine(&tx, BENCH_SCID, fecf);
+    USLP_InitEngine(&rx, BENCH_SCID, fecf);
+    *frames = *bytes = 0;
+
+    while (next < s->count) {
+        uint16 used, len, pkt_len;
+        uint32 n = 0;
+
+        if (fixed == 0) {
+            uint32 avail = s->count - next;
+            len = USLP_BuildFrame(&tx, frame, (uint16)frame_len, BENCH_VCID, BENCH_MAPID, s->pkts + next,
+                                  (uint16)(avail < 4096 ? avail : 4096), &used);
+        } else {
+            // Whole packets that leave room for the idle fill, then the fill
+            uint32 room = fixed - USLP_HeaderSize(&tx, BENCH_VCID) - trailer;
+            uint32 fill = room;
+            while (next + n < s->count && n < 4095) {
+                uint32 plen = CCSDS_RD_LEN(*(const CCSDS_PriHdr_t *)s->pkts[next + n]);
+                if (plen > fill || (plen < fill && fill - plen < IDLE_MIN)) break;
+                batch[n] = s->pkts[next + n];
+                fill -= plen;
+                n++;
+            }
+            if (fill > 0) {
+                make_idle(idle, fill);
+                batch[n] = idle;
+            }
+            len = USLP_BuildFrame(&tx, frame, (uint16)fixed, BENCH_VCID, BENCH_MAPID, batch,
+                                  (uint16)(n + (fill > 0)), &used);
+            if (len != fixed) used = 0;
+            else              used = (uint16)n;
+        }
+        if (used == 0) {
+            fprintf(stderr, "[USLP] Packet %u does not fit a %u byte frame\n", next, fixed ? fixed : frame_len);
+            exit(EXIT_FAILURE);
+        }
+        (*frames)++;
+        *bytes += len;
+
+        USLP_Frame_t info;
+        if (!USLP_ParseFrame(&rx, frame, len, &info)) {
+            fprintf(stderr, "[USLP] Frame %llu failed to parse\n", (unsigned long long)*frames);
+            exit(EXIT_FAILURE);
+        }
+        const uint8 *pkt;
+        while ((pkt = USLP_NextPacket(&info, &pkt_len)) != NULL) {
+            if (CCSDS_RD_APID(*(const CCSDS_PriHdr_t *)pkt) == IDLE_APID) continue;
+            if (check && (delivered >= s->count ||
+                          pkt_len != CCSDS_RD_LEN(*(const CCSDS_PriHdr_t *)s->pkts[delivered]) ||
+                          memcmp(pkt, s->pkts[delivered], pkt_len) != 0)) {
+                fprintf(stderr, "[USLP] Packet %u came back different\n", delivered);
+                exit(EXIT_FAILURE);
+            }
+            delivered++;
+        }
+        next += used;
+    }
+    if (check && (delivered != s->count || rx.VcRxGaps[BENCH_VCID] != 0)) {
+        fprintf(stderr, "[USLP] %u of %u packets delivered, %u frame count gaps\n", delivered, s->count,
+                rx.VcRxGaps[BENCH_VCID]);
+        exit(EXIT_FAILURE);
+    }
+    return delivered;
+}
+
+// A packet whose length field claims more than the frame holds (0xFFF9 and
+// up would wrap a 16-bit length) must end the walk, not loop or overrun
+static void check_oversize(void) {
+    static uint8 frame[256];
+    uint8 pkt[32];
+    const uint8 *pkts[1] = { pkt };
+    USLP_Engine_t tx, rx;
+    USLP_Frame_t info;
+    uint16 used, pkt_len;
+
+    USLP_InitEngine(&tx, BENCH_SCID, false);
+    USLP_InitEngine(&rx, BENCH_SCID, false);
+    CCSDS_BuildTelecommand(pkt, sizeof(pkt), BENCH_APID, 0, 0x10, NULL, sizeof(pkt) - sizeof(CCSDS_CommandPacket_t));
+    uint16 len = USLP_BuildFrame(&tx, frame, sizeof(frame), BENCH_VCID, BENCH_MAPID, pkts, 1, &used);
+
+    uint8 *in_frame = frame + USLP_HeaderSize(&tx, BENCH_VCID);
+    for (uint32 field = 0xFFF0; field <= 0xFFFF; field++) {
+        in_frame[4] = (uint8)(field >> 8);
+        in_frame[5] = (uint8)field;
+        if (!USLP_ParseFrame(&rx, frame, len, &info) || USLP_NextPacket(&info, &pkt_len) != NULL) {
+            fprintf(stderr, "[USLP] Length field 0x%04X was accepted\n", field);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// The FECF is CRC-16-CCITT with init 0xFFFF; 0x29B1 is its check value
+static void check_crc(void) {
+    if (USLP_Crc16((const uint8 *)"123456789", 9) != 0x29B1) {
+        fprintf(stderr, "[USLP] CRC-16 check value is 0x%04X, not 0x29B1\n", USLP_Crc16((const uint8 *)"123456789", 9));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void run(const char *name, const struct stream *s, uint32 frame_len, uint32 fixed, bool fecf, int rounds) {
+    uint64 frames, bytes;
+    uint64 start, ns;
+
+    round_trip(s, frame_len, fixed, fecf, true, &frames, &bytes);
+    start = LAT_NowNs();
+    for (int i = 0; i < rounds; i++) round_trip(s, frame_len, fixed, fecf, false, &frames, &bytes);
+    ns = LAT_NowNs() - start;
+
+    printf("[USLP] %-8s %8llu frames, %6.1f%% of frame bytes are packets, %8.1f ns/packet, %7.0f MB/s of packets\n",
+           name, (unsigned long long)frames, 100.0 * (double)s->total / (double)bytes,
+           (double)ns / ((double)rounds * s->count), (double)s->total * rounds / ((double)ns / 1e9) / 1e6);
+}
+
+int main(int argc, char **argv) {
+    long count = 200000, min_payload = 16, max_payload = 512, frame_len = 4096, rounds = 20;
+    bool fecf = false;
+    struct stream s;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:f:r:c")) != -1) {
+        switch (opt) {
+            case 'n': count = atol(optarg); break;
+            case 's':
+                if (sscanf(optarg, "%ld-%ld", &min_payload, &max_payload) != 2) min_payload = -1;
+                break;
+            case 'f': frame_len = atol(optarg); break;
+            case 'r': rounds = atol(optarg); break;
+            case 'c': fecf = true; break;
+            default:  count = 0; break;
+        }
+    }
+    if (count < 1 || min_payload < 0 || max_payload < min_payload ||
+        max_payload > MAX_FRAME - 64 - (long)sizeof(CCSDS_CommandPacket_t) - (long)IDLE_MIN ||
+        frame_len < max_payload + 64 + (long)sizeof(CCSDS_CommandPacket_t) + (long)IDLE_MIN ||
+        frame_len > MAX_FRAME || rounds < 1) {
+        fprintf(stderr, "Usage: %s [-n packets] [-s min-max] [-f frame_len] [-r rounds] [-c]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    check_crc();
+    check_oversize();
+    make_stream(&s, (uint32)count, (uint32)min_payload, (uint32)max_payload);
+    printf("[USLP] %ld packets of %ld-%ld payload bytes, frames up to %ld bytes%s\n",
+           count, min_payload, max_payload, frame_len, fecf ? " with FECF" : "");
+    run("variable", &s, (uint32)frame_len, 0, fecf, (int)rounds);
+    run("fixed", &s, (uint32)frame_len, (uint32)frame_len, fecf, (int)rounds);
+    printf("[USLP] Round trip OK: every packet back intact and in order, no frame count gaps\n");
+
+    free(s.bytes);
+    free(s.pkts);
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+** File: viewbench.cpp
+** Role: BENCHMARK (C++ packet views against the C macros)
+** Description: Reads apid, seq_count, length and func_code from the same
+**              corpus of commands built by CCSDS_BuildTelecommand through
+**              CommandView::parse(), CommandView::assume_valid() and the
+**              CCSDS_RD_* macros. Every packet is first read all three ways
+**              and compared; any mismatch exits non-zero. Then each path is
+**              timed, the reads summed into a volatile sink so none of them
+**              is optimized away.
+**
+** Usage:       viewbench [-n packets] [-r rounds]
+*/
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+
+#include "ccsds.hpp"
+#include "latency.h"
+
+#define BENCH_PAYLOAD  8
+#define PKT_SIZE       (sizeof(CCSDS_CommandPacket_t) + BENCH_PAYLOAD)
+
+using namespace ccsds;
+
+static void fail(const char *what, std::uint32_t i)
+{
+    std::fprintf(stderr, "[VIEW] %s differs at packet %u\n", what, i);
+    std::exit(EXIT_FAILURE);
+}
+
+static std::uint32_t read_macros(const std::uint8_t *p)
+{
+    auto *pkt = reinterpret_cast<const CCSDS_CommandPacket_t *>(p);
+    return CCSDS_RD_APID(pkt->SpacePacket.Hdr) + CCSDS_RD_SEQ(pkt->SpacePacket.Hdr) +
+           CCSDS_RD_LEN(pkt->SpacePacket.Hdr) + CCSDS_RD_FC(pkt->Sec);
+}
+
+static std::uint32_t read_view(const CommandView &v)
+{
+    return v.apid() + v.seq_count() + v.length() + v.func_code();
+}
+
+int main(int argc, char **argv)
+{
+    long count = 4096, rounds = 2000;
+    volatile std::uint32_t sink = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n': count = std::atol(optarg); break;
+            case 'r': rounds = std::atol(optarg); break;
+            default:  count = 0; break;
+        }
+    }
+    if (count < 1 || rounds < 1) {
+        std::fprintf(stderr, "Usage: %s [-n packets] [-r rounds]\n", argv[0]);
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Back to back commands with random APID, sequence, function code and payload
+    std::vector<std::uint8_t> corpus((std::size_t)count * PKT_SIZE);
+    std::srand(1);
+    for (long i = 0; i < count; i++) {
+        std::array<std::uint8_t, BENCH_PAYLOAD> payload;
+        for (auto &b : payload) b = (std::uint8_t)std::rand();
+        CCSDS_BuildTelecommand(&corpus[i * PKT_SIZE], PKT_SIZE, (std::uint16_t)(std::rand() & 0x7FF),
+                               (std::uint16_t)(std::rand() & 0x3FFF), (std::uint8_t)(std::rand() & 0x7F),
+                               payload.data(), BENCH_PAYLOAD);
+    }
+    auto packet = [&](long i) { return std::as_bytes(std::span(&corpus[i * PKT_SIZE], PKT_SIZE)); };
+
+    for (long i = 0; i < count; i++) {
+        auto *pkt = reinterpret_cast<const CCSDS_CommandPacket_t *>(&corpus[i * PKT_SIZE]);
+        auto v = CommandView::parse(packet(i));
+        if (!v) fail("parse()", (std::uint32_t)i);
+        if (v->apid() != CCSDS_RD_APID(pkt->SpacePacket.Hdr)) fail("apid", (std::uint32_t)i);
+        if (v->seq_count() != CCSDS_RD_SEQ(pkt->SpacePacket.Hdr)) fail("seq_count", (std::uint32_t)i);
+        if (v->length() != (std::uint32_t)CCSDS_RD_LEN(pkt->SpacePacket.Hdr)) fail("length", (std::uint32_t)i);
+        if (v->func_code() != CCSDS_RD_FC(pkt->Sec)) fail("func_code", (std::uint32_t)i);
+        if (read_view(CommandView::assume_valid(packet(i))) != read_macros(&corpus[i * PKT_SIZE]))
+            fail("assume_valid()", (std::uint32_t)i);
+    }
+
+    std::uint64_t start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (long i = 0; i < count; i++) sink = sink + read_macros(&corpus[i * PKT_SIZE]);
+    }
+    std::uint64_t ns_macros = LAT_NowNs() - start;
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (long i = 0; i < count; i++) {
+            auto v = CommandView::parse(packet(i));
+            sink = sink + (v ? read_view(*v) : 0);
+        }
+    }
+    std::uint64_t ns_parse = LAT_NowNs() - start;
+
+    start = LAT_NowNs();
+    for (long r = 0; r < rounds; r++) {
+        for (long i = 0; i < count; i++) sink = sink + read_view(CommandView::assume_valid(packet(i)));
+    }
+    std::uint64_t ns_assume = LAT_NowNs() - start;
+
+    double n = (double)count * rounds;
+    std::printf("[VIEW] %ld packets x %ld rounds, views and macros read the same fields\n", count, rounds);
+    std::printf("[VIEW] read   macros %6.2f ns/packet   parse() %6.2f ns/packet   assume_valid() %6.2f ns/packet\n",
+                ns_macros / n, ns_parse / n, ns_assume / n);
+
+    return sink == 0xFFFFFFFFu;
+}
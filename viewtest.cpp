@@ -0,0 +1,93 @@
+/*
+** File: viewtest.cpp
+** Role: TEST (C++ packet views, ccsds.hpp)
+** Description: Checks the views against the C macros on packets built by
+**              CCSDS_BuildTelecommand / CCSDS_BuildTelemetry, and that
+**              parse() refuses what it must: short buffers, packets whose
+**              length field claims more than the buffer (including 0xFFFF,
+**              a total of 65542 bytes) and the wrong packet type. The
+**              length cases are also checked at compile time. Exits
+**              non-zero on the first failure.
+**
+** Usage:       viewtest
+*/
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+
+#include "ccsds.hpp"
+
+using namespace ccsds;
+
+static_assert(std::is_same_v<field::Length::value_type, std::uint32_t>, "0xFFFF + 7 needs 32 bits");
+static_assert(std::is_same_v<field::Apid::value_type, std::uint16_t>);
+// A typed view only comes out of parse(), never from an unchecked base view
+static_assert(!std::is_constructible_v<CommandView, BasicView<sizeof(CCSDS_CommandPacket_t), sizeof(CCSDS_CommandPacket_t)>>);
+static_assert(!std::is_constructible_v<TelemetryView, BasicView<sizeof(CCSDS_TelemetryPacket_t), sizeof(CCSDS_TelemetryPacket_t)>>);
+
+// A header of n bytes with the given length field, nothing else
+template <std::size_t N>
+constexpr std::array<std::byte, N> header(unsigned length_field, std::byte first = std::byte{0x18})
+{
+    std::array<std::byte, N> b{};
+    b[0] = first;
+    b[4] = std::byte(length_field >> 8);
+    b[5] = std::byte(length_field & 0xFF);
+    return b;
+}
+
+constexpr bool parses(std::span<const std::byte> buf) { return PacketView::parse(buf).has_value(); }
+
+static_assert(!parses(header<6>(0xFFFF)), "a 65542-byte packet in 6 bytes");
+static_assert(!parses(header<64>(0xFFFF)));
+static_assert(!parses(header<6>(0xFFF9)), "0xFFF9 + 7 must not wrap to 0");
+static_assert(parses(header<7>(0)), "length field 0 is a 7-byte packet");
+static_assert(!parses(header<6>(0)), "one byte short");
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::fprintf(stderr, "[VIEW] FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+int main()
+{
+    // Length field 0xFFFF in a 6-byte buffer: refused, never a 6-byte view
+    auto big = header<6>(0xFFFF);
+    check(!PacketView::parse(big).has_value(), "6-byte buffer with length field 0xFFFF refused");
+    check(PacketView::assume_valid(big).length() == 0x10006, "length() of field 0xFFFF is 65542");
+
+    // A real command, then the same bytes through every view
+    std::array<std::uint8_t, 64> cmd{};
+    const std::uint8_t payload[5] = { 1, 2, 3, 4, 5 };
+    std::uint16_t n = CCSDS_BuildTelecommand(cmd.data(), cmd.size(), 0x1A5, 77, 0x0A, payload, sizeof(payload));
+    auto bytes = std::as_bytes(std::span(cmd.data(), cmd.size()));
+    auto *hdr = reinterpret_cast<const CCSDS_CommandPacket_t *>(cmd.data());
+
+    auto c = CommandView::parse(bytes);
+    check(c.has_value(), "command parses");
+    if (c) {
+        check(c->apid() == CCSDS_RD_APID(hdr->SpacePacket.Hdr), "apid");
+        check(c->seq_count() == CCSDS_RD_SEQ(hdr->SpacePacket.Hdr), "seq_count");
+        check(c->length() == n && c->bytes().size() == n, "length trims the view");
+        check(c->func_code() == CCSDS_RD_FC(hdr->Sec), "func_code");
+        check(c->valid_checksum(), "checksum");
+        check(c->payload().size() == sizeof(payload), "payload");
+    }
+    check(!TelemetryView::parse(bytes).has_value(), "command is not telemetry");
+    check(!CommandView::parse(bytes.first(n - 1)).has_value(), "truncated command refused");
+
+    std::array<std::uint8_t, 64> tlm{};
+    CCSDS_BuildTelemetry(tlm.data(), tlm.size(), 0x0A0, 1, 100, 0, payload, sizeof(payload));
+    auto t = PacketView::parse(std::as_bytes(std::span(tlm.data(), tlm.size())));
+    check(t.has_value() && as_telemetry(*t).has_value(), "telemetry narrows to TelemetryView");
+    check(t.has_value() && !as_command(*t).has_value(), "telemetry does not narrow to CommandView");
+
+    if (failures == 0) std::printf("[VIEW] All checks passed\n");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
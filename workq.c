@@ -0,0 +1,406 @@
+/*
+**  Work-Stealing Task Pool - Chase-Lev deques (Le et al., PPoPP 2013)
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#include "workq.h"
+
+#define WQ_MASK         (WQ_DEQUE_SIZE - 1)
+#define WQ_IDLE_SPINS   64           /* Steal rounds before a worker sleeps */
+#define WQ_SLEEP_NS     1000000      /* Bounded sleep, covers a missed wakeup */
+
+static __thread WQ_Pool_t *WQ_CurPool = NULL;
+static __thread int        WQ_CurId   = -1;
+
+/******************************************************************************
+**  Function:  WQ_Push()
+**
+**  Owner only. Returns false when the deque is full.
+*/
+static bool WQ_Push (WQ_Worker_t *Dq, WQ_Task_t *Task)
+{
+   int64 B = __atomic_load_n(&Dq->Bottom, __ATOMIC_RELAXED);
+   int64 T = __atomic_load_n(&Dq->Top, __ATOMIC_ACQUIRE);
+
+   if (B - T >= WQ_DEQUE_SIZE) return false;
+
+   __atomic_store_n(&Dq->Buf[B & WQ_MASK], Task, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   __atomic_store_n(&Dq->Bottom, B + 1, __ATOMIC_RELAXED);
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  WQ_Pop()
+**
+**  Owner only, takes the newest task.
+*/
+static WQ_Task_t *WQ_Pop (WQ_Worker_t *Dq)
+{
+   WQ_Task_t *Task = NULL;
+   int64      B    = __atomic_load_n(&Dq->Bottom, __ATOMIC_RELAXED) - 1;
+   int64      T;
+
+   __atomic_store_n(&Dq->Bottom, B, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   T = __atomic_load_n(&Dq->Top, __ATOMIC_RELAXED);
+
+   if (T <= B)
+   {
+      Task = __atomic_load_n(&Dq->Buf[B & WQ_MASK], __ATOMIC_RELAXED);
+      if (T == B)
+      {
+         /* Last task: race the thieves for it */
+         if (!__atomic_compare_exchange_n(&Dq->Top, &T, T + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+         {
+            Task = NULL;
+         }
+         __atomic_store_n(&Dq->Bottom, B + 1, __ATOMIC_RELAXED);
+      }
+   }
+   else
+   {
+      __atomic_store_n(&Dq->Bottom, B + 1, __ATOMIC_RELAXED);
+   }
+
+   return Task;
+}
+
+/******************************************************************************
+**  Function:  WQ_Steal()
+**
+**  Any thread, takes the oldest task. NULL when empty or the race was lost.
+*/
+static WQ_Task_t *WQ_Steal (WQ_Worker_t *Dq)
+{
+   WQ_Task_t *Task;
+   int64      T = __atomic_load_n(&Dq->Top, __ATOMIC_ACQUIRE);
+   int64      B;
+
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   B = __atomic_load_n(&Dq->Bottom, __ATOMIC_ACQUIRE);
+   if (T >= B) return NULL;
+
+   Task = __atomic_load_n(&Dq->Buf[T & WQ_MASK], __ATOMIC_RELAXED);
+   if (!__atomic_compare_exchange_n(&Dq->Top, &T, T + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+   {
+      return NULL;
+   }
+
+   return Task;
+}
+
+/******************************************************************************
+**  Function:  WQ_TakeInjected()
+*/
+static WQ_Task_t *WQ_TakeInjected (WQ_Pool_t *Pool)
+{
+   WQ_Task_t *Task;
+
+   if (__atomic_load_n(&Pool->InjectHead, __ATOMIC_RELAXED) == NULL) return NULL;
+
+   pthread_mutex_lock(&Pool->Lock);
+   Task = Pool->InjectHead;
+   if (Task != NULL)
+   {
+      Pool->InjectHead = Task->Next;
+      if (Pool->InjectHead == NULL) Pool->InjectTail = NULL;
+   }
+   pthread_mutex_unlock(&Pool->Lock);
+
+   return Task;
+}
+
+/******************************************************************************
+**  Function:  WQ_FindTask()
+**
+**  Own deque first, then the injection list, then one pass over the other
+**  workers starting at a random victim.
+*/
+static WQ_Task_t *WQ_FindTask (WQ_Pool_t *Pool, uint32 Id, uint32 *Rng)
+{
+   WQ_Worker_t *Own = &Pool->Workers[Id];
+   WQ_Task_t   *Task;
+   uint32       Start, i;
+
+   if ((Task = WQ_Pop(Own)) != NULL) return Task;
+   if ((Task = WQ_TakeInjected(Pool)) != NULL) return Task;
+
+   *Rng ^= *Rng << 13;
+   *Rng ^= *Rng >> 17;
+   *Rng ^= *Rng << 5;
+   Start = *Rng % Pool->NumWorkers;
+
+   for (i = 0; i < Pool->NumWorkers; ++i)
+   {
+      uint32 Victim = (Start + i) % Pool->NumWorkers;
+      if (Victim == Id) continue;
+      if ((Task = WQ_Steal(&Pool->Workers[Victim])) != NULL)
+      {
+         Own->Stolen++;
+         return Task;
+      }
+   }
+
+   return NULL;
+}
+
+/******************************************************************************
+**  Function:  WQ_Finish()
+*/
+static void WQ_Finish (WQ_Pool_t *Pool)
+{
+   if (__atomic_sub_fetch(&Pool->Pending, 1, __ATOMIC_ACQ_REL) == 0)
+   {
+      pthread_mutex_lock(&Pool->Lock);
+      pthread_cond_broadcast(&Pool->Done);
+      pthread_mutex_unlock(&Pool->Lock);
+   }
+}
+
+/******************************************************************************
+**  Function:  WQ_Worker()
+*/
+static void *WQ_Worker (void *Arg)
+{
+   WQ_Pool_t *Pool = ((WQ_Worker_t *)Arg)->Pool;
+   uint32     Id   = ((WQ_Worker_t *)Arg)->Id;
+   uint32     Rng  = 0x9E3779B9u * (Id + 1);
+   uint32     Idle = 0;
+   WQ_Task_t *Task;
+
+   WQ_CurPool = Pool;
+   WQ_CurId   = (int)Id;
+
+   while (!__atomic_load_n(&Pool->Stop, __ATOMIC_ACQUIRE))
+   {
+      if ((Task = WQ_FindTask(Pool, Id, &Rng)) != NULL)
+      {
+         Idle = 0;
+         Task->Run(Task);
+         Pool->Workers[Id].Executed++;
+         WQ_Finish(Pool);
+         continue;
+      }
+
+      if (++Idle < WQ_IDLE_SPINS)
+      {
+         sched_yield();
+         continue;
+      }
+
+      /* Deque pushes do not take the lock, so the wait is bounded */
+      pthread_mutex_lock(&Pool->Lock);
+      if (!Pool->Stop && Pool->InjectHead == NULL)
+      {
+         struct timespec Ts;
+         clock_gettime(CLOCK_REALTIME, &Ts);
+         Ts.tv_nsec += WQ_SLEEP_NS;
+         if (Ts.tv_nsec >= 1000000000L) { Ts.tv_sec++; Ts.tv_nsec -= 1000000000L; }
+
+         Pool->Sleepers++;
+         pthread_cond_timedwait(&Pool->Wake, &Pool->Lock, &Ts);
+         Pool->Sleepers--;
+      }
+      pthread_mutex_unlock(&Pool->Lock);
+      Idle = 0;
+   }
+
+   return NULL;
+}
+
+/******************************************************************************
+**  Function:  WQ_Init()
+*/
+bool WQ_Init (WQ_Pool_t *Pool, uint32 NumWorkers)
+{
+   uint32 i;
+
+   memset(Pool, 0, sizeof(*Pool));
+   if (NumWorkers == 0 || NumWorkers > WQ_MAX_WORKERS) return false;
+
+   if (posix_memalign((void **)&Pool->Workers, 64, NumWorkers * sizeof(WQ_Worker_t)) != 0) return false;
+   memset(Pool->Workers, 0, NumWorkers * sizeof(WQ_Worker_t));
+   for (i = 0; i < NumWorkers; ++i)
+   {
+      Pool->Workers[i].Pool = Pool;
+      Pool->Workers[i].Id   = i;
+   }
+
+   pthread_mutex_init(&Pool->Lock, NULL);
+   pthread_cond_init(&Pool->Wake, NULL);
+   pthread_cond_init(&Pool->Done, NULL);
+
+   /* Workers read NumWorkers to pick victims, set it before they start */
+   Pool->NumWorkers = NumWorkers;
+   for (i = 0; i < NumWorkers; ++i)
+   {
+      if (pthread_create(&Pool->Threads[i], NULL, WQ_Worker, &Pool->Workers[i]) != 0) break;
+   }
+
+   if (i < NumWorkers)
+   {
+      Pool->NumWorkers = i;
+      WQ_Destroy(Pool);
+      return false;
+   }
+
+   return true;
+}
+
+/******************************************************************************
+**  Function:  WQ_Submit()
+**
+**  From a worker of this pool the task goes on that worker's deque,
+**  otherwise (or when the deque is full) on the injection list.
+*/
+void WQ_Submit (WQ_Pool_t *Pool, WQ_Task_t *Task)
+{
+   __atomic_add_fetch(&Pool->Pending, 1, __ATOMIC_ACQ_REL);
+
+   if (WQ_CurPool == Pool && WQ_Push(&Pool->Workers[WQ_CurId], Task))
+   {
+      if (__atomic_load_n(&Pool->Sleepers, __ATOMIC_RELAXED) > 0)
+      {
+         pthread_mutex_lock(&Pool->Lock);
+         pthread_cond_signal(&Pool->Wake);
+         pthread_mutex_unlock(&Pool->Lock);
+      }
+      return;
+   }
+
+   Task->Next = NULL;
+   pthread_mutex_lock(&Pool->Lock);
+   if (Pool->InjectTail != NULL) Pool->InjectTail->Next = Task;
+   else                          Pool->InjectHead       = Task;
+   Pool->InjectTail = Task;
+   pthread_cond_signal(&Pool->Wake);
+   pthread_mutex_unlock(&Pool->Lock);
+}
+
+/******************************************************************************
+**  Function:  WQ_Wait()
+**
+**  Blocks until every submitted task, including tasks submitted by tasks,
+**  has finished. Not to be called from a worker of the same pool.
+*/
+void WQ_Wait (WQ_Pool_t *Pool)
+{
+   pthread_mutex_lock(&Pool->Lock);
+   while (__atomic_load_n(&Pool->Pending, __ATOMIC_ACQUIRE) != 0)
+   {
+      pthread_cond_wait(&Pool->Done, &Pool->Lock);
+   }
+   pthread_mutex_unlock(&Pool->Lock);
+}
+
+/******************************************************************************
+**  Function:  WQ_Destroy()
+*/
+void WQ_Destroy (WQ_Pool_t *Pool)
+{
+   uint32 i;
+
+   pthread_mutex_lock(&Pool->Lock);
+   __atomic_store_n(&Pool->Stop, true, __ATOMIC_RELEASE);
+   pthread_cond_broadcast(&Pool->Wake);
+   pthread_mutex_unlock(&Pool->Lock);
+
+   for (i = 0; i < Pool->NumWorkers; ++i) pthread_join(Pool->Threads[i], NULL);
+
+   pthread_mutex_destroy(&Pool->Lock);
+   pthread_cond_destroy(&Pool->Wake);
+   pthread_cond_destroy(&Pool->Done);
+   free(Pool->Workers);
+
+   memset(Pool, 0, sizeof(*Pool));
+}
+
+/******************************************************************************
+**  Function:  WQ_WorkerId()
+*/
+int WQ_WorkerId (void)
+{
+   return WQ_CurId;
+}
+
+/******************************************************************************
+**  Function:  WQ_RunStrand()
+**
+**  The strand's pool task. Submitters push onto Incoming (a stack); the
+**  runner takes it whole, reverses it into submission order and runs from
+**  Ready. Next is read before a task runs, so a task may reuse itself.
+*/
+static void WQ_RunStrand (WQ_Task_t *Runner)
+{
+   WQ_Strand_t *Strand = (WQ_Strand_t *)Runner;
+   WQ_Task_t   *Task, *Taken, *Next;
+   uint64       Ran = 0;
+
+   while (Ran < WQ_STRAND_BATCH)
+   {
+      if (Strand->Ready == NULL)
+      {
+         Taken = __atomic_exchange_n(&Strand->Incoming, NULL, __ATOMIC_ACQUIRE);
+         if (Taken == NULL) break;
+
+         while (Taken != NULL)
+         {
+            Next          = Taken->Next;
+            Taken->Next   = Strand->Ready;
+            Strand->Ready = Taken;
+            Taken         = Next;
+         }
+      }
+
+      Task          = Strand->Ready;
+      Strand->Ready = Task->Next;
+      Task->Run(Task);
+      Ran++;
+   }
+
+   Strand->Executed += Ran;
+
+   /* A submitter counts after pushing, so a non-zero rest is already on
+   ** Incoming or about to be; requeue rather than lose it */
+   if (__atomic_sub_fetch(&Strand->Pending, Ran, __ATOMIC_ACQ_REL) != 0)
+   {
+      WQ_Submit(Strand->Pool, Runner);
+   }
+}
+
+/******************************************************************************
+**  Function:  WQ_InitStrand()
+*/
+void WQ_InitStrand (WQ_Pool_t *Pool, WQ_Strand_t *Strand)
+{
+   memset(Strand, 0, sizeof(*Strand));
+   Strand->Runner.Run = WQ_RunStrand;
+   Strand->Pool       = Pool;
+}
+
+/******************************************************************************
+**  Function:  WQ_SubmitStrand()
+**
+**  The first task into an idle strand puts the strand into the pool.
+**  Task->Next belongs to the strand until the task runs.
+*/
+void WQ_SubmitStrand (WQ_Strand_t *Strand, WQ_Task_t *Task)
+{
+   WQ_Task_t *Head = __atomic_load_n(&Strand->Incoming, __ATOMIC_RELAXED);
+
+   do
+   {
+      Task->Next = Head;
+   } while (!__atomic_compare_exchange_n(&Strand->Incoming, &Head, Task, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+   if (__atomic_fetch_add(&Strand->Pending, 1, __ATOMIC_ACQ_REL) == 0)
+   {
+      WQ_Submit(Strand->Pool, &Strand->Runner);
+   }
+}
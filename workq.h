@@ -0,0 +1,110 @@
+/*
+**  Work-Stealing Task Pool
+**
+**  Every worker owns a Chase-Lev deque. It pushes and pops its own tasks
+**  at the bottom (LIFO, cache-warm) and, when empty, steals from the top
+**  of another worker's deque (FIFO, oldest and usually largest work).
+**  Tasks submitted from outside the pool go to a shared injection list.
+**
+**  Tasks are intrusive: callers embed WQ_Task_t in their own work item
+**  and recover it in Run, so the pool never allocates per task. A task
+**  running on a worker may submit more tasks; those land on the worker's
+**  own deque where idle workers can steal them (fork-join splitting).
+**
+**  A strand serializes a subset of tasks without tying it to a thread:
+**  tasks submitted to one strand run one at a time, in submission order,
+**  on whichever worker picks the strand up. Different strands run in
+**  parallel. A strand with work is a single task in the pool; it runs up
+**  to WQ_STRAND_BATCH of its tasks and then requeues itself, so a busy
+**  strand cannot monopolize a worker.
+*/
+
+#ifndef _workq_
+#define _workq_
+
+/*
+** Includes
+*/
+#include <pthread.h>
+
+#include "ccsds.h"
+
+/*
+** Configuration
+*/
+#define WQ_MAX_WORKERS   64
+#define WQ_DEQUE_SIZE    4096        /* Power of 2, overflow goes to the injection list */
+#define WQ_STRAND_BATCH  16          /* Strand tasks run per turn */
+
+/*----- Task, embedded in the caller's work item -----*/
+typedef struct WQ_Task {
+
+   void           (*Run)(struct WQ_Task *Task);
+   struct WQ_Task  *Next;            /* Injection list link, owned by the pool */
+
+} WQ_Task_t;
+
+/*----- Per-worker state: deque (top and bottom on separate cache lines) -----*/
+typedef struct {
+
+   int64         Top      __attribute__((aligned(64)));
+   int64         Bottom   __attribute__((aligned(64)));
+   WQ_Task_t    *Buf[WQ_DEQUE_SIZE];
+
+   struct WQ_Pool *Pool;
+   uint32        Id;
+
+   /* Statistics, written by the owner only */
+   uint64        Executed;
+   uint64        Stolen;
+
+} WQ_Worker_t;
+
+/*----- Pool -----*/
+typedef struct WQ_Pool {
+
+   uint32           NumWorkers;
+   pthread_t        Threads[WQ_MAX_WORKERS];
+   WQ_Worker_t     *Workers;
+
+   pthread_mutex_t  Lock;
+   pthread_cond_t   Wake;            /* Work available */
+   pthread_cond_t   Done;            /* Pending dropped to zero */
+   WQ_Task_t       *InjectHead;
+   WQ_Task_t       *InjectTail;
+   uint32           Sleepers;
+   bool             Stop;
+
+   uint64           Pending;         /* Submitted and not yet finished */
+
+} WQ_Pool_t;
+
+/*----- Strand: its tasks run one at a time, in submission order -----*/
+typedef struct {
+
+   WQ_Task_t        Runner;          /* In the pool while the strand has work; first member */
+   WQ_Pool_t       *Pool;
+   WQ_Task_t       *Incoming;        /* Submitted, newest first (linked through Next) */
+   WQ_Task_t       *Ready;           /* Taken by the runner, oldest first */
+   uint64           Pending;         /* Submitted and not yet run */
+   uint64           Executed;
+
+} __attribute__((aligned(64))) WQ_Strand_t;
+
+
+/*
+** Exported Functions
+*/
+bool  WQ_Init      (WQ_Pool_t *Pool, uint32 NumWorkers);
+void  WQ_Submit    (WQ_Pool_t *Pool, WQ_Task_t *Task);
+void  WQ_Wait      (WQ_Pool_t *Pool);
+void  WQ_Destroy   (WQ_Pool_t *Pool);
+
+/* Index of the calling worker in its pool, -1 outside any pool */
+int   WQ_WorkerId  (void);
+
+/* From any thread. WQ_Wait also waits for strand tasks. */
+void  WQ_InitStrand   (WQ_Pool_t *Pool, WQ_Strand_t *Strand);
+void  WQ_SubmitStrand (WQ_Strand_t *Strand, WQ_Task_t *Task);
+
+#endif  /* _workq_ */